@@ -1,7 +1,10 @@
 #include "stm32f4xx.h"
+#include "delay.h"
+#include "gpio.h"
 
 #define SCLK 16000000U
 #define BAUD 9600U
+#define LED  GPIO_PA(5)
 
    /*--------------------------------------------------
     * ADC1 single conversion example on STM32F401
@@ -102,6 +105,8 @@ int main(void)
 
     usart2_send_string("ADC1 PA0 demo\r\n");
 
+    delay_init();
+
    /*--------------------------------------------------
     * 3) Configure PA0 as analog input for ADC1 ch0
     *-------------------------------------------------*/
@@ -136,7 +141,7 @@ int main(void)
     {
         uint32_t adc;
 
-        GPIOA->ODR |= (1U << 5U);          /* GPIO_ODR_OD5 LED ON */
+        gpio_high(LED);                    /* BSRR BS5, LED ON */
 
         ADC1->CR2 |= (1U << 30U);          /* ADC_CR2_SWSTART start conversion */
 
@@ -147,16 +152,13 @@ int main(void)
 
         adc = (uint32_t)ADC1->DR;          /* ADC result */
 
-        GPIOA->ODR &= ~(1U << 5U);         /* LED OFF */
+        gpio_low(LED);                     /* BSRR BR5, LED OFF */
 
         usart2_send_string("ADC = ");
         usart2_send_u32(adc);
         usart2_send_string("\r\n");
 
-        for (volatile uint32_t i = 0; i < 200000U; i++)
-        {
-            /* delay */
-        }
+        delay_ms(100U);
     }
 }
 
@@ -0,0 +1,388 @@
+#include "stm32f4xx.h"
+#include "spsc.h"
+
+#define SCLK 16000000U
+#define BAUD 9600U
+
+   /*--------------------------------------------------
+    * ADC1 analog watchdog (AWD) threshold events
+    *
+    * TIM2 TRGO triggers ADC1 at SAMPLE_HZ, but there is
+    * no EOC interrupt: the CPU sleeps until the AWD
+    * sees a sample outside the window [LTR, HTR].
+    *
+    * Hysteresis is done by moving the window:
+    *   NORMAL : [lo,          hi         ]
+    *   HIGH   : [hi - hyst,   4095       ]
+    *   LOW    : [0,           lo + hyst  ]
+    * so the AWD fires exactly once per state change.
+    *
+    * Each channel has its own thresholds. The AWD
+    * watches one channel (AWDSGL), so with more than
+    * one channel TIM3 rotates the regular sequence,
+    * AWDCH and HTR/LTR every DWELL_SAMPLES samples.
+    * That costs one wakeup per dwell instead of one
+    * per conversion.
+    *
+    * LED PA5 is on while any channel is out of band.
+    * USART2 on PA2 TX, PA3 RX (AF7) prints events.
+    *-------------------------------------------------*/
+
+#define SAMPLE_HZ      1000U
+#define DWELL_SAMPLES  16U                     /* samples per channel per visit */
+
+_Static_assert((SCLK % SAMPLE_HZ) == 0U, "SAMPLE_HZ must divide the timer clock");
+
+typedef enum
+{
+    BAND_NORMAL = 0,
+    BAND_HIGH,
+    BAND_LOW
+} band_t;
+
+typedef struct
+{
+    uint8_t  channel;                          /* ADC1 channel == PAx pin here */
+    uint16_t lo;
+    uint16_t hi;
+    uint16_t hyst;
+    band_t   band;
+} awd_channel_t;
+
+static awd_channel_t awd_channels[] =
+{
+    /* ch  lo     hi     hyst */
+    { 0U,  500U,  3500U, 100U, BAND_NORMAL },  /* PA0 */
+    { 1U,  1000U, 3000U, 50U,  BAND_NORMAL },  /* PA1 */
+    { 4U,  200U,  2000U, 100U, BAND_NORMAL },  /* PA4 */
+};
+
+#define AWD_NUM_CH  (sizeof(awd_channels) / sizeof(awd_channels[0]))
+
+static volatile uint32_t awd_active = 0U;      /* index into awd_channels */
+
+   /*--------------------------------------------------
+    * ISR -> main event queue (SPSC, ADC ISR only)
+    *-------------------------------------------------*/
+typedef struct
+{
+    uint8_t  channel;
+    uint8_t  band;
+    uint16_t value;
+} awd_event_t;
+
+SPSC_QUEUE_DEFINE(evt_q, awd_event_t, 16U)
+
+static evt_q_t evt_q;
+
+static volatile uint32_t wake_awd = 0U;
+static volatile uint32_t wake_rotate = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * Load AWD channel and window for one channel
+    * Only called between conversions (TIM3 is phase
+    * shifted half a sample period from TIM2) or from
+    * the AWD interrupt itself.
+    *-------------------------------------------------*/
+static void awd_load(const awd_channel_t *c)
+{
+    uint32_t lo;
+    uint32_t hi;
+
+    switch (c->band)
+    {
+    case BAND_HIGH:
+        lo = (uint32_t)c->hi - c->hyst;
+        hi = 4095U;
+        break;
+
+    case BAND_LOW:
+        lo = 0U;
+        hi = (uint32_t)c->lo + c->hyst;
+        break;
+
+    case BAND_NORMAL:
+    default:
+        lo = c->lo;
+        hi = c->hi;
+        break;
+    }
+
+    ADC1->LTR = lo;
+    ADC1->HTR = hi;
+
+    ADC1->SQR3 = (uint32_t)c->channel << ADC_SQR3_SQ1_Pos;
+    ADC1->CR1  = (ADC1->CR1 & ~ADC_CR1_AWDCH) | ((uint32_t)c->channel << ADC_CR1_AWDCH_Pos);
+}
+
+static void led_update(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < AWD_NUM_CH; i++)
+    {
+        if (awd_channels[i].band != BAND_NORMAL)
+        {
+            GPIOA->BSRR = GPIO_BSRR_BS5;
+            return;
+        }
+    }
+
+    GPIOA->BSRR = GPIO_BSRR_BR5;
+}
+
+   /*--------------------------------------------------
+    * ADC interrupt handler, AWD only
+    * DR still holds the sample that left the window
+    * (next trigger is a full sample period away).
+    *-------------------------------------------------*/
+void ADC_IRQHandler(void)
+{
+    if (ADC1->SR & ADC_SR_AWD)
+    {
+        awd_channel_t *c = &awd_channels[awd_active];
+        uint16_t v = (uint16_t)ADC1->DR;
+        awd_event_t e;
+
+        ADC1->SR = ~ADC_SR_AWD;                /* rc_w0 */
+        wake_awd++;
+
+        if (v > c->hi)
+        {
+            c->band = BAND_HIGH;
+        }
+        else if (v < c->lo)
+        {
+            c->band = BAND_LOW;
+        }
+        else
+        {
+            c->band = BAND_NORMAL;
+        }
+
+        awd_load(c);
+        led_update();
+
+        e.channel = c->channel;
+        e.band = (uint8_t)c->band;
+        e.value = v;
+        (void)evt_q_push(&evt_q, &e);          /* full: counted in dropped */
+    }
+}
+
+   /*--------------------------------------------------
+    * TIM3 update: move the AWD to the next channel
+    *-------------------------------------------------*/
+void TIM3_IRQHandler(void)
+{
+    if (TIM3->SR & TIM_SR_UIF)
+    {
+        uint32_t next = awd_active + 1U;
+
+        TIM3->SR = ~TIM_SR_UIF;
+        wake_rotate++;
+
+        if (next >= AWD_NUM_CH)
+        {
+            next = 0U;
+        }
+
+        awd_active = next;
+        awd_load(&awd_channels[next]);
+    }
+}
+
+int main(void)
+{
+    uint32_t i;
+
+   /*--------------------------------------------------
+    * 1) GPIOA clock, PA5 LED output
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+
+    GPIOA->MODER &= ~GPIO_MODER_MODER5;
+    GPIOA->MODER |=  GPIO_MODER_MODER5_0;
+    GPIOA->OTYPER &= ~GPIO_OTYPER_OT_5;
+    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR5;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 TX / PA3 RX (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("ADC1 AWD threshold events\r\n");
+
+   /*--------------------------------------------------
+    * 3) Analog inputs (channel n is PAn for 0..7)
+    *-------------------------------------------------*/
+    for (i = 0U; i < AWD_NUM_CH; i++)
+    {
+        uint32_t pin = awd_channels[i].channel;
+
+        GPIOA->MODER |= (3U << (pin * 2U));
+        GPIOA->PUPDR &= ~(3U << (pin * 2U));
+    }
+
+   /*--------------------------------------------------
+    * 4) TIM2: TRGO on update at SAMPLE_HZ
+    *-------------------------------------------------*/
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN | RCC_APB1ENR_TIM3EN;
+
+    TIM2->PSC = 0U;
+    TIM2->ARR = (SCLK / SAMPLE_HZ) - 1U;
+    TIM2->CR2 &= ~TIM_CR2_MMS;
+    TIM2->CR2 |=  TIM_CR2_MMS_1;               /* MMS = 010 update as TRGO */
+    TIM2->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 5) TIM3: channel rotation every DWELL_SAMPLES
+    *    Counter starts half a sample period ahead so
+    *    the rotation never lands on a conversion.
+    *-------------------------------------------------*/
+    TIM3->PSC = (SCLK / SAMPLE_HZ) - 1U;       /* one tick per sample */
+    TIM3->ARR = DWELL_SAMPLES - 1U;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->SR = 0U;
+    TIM3->DIER |= TIM_DIER_UIE;
+
+   /*--------------------------------------------------
+    * 6) ADC1: one regular conversion on TIM2 TRGO,
+    *    AWD on a single regular channel, no EOCIE
+    *-------------------------------------------------*/
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+    ADC->CCR &= ~ADC_CCR_ADCPRE;
+    ADC->CCR |=  ADC_CCR_ADCPRE_0;             /* PCLK2/4 */
+
+    for (i = 0U; i < AWD_NUM_CH; i++)
+    {
+        uint32_t ch = awd_channels[i].channel; /* all channels here are < 10 */
+
+        ADC1->SMPR2 &= ~(7U << (ch * 3U));
+        ADC1->SMPR2 |=  (3U << (ch * 3U));     /* 56 cycles */
+    }
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;                 /* 1 conversion */
+
+    ADC1->CR1 &= ~(ADC_CR1_EOCIE | ADC_CR1_SCAN | ADC_CR1_JAWDEN);
+    ADC1->CR1 |=  ADC_CR1_AWDEN | ADC_CR1_AWDSGL | ADC_CR1_AWDIE;
+
+    awd_active = 0U;
+    awd_load(&awd_channels[0]);
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN | ADC_CR2_DMA |
+                   ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    ADC1->CR2 |=  (6U << ADC_CR2_EXTSEL_Pos);  /* TIM2 TRGO */
+    ADC1->CR2 |=  ADC_CR2_EXTEN_0;             /* rising edge */
+
+    ADC1->SR = 0U;
+    NVIC_EnableIRQ(ADC_IRQn);
+
+    ADC1->CR2 |= ADC_CR2_ADON;
+
+   /*--------------------------------------------------
+    * 7) Start timers
+    *-------------------------------------------------*/
+    if (AWD_NUM_CH > 1U)
+    {
+        NVIC_EnableIRQ(TIM3_IRQn);
+    }
+
+    TIM2->CNT = 0U;
+    TIM2->CR1 |= TIM_CR1_CEN;
+
+    if (AWD_NUM_CH > 1U)
+    {
+        /* TIM3 prescaler counter is not readable, so delay its
+           start by half a sample period instead */
+        while (TIM2->CNT < ((SCLK / SAMPLE_HZ) / 2U))
+        {
+            /* wait */
+        }
+        TIM3->CR1 |= TIM_CR1_CEN;
+    }
+
+   /*--------------------------------------------------
+    * 8) Main loop: print events, sleep otherwise
+    *-------------------------------------------------*/
+    while (1)
+    {
+        awd_event_t e;
+
+        while (evt_q_pop(&evt_q, &e))
+        {
+            usart2_send_string("CH");
+            usart2_send_u32(e.channel);
+            usart2_send_string(e.band == BAND_HIGH ? " HIGH " :
+                               e.band == BAND_LOW  ? " LOW "  : " NORMAL ");
+            usart2_send_u32(e.value);
+            usart2_send_string(" wakes=");
+            usart2_send_u32(wake_awd + wake_rotate);
+            usart2_send_string(" drop=");
+            usart2_send_u32(evt_q.idx.dropped);
+            usart2_send_string(" hw=");
+            usart2_send_u32(evt_q.idx.high_water);
+            usart2_send_string("\r\n");
+        }
+
+        __disable_irq();
+        if (evt_q_count(&evt_q) == 0U)
+        {
+            __WFI();
+        }
+        __enable_irq();
+    }
+}
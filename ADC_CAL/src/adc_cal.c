@@ -0,0 +1,191 @@
+#include "stm32f4xx.h"
+#include "adc_cal.h"
+
+uint16_t adc_cal_lut[4096];
+
+static const int16_t adc_cal_inl[ADC_CAL_INL_KNOTS] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static volatile uint16_t new_vref = 0U;
+static volatile uint16_t new_ts = 0U;
+static volatile uint32_t new_seq = 0U;
+static uint32_t seen_seq = 0U;
+
+static int32_t  offset = 0;                    /* counts, grounded input */
+static uint32_t vref_avg_x8 = 0U;              /* IIR of VREFINT raw, x8 */
+static uint32_t vdda_mv = ADC_CAL_VDDA_CAL_MV;
+static uint32_t lut_vdda_mv = 0U;              /* VDDA the LUT was built for */
+static int32_t  temp_c100 = 0;
+
+   /*--------------------------------------------------
+    * Linearized raw count: raw - offset + INL(raw)
+    *-------------------------------------------------*/
+static int32_t adc_cal_linear(uint32_t raw)
+{
+    uint32_t k = raw >> 8U;
+    uint32_t f = raw & 0xFFU;
+    int32_t inl = adc_cal_inl[k];
+
+    if (k + 1U < ADC_CAL_INL_KNOTS)
+    {
+        inl += ((adc_cal_inl[k + 1U] - adc_cal_inl[k]) * (int32_t)f) / 256;
+    }
+
+    return (int32_t)raw - offset + inl;
+}
+
+   /*--------------------------------------------------
+    * LUT: mV = linear(raw) * VDDA / 4095, Q16 scale
+    *-------------------------------------------------*/
+static void adc_cal_build(uint32_t vdda)
+{
+    uint32_t scale = (vdda << 16U) / 4095U;
+    uint32_t raw;
+
+    for (raw = 0U; raw < 4096U; raw++)
+    {
+        int32_t lin = adc_cal_linear(raw);
+        uint32_t mv;
+
+        if (lin <= 0)
+        {
+            mv = 0U;
+        }
+        else
+        {
+            mv = (((uint32_t)lin * scale) + 0x8000U) >> 16U;
+        }
+
+        adc_cal_lut[raw] = (uint16_t)((mv > 0xFFFFU) ? 0xFFFFU : mv);
+    }
+
+    lut_vdda_mv = vdda;
+}
+
+void adc_cal_init(void)
+{
+    ADC->CCR &= ~ADC_CCR_VBATE;                /* VBATE has priority over TSVREFE */
+    ADC->CCR |=  ADC_CCR_TSVREFE;
+
+    vref_avg_x8 = 8U * ADC_CAL_VREFINT_CAL;
+    adc_cal_build(ADC_CAL_VDDA_CAL_MV);
+}
+
+int32_t adc_cal_measure_offset(uint32_t ch)
+{
+    volatile uint32_t *smpr = (ch < 10U) ? &ADC1->SMPR2 : &ADC1->SMPR1;
+    uint32_t shift = 3U * ((ch < 10U) ? ch : (ch - 10U));
+    uint32_t smpr_old = *smpr;
+    uint32_t sqr1_old = ADC1->SQR1;
+    uint32_t sqr3_old = ADC1->SQR3;
+    uint32_t sum = 0U;
+    uint32_t i;
+    int32_t mean;
+
+    *smpr = smpr_old | (7U << shift);          /* 480 cycles */
+    ADC1->SQR1 = sqr1_old & ~ADC_SQR1_L;
+    ADC1->SQR3 = (sqr3_old & ~ADC_SQR3_SQ1) | (ch << ADC_SQR3_SQ1_Pos);
+
+    for (i = 0U; i < ADC_CAL_OFFSET_N; i++)
+    {
+        ADC1->CR2 |= ADC_CR2_SWSTART;
+        while (!(ADC1->SR & ADC_SR_EOC))
+        {
+            /* wait */
+        }
+        sum += ADC1->DR;                       /* clears EOC */
+    }
+
+    *smpr = smpr_old;
+    ADC1->SQR1 = sqr1_old;
+    ADC1->SQR3 = sqr3_old;
+
+    mean = (int32_t)((sum + (ADC_CAL_OFFSET_N / 2U)) / ADC_CAL_OFFSET_N);
+
+    if (mean > ADC_CAL_OFFSET_MAX)
+    {
+        return -1;
+    }
+
+    offset = mean;
+    adc_cal_build(lut_vdda_mv);
+
+    return offset;
+}
+
+void adc_cal_sample(uint16_t vref_raw, uint16_t ts_raw)
+{
+    new_vref = vref_raw;
+    new_ts = ts_raw;
+    new_seq++;
+}
+
+uint32_t adc_cal_process(void)
+{
+    uint16_t vref;
+    uint16_t ts;
+    uint32_t seq;
+    uint32_t ts_cal;
+    uint32_t diff;
+
+    do
+    {
+        seq = new_seq;
+        vref = new_vref;
+        ts = new_ts;
+    } while (seq != new_seq);
+
+    if ((seq == seen_seq) || (vref == 0U))
+    {
+        return 0U;
+    }
+    seen_seq = seq;
+
+   /*--------------------------------------------------
+    * VDDA = 3.3 V * VREFINT_CAL / VREFINT
+    * VREFINT is smoothed with a 1/8 IIR first
+    *-------------------------------------------------*/
+    vref_avg_x8 -= vref_avg_x8 / 8U;
+    vref_avg_x8 += vref;                       /* steady state 8 x vref */
+
+    vdda_mv = (ADC_CAL_VDDA_CAL_MV * ADC_CAL_VREFINT_CAL * 8U + (vref_avg_x8 / 2U)) /
+              vref_avg_x8;
+
+   /*--------------------------------------------------
+    * Sensor raw rescaled to the 3.3 V of the factory
+    * calibration, then linear between TS_CAL1/2
+    *-------------------------------------------------*/
+    ts_cal = ((uint32_t)ts * vdda_mv) / ADC_CAL_VDDA_CAL_MV;
+
+    temp_c100 = ADC_CAL_TS_CAL1_C * 100 +
+                (((int32_t)ts_cal - (int32_t)ADC_CAL_TS_CAL1) *
+                 (ADC_CAL_TS_CAL2_C - ADC_CAL_TS_CAL1_C) * 100) /
+                ((int32_t)ADC_CAL_TS_CAL2 - (int32_t)ADC_CAL_TS_CAL1);
+
+    diff = (vdda_mv > lut_vdda_mv) ? (vdda_mv - lut_vdda_mv) : (lut_vdda_mv - vdda_mv);
+
+    if (diff >= ADC_CAL_REBUILD_MV)
+    {
+        adc_cal_build(vdda_mv);
+        return 1U;
+    }
+
+    return 0U;
+}
+
+uint32_t adc_cal_vdda_mv(void)
+{
+    return vdda_mv;
+}
+
+int32_t adc_cal_offset(void)
+{
+    return offset;
+}
+
+int32_t adc_cal_temp_c100(void)
+{
+    return temp_c100;
+}
@@ -0,0 +1,86 @@
+#ifndef ADC_CAL_H
+#define ADC_CAL_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * ADC1 calibration from VREFINT and the temperature
+    * sensor (ADC_CCR TSVREFE, channels 17 and 18)
+    *
+    * Factory values in system memory, taken at
+    * VDDA = 3.3 V:
+    *   VREFINT_CAL  raw VREFINT at 30 C
+    *   TS_CAL1      raw sensor at 30 C
+    *   TS_CAL2      raw sensor at 110 C
+    *
+    * Result of a calibration is a 4096 entry LUT,
+    * raw count -> millivolts, so converting a sample
+    * costs the same single load as using it raw.
+    *-------------------------------------------------*/
+
+#define ADC_CAL_VREFINT_CAL   (*(const volatile uint16_t *)0x1FFF7A2AU)
+#define ADC_CAL_TS_CAL1       (*(const volatile uint16_t *)0x1FFF7A2CU)
+#define ADC_CAL_TS_CAL2       (*(const volatile uint16_t *)0x1FFF7A2EU)
+
+#define ADC_CAL_VDDA_CAL_MV   3300U
+#define ADC_CAL_TS_CAL1_C     30
+#define ADC_CAL_TS_CAL2_C     110
+
+#define ADC_CAL_CH_VREFINT    17U
+#define ADC_CAL_CH_TEMP       18U
+
+   /*--------------------------------------------------
+    * Board calibration
+    * OFFSET : mean raw count of a grounded input,
+    *          measured by adc_cal_measure_offset();
+    *          a mean above OFFSET_MAX means the pin is
+    *          not grounded and the offset stays 0
+    * INL    : correction in counts every 256 counts
+    *          (17 knots, linear in between), added to
+    *          the raw value before scaling; all zero
+    *          until a board has been characterized
+    *-------------------------------------------------*/
+#define ADC_CAL_OFFSET_MAX    64
+#define ADC_CAL_OFFSET_N      64U              /* conversions averaged */
+#define ADC_CAL_INL_KNOTS     17U
+
+   /* LUT is rebuilt only when VDDA moved this much */
+#define ADC_CAL_REBUILD_MV    2U
+
+extern uint16_t adc_cal_lut[4096];
+
+   /*--------------------------------------------------
+    * Enable TSVREFE and build a LUT for nominal VDDA
+    *-------------------------------------------------*/
+void adc_cal_init(void);
+
+   /*--------------------------------------------------
+    * ADC1 on, regular group idle (no DMA, no external
+    * trigger yet): converts grounded channel ch by
+    * software start and rebuilds the LUT with its
+    * mean as offset. Returns the offset, or -1 if the
+    * channel does not read as ground.
+    *-------------------------------------------------*/
+int32_t adc_cal_measure_offset(uint32_t ch);
+
+   /*--------------------------------------------------
+    * New VREFINT / sensor raw pair, ISR safe
+    *-------------------------------------------------*/
+void adc_cal_sample(uint16_t vref_raw, uint16_t ts_raw);
+
+   /*--------------------------------------------------
+    * Main context: fold in the latest pair, rebuild
+    * the LUT when VDDA moved. Returns 1 if rebuilt.
+    *-------------------------------------------------*/
+uint32_t adc_cal_process(void);
+
+uint32_t adc_cal_vdda_mv(void);
+int32_t  adc_cal_offset(void);                 /* counts */
+int32_t  adc_cal_temp_c100(void);              /* 0.01 C */
+
+static inline uint16_t adc_cal_mv(uint16_t raw)
+{
+    return adc_cal_lut[raw & 0x0FFFU];
+}
+
+#endif /* ADC_CAL_H */
@@ -0,0 +1,317 @@
+#include "stm32f4xx.h"
+#include "adc_cal.h"
+#include "spsc.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Calibrated millivolts from the ADC DMA stream
+    *
+    * Regular group : PA0 (ch0), TIM2 TRGO at REG_HZ,
+    *                 DMA2 Stream0 circular into adc_buf
+    * Offset        : PA1 (ch1) tied to GND, converted
+    *                 by software start once at boot
+    * Injected group: VREFINT (ch17) + temperature
+    *                 sensor (ch18), TIM5 TRGO at CAL_HZ
+    *                 (JEXTSEL 1011), JEOC interrupt
+    *
+    * The JEOC ISR hands the raw pair to adc_cal, the
+    * main loop recomputes VDDA / temperature and, when
+    * VDDA moved, rebuilds the raw -> mV LUT. The DMA
+    * ISR hands each finished half to the main loop as
+    * a pointer (spsc_ptr), so no half is lost to an
+    * overwritten flag; each is converted with one LUT
+    * load per sample.
+    *-------------------------------------------------*/
+
+#define REG_HZ       1000U
+#define CAL_HZ       10U
+#define ADC_BUF_LEN  1000U                     /* HT/TC every 0.5 s */
+#define ZERO_CH      1U                        /* PA1, grounded */
+
+volatile uint16_t adc_buf[ADC_BUF_LEN];
+
+static spsc_ptr_t block_q;                     /* DMA ISR -> main, finished halves */
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * ADC interrupt handler, injected group done
+    * JDR1 = JSQ3 (VREFINT), JDR2 = JSQ4 (sensor)
+    *-------------------------------------------------*/
+void ADC_IRQHandler(void)
+{
+    if (ADC1->SR & ADC_SR_JEOC)
+    {
+        ADC1->SR = ~(ADC_SR_JEOC | ADC_SR_JSTRT);  /* rc_w0 */
+        adc_cal_sample((uint16_t)ADC1->JDR1, (uint16_t)ADC1->JDR2);
+    }
+}
+
+   /*--------------------------------------------------
+    * DMA2 Stream0 interrupt handler (regular stream)
+    *-------------------------------------------------*/
+void DMA2_Stream0_IRQHandler(void)
+{
+    uint32_t isr = DMA2->LISR;
+
+    DMA2->LIFCR = isr & (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 |
+                         DMA_LISR_DMEIF0 | DMA_LISR_FEIF0);
+
+    if (isr & DMA_LISR_HTIF0)
+    {
+        void *p = (void *)&adc_buf[0];
+
+        (void)spsc_ptr_push(&block_q, &p);
+    }
+    if (isr & DMA_LISR_TCIF0)
+    {
+        void *p = (void *)&adc_buf[ADC_BUF_LEN / 2U];
+
+        (void)spsc_ptr_push(&block_q, &p);
+    }
+}
+
+   /*--------------------------------------------------
+    * Convert one half block and print the averages
+    *-------------------------------------------------*/
+static void process_block(const volatile uint16_t *blk)
+{
+    uint32_t sum_raw = 0U;
+    uint32_t sum_mv = 0U;
+    uint32_t i;
+    int32_t t;
+
+    if (adc_cal_process())
+    {
+        usart2_send_string("LUT rebuilt\r\n");
+    }
+
+    for (i = 0U; i < (ADC_BUF_LEN / 2U); i++)
+    {
+        uint16_t raw = blk[i];
+
+        sum_raw += raw;
+        sum_mv += adc_cal_mv(raw);
+    }
+
+    t = adc_cal_temp_c100();
+
+    usart2_send_string("raw=");
+    usart2_send_u32(sum_raw / (ADC_BUF_LEN / 2U));
+    usart2_send_string(" mV=");
+    usart2_send_u32(sum_mv / (ADC_BUF_LEN / 2U));
+    usart2_send_string(" VDDA=");
+    usart2_send_u32(adc_cal_vdda_mv());
+    usart2_send_string(" T=");
+    if (t < 0)
+    {
+        usart2_send_char('-');
+        t = -t;
+    }
+    usart2_send_u32((uint32_t)t / 100U);
+    usart2_send_char('.');
+    usart2_send_char((char)('0' + ((uint32_t)t / 10U) % 10U));
+    usart2_send_char((char)('0' + (uint32_t)t % 10U));
+    usart2_send_string("C\r\n");
+}
+
+int main(void)
+{
+    uint32_t dropped_seen = 0U;
+    uint32_t i;
+
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN | RCC_APB1ENR_TIM5EN | RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+   /*--------------------------------------------------
+    * 2) PA0 / PA1 analog, USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0 | GPIO_MODER_MODER1;
+    GPIOA->PUPDR &= ~(GPIO_PUPDR_PUPDR0 | GPIO_PUPDR_PUPDR1);
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("ADC1 VREFINT/TS calibration\r\n");
+
+   /*--------------------------------------------------
+    * 3) TIM2 (regular) and TIM5 (calibration)
+    *    both 1 MHz tick, TRGO on update
+    *-------------------------------------------------*/
+    TIM2->PSC = 16U - 1U;
+    TIM2->ARR = (1000000U / REG_HZ) - 1U;
+    TIM2->CR2 &= ~TIM_CR2_MMS;
+    TIM2->CR2 |=  TIM_CR2_MMS_1;
+    TIM2->EGR = TIM_EGR_UG;
+
+    TIM5->PSC = 16U - 1U;
+    TIM5->ARR = (1000000U / CAL_HZ) - 1U;
+    TIM5->CR2 &= ~TIM_CR2_MMS;
+    TIM5->CR2 |=  TIM_CR2_MMS_1;
+    TIM5->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 4) ADC1
+    *    regular : ch0, TIM2 TRGO, DMA + DDS
+    *    injected: JL = 1 -> JSQ3, JSQ4 converted
+    *              JSQ3 = ch17, JSQ4 = ch18
+    *              480 cycles (sensor needs >= 10 us)
+    *-------------------------------------------------*/
+    ADC->CCR &= ~ADC_CCR_ADCPRE;
+    ADC->CCR |=  ADC_CCR_ADCPRE_0;             /* PCLK2/4 */
+
+    adc_cal_init();                            /* TSVREFE, nominal LUT */
+
+    ADC1->CR2 |= ADC_CR2_ADON;
+    for (i = 0U; i < 100U; i++)
+    {
+        __NOP();                               /* tSTAB, 3 us */
+    }
+
+    if (adc_cal_measure_offset(ZERO_CH) < 0)
+    {
+        usart2_send_string("PA1 not grounded, offset 0\r\n");
+    }
+    else
+    {
+        usart2_send_string("offset=");
+        usart2_send_u32((uint32_t)adc_cal_offset());
+        usart2_send_string(" counts\r\n");
+    }
+
+    ADC1->SMPR2 &= ~ADC_SMPR2_SMP0;
+    ADC1->SMPR2 |=  (3U << ADC_SMPR2_SMP0_Pos);
+    ADC1->SMPR1 |=  ADC_SMPR1_SMP17 | ADC_SMPR1_SMP18;
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;
+
+    ADC1->JSQR = ADC_JSQR_JL_0 |
+                 (ADC_CAL_CH_VREFINT << ADC_JSQR_JSQ3_Pos) |
+                 (ADC_CAL_CH_TEMP    << ADC_JSQR_JSQ4_Pos);
+
+    ADC1->CR1 &= ~(ADC_CR1_EOCIE | ADC_CR1_JAUTO);
+    ADC1->CR1 |=  ADC_CR1_SCAN | ADC_CR1_JEOCIE;  /* SCAN for the 2 injected */
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN |
+                   ADC_CR2_EXTSEL | ADC_CR2_EXTEN |
+                   ADC_CR2_JEXTSEL | ADC_CR2_JEXTEN);
+    ADC1->CR2 |=  (6U  << ADC_CR2_EXTSEL_Pos)  | ADC_CR2_EXTEN_0;   /* TIM2 TRGO */
+    ADC1->CR2 |=  (11U << ADC_CR2_JEXTSEL_Pos) | ADC_CR2_JEXTEN_0;  /* TIM5 TRGO */
+    ADC1->CR2 |=  ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 5) DMA2 Stream0 channel 0: ADC1->DR to adc_buf
+    *-------------------------------------------------*/
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN)
+    {
+        /* wait until disabled */
+    }
+
+    DMA2->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+    DMA2_Stream0->PAR  = (uint32_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)adc_buf;
+    DMA2_Stream0->NDTR = ADC_BUF_LEN;
+
+    DMA2_Stream0->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC |
+                       DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    NVIC_EnableIRQ(ADC_IRQn);
+
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+   /*--------------------------------------------------
+    * 6) Enable ADC, start timers
+    *-------------------------------------------------*/
+    ADC1->SR = 0U;
+    ADC1->CR2 |= ADC_CR2_ADON;
+
+    TIM5->CR1 |= TIM_CR1_CEN;
+    TIM2->CR1 |= TIM_CR1_CEN;
+
+   /*--------------------------------------------------
+    * 7) Main loop
+    *-------------------------------------------------*/
+    while (1)
+    {
+        void *blk;
+
+        while (spsc_ptr_pop(&block_q, &blk))
+        {
+            process_block((const volatile uint16_t *)blk);
+        }
+
+        if (block_q.idx.dropped != dropped_seen)
+        {
+            dropped_seen = block_q.idx.dropped;  /* written by the ISR only */
+            usart2_send_string("blocks dropped=");
+            usart2_send_u32(dropped_seen);
+            usart2_send_string("\r\n");
+        }
+
+        __disable_irq();
+        if (spsc_ptr_count(&block_q) == 0U)
+        {
+            __WFI();
+        }
+        __enable_irq();
+    }
+}
@@ -0,0 +1,282 @@
+#include "fft.h"
+
+   /*--------------------------------------------------
+    * cos(2*pi*m/FFT_N_MAX) for any m (window setup only)
+    * cos is even, so fold the upper half of the circle
+    * back into the table range.
+    *-------------------------------------------------*/
+static float cos_f32(uint32_t m)
+{
+    m &= (FFT_N_MAX - 1U);
+
+    if (m > (FFT_N_MAX / 2U))
+    {
+        m = FFT_N_MAX - m;
+    }
+
+    return fft_twiddle_f32[2U * m];
+}
+
+   /*--------------------------------------------------
+    * Bit-reversal permutation (DIT input order)
+    *-------------------------------------------------*/
+#define BIT_REVERSE(x, n, T)                    \
+    do                                          \
+    {                                           \
+        uint32_t i_, j_ = 0U, k_;               \
+        for (i_ = 0U; i_ < (n) - 1U; i_++)      \
+        {                                       \
+            if (i_ < j_)                        \
+            {                                   \
+                T t_ = (x)[i_];                 \
+                (x)[i_] = (x)[j_];              \
+                (x)[j_] = t_;                   \
+            }                                   \
+            k_ = (n) >> 1U;                     \
+            while (k_ <= j_)                    \
+            {                                   \
+                j_ -= k_;                       \
+                k_ >>= 1U;                      \
+            }                                   \
+            j_ += k_;                           \
+        }                                       \
+    } while (0)
+
+static uint32_t log2_u32(uint32_t n)
+{
+    return 31U - (uint32_t)__builtin_clz(n);
+}
+
+   /*--------------------------------------------------
+    * Float FFT
+    *
+    * One radix-4 pass merges two radix-2 DIT stages
+    * (half sizes h and 2h). With a = x[j], b = x[j+h],
+    * c = x[j+2h], d = x[j+3h] and W = exp(-2*pi*i/4h):
+    *
+    *   B1 = W^2j b   C1 = W^j c   D1 = W^3j d
+    *   x[j]    = a + B1 + (C1 + D1)
+    *   x[j+h]  = a - B1 - i(C1 - D1)
+    *   x[j+2h] = a + B1 - (C1 + D1)
+    *   x[j+3h] = a - B1 + i(C1 - D1)
+    *-------------------------------------------------*/
+void fft_cf32(fft_cf32_t *x, uint32_t n)
+{
+    uint32_t h;
+    uint32_t j;
+    uint32_t b;
+
+    BIT_REVERSE(x, n, fft_cf32_t);
+
+    h = 1U;
+
+    if ((log2_u32(n) & 1U) != 0U)
+    {
+        /* radix-2 pass, all twiddles are 1 */
+        for (b = 0U; b < n; b += 2U)
+        {
+            float ar = x[b].re;
+            float ai = x[b].im;
+
+            x[b].re     = ar + x[b + 1U].re;
+            x[b].im     = ai + x[b + 1U].im;
+            x[b + 1U].re = ar - x[b + 1U].re;
+            x[b + 1U].im = ai - x[b + 1U].im;
+        }
+        h = 2U;
+    }
+
+    for (; (4U * h) <= n; h *= 4U)
+    {
+        uint32_t stride = FFT_N_MAX / (4U * h);
+
+        for (j = 0U; j < h; j++)
+        {
+            const float *w1 = &fft_twiddle_f32[2U * (j * stride)];
+            const float *w2 = &fft_twiddle_f32[2U * (2U * j * stride)];
+            const float *w3 = &fft_twiddle_f32[2U * (3U * j * stride)];
+
+            for (b = j; b < n; b += 4U * h)
+            {
+                fft_cf32_t *pa = &x[b];
+                fft_cf32_t *pb = &x[b + h];
+                fft_cf32_t *pc = &x[b + 2U * h];
+                fft_cf32_t *pd = &x[b + 3U * h];
+
+                /* (re + i im)(cos - i sin) */
+                float b1r = pb->re * w2[0] + pb->im * w2[1];
+                float b1i = pb->im * w2[0] - pb->re * w2[1];
+                float c1r = pc->re * w1[0] + pc->im * w1[1];
+                float c1i = pc->im * w1[0] - pc->re * w1[1];
+                float d1r = pd->re * w3[0] + pd->im * w3[1];
+                float d1i = pd->im * w3[0] - pd->re * w3[1];
+
+                float t0r = pa->re + b1r;
+                float t0i = pa->im + b1i;
+                float t1r = pa->re - b1r;
+                float t1i = pa->im - b1i;
+                float t2r = c1r + d1r;
+                float t2i = c1i + d1i;
+                float t3r = c1r - d1r;
+                float t3i = c1i - d1i;
+
+                pa->re = t0r + t2r;
+                pa->im = t0i + t2i;
+                pb->re = t1r + t3i;
+                pb->im = t1i - t3r;
+                pc->re = t0r - t2r;
+                pc->im = t0i - t2i;
+                pd->re = t1r - t3i;
+                pd->im = t1i + t3r;
+            }
+        }
+    }
+}
+
+   /*--------------------------------------------------
+    * Q15 complex multiply by conj-form twiddle, the
+    * result stays in Q15 (|z| < 1 keeps it in int32)
+    *-------------------------------------------------*/
+#define MUL_Q15_RE(z, w) \
+    ((((int32_t)(z)->re * (w)[0]) + ((int32_t)(z)->im * (w)[1]) + 0x4000) >> 15)
+#define MUL_Q15_IM(z, w) \
+    ((((int32_t)(z)->im * (w)[0]) - ((int32_t)(z)->re * (w)[1]) + 0x4000) >> 15)
+
+   /*--------------------------------------------------
+    * Q15 FFT, same structure as fft_cf32()
+    * radix-2 pass scales by 1/2, radix-4 pass by 1/4
+    *-------------------------------------------------*/
+void fft_cq15(fft_cq15_t *x, uint32_t n)
+{
+    uint32_t h;
+    uint32_t j;
+    uint32_t b;
+
+    BIT_REVERSE(x, n, fft_cq15_t);
+
+    h = 1U;
+
+    if ((log2_u32(n) & 1U) != 0U)
+    {
+        for (b = 0U; b < n; b += 2U)
+        {
+            int32_t ar = x[b].re;
+            int32_t ai = x[b].im;
+            int32_t br = x[b + 1U].re;
+            int32_t bi = x[b + 1U].im;
+
+            x[b].re      = (int16_t)((ar + br) >> 1);
+            x[b].im      = (int16_t)((ai + bi) >> 1);
+            x[b + 1U].re = (int16_t)((ar - br) >> 1);
+            x[b + 1U].im = (int16_t)((ai - bi) >> 1);
+        }
+        h = 2U;
+    }
+
+    for (; (4U * h) <= n; h *= 4U)
+    {
+        uint32_t stride = FFT_N_MAX / (4U * h);
+
+        for (j = 0U; j < h; j++)
+        {
+            const int16_t *w1 = &fft_twiddle_q15[2U * (j * stride)];
+            const int16_t *w2 = &fft_twiddle_q15[2U * (2U * j * stride)];
+            const int16_t *w3 = &fft_twiddle_q15[2U * (3U * j * stride)];
+
+            for (b = j; b < n; b += 4U * h)
+            {
+                fft_cq15_t *pa = &x[b];
+                fft_cq15_t *pb = &x[b + h];
+                fft_cq15_t *pc = &x[b + 2U * h];
+                fft_cq15_t *pd = &x[b + 3U * h];
+
+                int32_t b1r = MUL_Q15_RE(pb, w2);
+                int32_t b1i = MUL_Q15_IM(pb, w2);
+                int32_t c1r = MUL_Q15_RE(pc, w1);
+                int32_t c1i = MUL_Q15_IM(pc, w1);
+                int32_t d1r = MUL_Q15_RE(pd, w3);
+                int32_t d1i = MUL_Q15_IM(pd, w3);
+
+                int32_t t0r = pa->re + b1r;
+                int32_t t0i = pa->im + b1i;
+                int32_t t1r = pa->re - b1r;
+                int32_t t1i = pa->im - b1i;
+                int32_t t2r = c1r + d1r;
+                int32_t t2i = c1i + d1i;
+                int32_t t3r = c1r - d1r;
+                int32_t t3i = c1i - d1i;
+
+                pa->re = (int16_t)((t0r + t2r) >> 2);
+                pa->im = (int16_t)((t0i + t2i) >> 2);
+                pb->re = (int16_t)((t1r + t3i) >> 2);
+                pb->im = (int16_t)((t1i - t3r) >> 2);
+                pc->re = (int16_t)((t0r - t2r) >> 2);
+                pc->im = (int16_t)((t0i - t2i) >> 2);
+                pd->re = (int16_t)((t1r - t3i) >> 2);
+                pd->im = (int16_t)((t1i + t3r) >> 2);
+            }
+        }
+    }
+}
+
+   /*--------------------------------------------------
+    * Window value at index i of an n point frame
+    * Hann     : 0.5  - 0.5 cos(a)
+    * Blackman : 0.42 - 0.5 cos(a) + 0.08 cos(2a)
+    *-------------------------------------------------*/
+static float window_value(uint32_t i, uint32_t n, fft_window_t type)
+{
+    uint32_t m = i * (FFT_N_MAX / n);
+
+    switch (type)
+    {
+    case FFT_WINDOW_HANN:
+        return 0.5f - 0.5f * cos_f32(m);
+
+    case FFT_WINDOW_BLACKMAN:
+        return 0.42f - 0.5f * cos_f32(m) + 0.08f * cos_f32(2U * m);
+
+    case FFT_WINDOW_RECT:
+    default:
+        return 1.0f;
+    }
+}
+
+uint32_t fft_window_f32(float *w, uint32_t n, fft_window_t type)
+{
+    float sum = 0.0f;
+    uint32_t i;
+
+    for (i = 0U; i < n; i++)
+    {
+        w[i] = window_value(i, n, type);
+        sum += w[i];
+    }
+
+    return (uint32_t)((sum * 32768.0f) / (float)n + 0.5f);
+}
+
+uint32_t fft_window_q15(int16_t *w, uint32_t n, fft_window_t type)
+{
+    uint32_t sum = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < n; i++)
+    {
+        int32_t q = (int32_t)(window_value(i, n, type) * 32768.0f + 0.5f);
+
+        if (q > 32767)
+        {
+            q = 32767;                         /* 1.0 is not representable */
+        }
+        if (q < 0)
+        {
+            q = 0;                             /* Blackman rounds to -0 at the edges */
+        }
+
+        w[i] = (int16_t)q;
+        sum += (uint32_t)q;
+    }
+
+    return (sum + (n / 2U)) / n;
+}
@@ -0,0 +1,63 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * In-place complex FFT, float and Q15
+    *
+    * n must be a power of two, 4 <= n <= FFT_N_MAX.
+    * Input is bit-reversed, then radix-4 DIT passes run
+    * (one radix-2 pass first when log2(n) is odd).
+    *
+    * Twiddles come from the flash tables in
+    * fft_tables.c (tools/gen_fft_tables.py).
+    *-------------------------------------------------*/
+
+#define FFT_N_MAX        2048U
+#define FFT_TWIDDLE_LEN  ((3U * FFT_N_MAX) / 4U)
+
+typedef struct
+{
+    float re;
+    float im;
+} fft_cf32_t;
+
+typedef struct
+{
+    int16_t re;
+    int16_t im;
+} fft_cq15_t;
+
+typedef enum
+{
+    FFT_WINDOW_RECT = 0,
+    FFT_WINDOW_HANN,
+    FFT_WINDOW_BLACKMAN
+} fft_window_t;
+
+/* {cos, sin} pairs of 2*pi*m/FFT_N_MAX */
+extern const float   fft_twiddle_f32[2U * FFT_TWIDDLE_LEN];
+extern const int16_t fft_twiddle_q15[2U * FFT_TWIDDLE_LEN];
+
+   /*--------------------------------------------------
+    * Float FFT, unscaled: X[k] = sum x[n] W^nk
+    *-------------------------------------------------*/
+void fft_cf32(fft_cf32_t *x, uint32_t n);
+
+   /*--------------------------------------------------
+    * Q15 FFT, scaled by 1/n (each pass divides by its
+    * radix). Input magnitude must stay below 1.0 so no
+    * pass can overflow.
+    *-------------------------------------------------*/
+void fft_cq15(fft_cq15_t *x, uint32_t n);
+
+   /*--------------------------------------------------
+    * Fill w[0..n-1] with a periodic window.
+    * Return value is the coherent gain sum(w)/n in
+    * Q15, needed to turn bin magnitude into amplitude.
+    *-------------------------------------------------*/
+uint32_t fft_window_f32(float *w, uint32_t n, fft_window_t type);
+uint32_t fft_window_q15(int16_t *w, uint32_t n, fft_window_t type);
+
+#endif /* FFT_H */
@@ -0,0 +1,501 @@
+#include "stm32f4xx.h"
+#include "fft.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Spectrum analysis of PA0 (ADC1 channel 0)
+    *
+    * TIM2 TRGO triggers ADC1 at FS_HZ, DMA2 Stream0
+    * writes the samples into a circular ring. Every
+    * FFT_HOP new samples the last FFT_N samples are
+    * taken as a frame (FFT_OVERLAP samples shared with
+    * the previous frame):
+    *
+    *   DC removal -> window -> FFT -> power -> peaks
+    *
+    * Only a one-line summary per frame goes out on
+    * USART2 (PA2 TX, AF7): the FFT_PEAKS strongest
+    * peaks plus the cycles the frame took, measured
+    * with DWT CYCCNT against the budget of one hop.
+    *
+    * FFT_USE_Q15 = 1 selects the fixed-point FFT,
+    * 0 the float FFT (Cortex-M4 FPU).
+    *-------------------------------------------------*/
+
+#define FS_HZ        8000U
+#define FFT_N        1024U                     /* 256 .. 2048, power of two */
+#define FFT_OVERLAP  (FFT_N / 2U)              /* samples shared by frames */
+#define FFT_HOP      (FFT_N - FFT_OVERLAP)
+#define FFT_WINDOW   FFT_WINDOW_HANN
+#define FFT_USE_Q15  0
+#define FFT_PEAKS    3U
+
+   /*--------------------------------------------------
+    * Ring of 4 frames. HT/TC wake the main loop every
+    * 2 frames, which leaves one frame of slack before
+    * the DMA overwrites the oldest unread sample.
+    *-------------------------------------------------*/
+#define RING_LEN     (4U * FFT_N)
+
+_Static_assert((FFT_N & (FFT_N - 1U)) == 0U, "FFT_N must be a power of two");
+_Static_assert((FFT_N >= 256U) && (FFT_N <= FFT_N_MAX), "FFT_N out of range");
+_Static_assert(FFT_OVERLAP < FFT_N, "overlap must leave a hop of at least one sample");
+_Static_assert((SCLK % FS_HZ) == 0U, "FS_HZ must divide the timer clock");
+
+#if FFT_USE_Q15
+typedef fft_cq15_t sample_t;
+typedef int16_t    window_t;
+typedef uint32_t   power_t;
+#else
+typedef fft_cf32_t sample_t;
+typedef float      window_t;
+typedef float      power_t;
+#endif
+
+volatile uint16_t adc_ring[RING_LEN];
+volatile uint32_t dma_events = 0;              /* HT + TC count */
+
+static sample_t fft_buf[FFT_N];
+static window_t window[FFT_N];
+static power_t  power[FFT_N / 2U];
+static uint32_t window_gain;                   /* coherent gain, Q15 */
+
+typedef struct
+{
+    uint32_t bin;
+    power_t  power;
+} peak_t;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * Square roots, only used for the reported peaks
+    * (peak search itself runs on power)
+    *-------------------------------------------------*/
+#if FFT_USE_Q15
+static uint32_t sqrt_u32(uint32_t v)
+{
+    uint32_t r = 0U;
+    uint32_t bit = 1UL << 30U;
+
+    while (bit > v)
+    {
+        bit >>= 2U;
+    }
+
+    while (bit != 0U)
+    {
+        if (v >= r + bit)
+        {
+            v -= r + bit;
+            r = (r >> 1U) + bit;
+        }
+        else
+        {
+            r >>= 1U;
+        }
+        bit >>= 2U;
+    }
+
+    return r;
+}
+#else
+static float sqrt_f32(float v)
+{
+    float r;
+
+    __asm volatile ("vsqrt.f32 %0, %1" : "=t"(r) : "t"(v));
+    return r;
+}
+#endif
+
+   /*--------------------------------------------------
+    * DMA2 Stream0 interrupt handler
+    * Only wakes the main loop, the sample position is
+    * read from NDTR
+    *-------------------------------------------------*/
+void DMA2_Stream0_IRQHandler(void)
+{
+    uint32_t isr = DMA2->LISR;
+
+    DMA2->LIFCR = isr & (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 |
+                         DMA_LISR_DMEIF0 | DMA_LISR_FEIF0);
+
+    if (isr & DMA_LISR_HTIF0)
+    {
+        dma_events++;
+    }
+    if (isr & DMA_LISR_TCIF0)
+    {
+        dma_events++;
+    }
+}
+
+   /*--------------------------------------------------
+    * Ring bookkeeping
+    *
+    * produced counts samples written since start
+    * (mod 2^32). It advances by the NDTR delta, which is
+    * only unambiguous while less than RING_LEN samples
+    * pass between two calls; dma_events tells when that
+    * was not the case. Three or more HT / TC events are
+    * always a lost ring. Exactly two mean more than
+    * half a ring was written: a delta of half a ring
+    * or less is then one ring plus the delta.
+    *-------------------------------------------------*/
+static uint32_t produced = 0U;
+static uint32_t last_pos = 0U;
+static uint32_t last_events = 0U;
+static uint32_t next_frame = 0U;               /* first sample of next frame */
+static uint32_t frames_dropped = 0U;
+
+static void ring_update(void)
+{
+    uint32_t events;
+    uint32_t pos;
+    uint32_t delta;
+
+    /* an event between the two reads would skew the test below */
+    do
+    {
+        events = dma_events;
+        pos = (RING_LEN - DMA2_Stream0->NDTR) & (RING_LEN - 1U);
+    } while (events != dma_events);
+
+    delta = (pos - last_pos) & (RING_LEN - 1U);
+    produced += delta;
+    last_pos = pos;
+
+    if (((events - last_events) > 2U) ||
+        (((events - last_events) == 2U) && (delta <= (RING_LEN / 2U))))
+    {
+        /* lost a full ring: restart from the newest samples */
+        next_frame = produced;
+        frames_dropped++;
+    }
+    last_events = events;
+
+    if ((produced - next_frame) > (RING_LEN - FFT_N))
+    {
+        /* oldest frame is about to be overwritten */
+        next_frame = produced - FFT_N;
+        frames_dropped++;
+    }
+}
+
+   /*--------------------------------------------------
+    * Copy one frame out of the ring:
+    * remove the frame mean, apply the window
+    *-------------------------------------------------*/
+static void frame_load(uint32_t start)
+{
+    uint32_t sum = 0U;
+    int32_t mean;
+    uint32_t i;
+
+    for (i = 0U; i < FFT_N; i++)
+    {
+        sum += adc_ring[(start + i) & (RING_LEN - 1U)];
+    }
+    mean = (int32_t)(sum / FFT_N);
+
+    for (i = 0U; i < FFT_N; i++)
+    {
+        int32_t v = (int32_t)adc_ring[(start + i) & (RING_LEN - 1U)] - mean;
+
+#if FFT_USE_Q15
+        /* |v| <= 4095, << 3 is at most 32760: just inside Q15
+           full scale, no headroom, the FFT scales every pass */
+        fft_buf[i].re = (int16_t)(((v << 3) * window[i]) >> 15);
+        fft_buf[i].im = 0;
+#else
+        fft_buf[i].re = (float)v * window[i];
+        fft_buf[i].im = 0.0f;
+#endif
+    }
+}
+
+   /*--------------------------------------------------
+    * Power spectrum and the FFT_PEAKS largest local
+    * maxima (DC bin and Nyquist excluded)
+    *-------------------------------------------------*/
+static void spectrum_peaks(peak_t *peaks)
+{
+    uint32_t k;
+    uint32_t p;
+
+    for (k = 0U; k < (FFT_N / 2U); k++)
+    {
+#if FFT_USE_Q15
+        int32_t re = fft_buf[k].re;
+        int32_t im = fft_buf[k].im;
+
+        power[k] = (uint32_t)(re * re) + (uint32_t)(im * im);
+#else
+        power[k] = fft_buf[k].re * fft_buf[k].re + fft_buf[k].im * fft_buf[k].im;
+#endif
+    }
+
+    for (p = 0U; p < FFT_PEAKS; p++)
+    {
+        peaks[p].bin = 0U;
+        peaks[p].power = 0;
+    }
+
+    for (k = 2U; k < (FFT_N / 2U) - 1U; k++)
+    {
+        if ((power[k] > power[k - 1U]) && (power[k] >= power[k + 1U]) &&
+            (power[k] > peaks[FFT_PEAKS - 1U].power))
+        {
+            /* insertion into the sorted peak list */
+            p = FFT_PEAKS - 1U;
+            while ((p > 0U) && (power[k] > peaks[p - 1U].power))
+            {
+                peaks[p] = peaks[p - 1U];
+                p--;
+            }
+            peaks[p].bin = k;
+            peaks[p].power = power[k];
+        }
+    }
+}
+
+   /*--------------------------------------------------
+    * Sine amplitude in ADC counts for a bin power
+    * A = 2 |X| / (N * gain)  (float, unscaled FFT)
+    * A = 2 |X| / (8 * gain)  (Q15, FFT scaled by 1/N,
+    *                          input scaled by 8)
+    *-------------------------------------------------*/
+static uint32_t peak_amplitude(power_t pw)
+{
+#if FFT_USE_Q15
+    return (sqrt_u32(pw) * 8192U) / window_gain;
+#else
+    return (uint32_t)((2.0f * 32768.0f * sqrt_f32(pw)) /
+                      ((float)FFT_N * (float)window_gain));
+#endif
+}
+
+static void send_summary(const peak_t *peaks, uint32_t cycles, uint32_t cycles_max)
+{
+    uint32_t p;
+
+    usart2_send_string("FFT");
+
+    for (p = 0U; p < FFT_PEAKS; p++)
+    {
+        /* bin centre in 0.1 Hz */
+        uint32_t f10 = (peaks[p].bin * FS_HZ * 10U) / FFT_N;
+
+        usart2_send_string(" ");
+        usart2_send_u32(f10 / 10U);
+        usart2_send_char('.');
+        usart2_send_u32(f10 % 10U);
+        usart2_send_string("Hz:");
+        usart2_send_u32(peak_amplitude(peaks[p].power));
+    }
+
+    usart2_send_string(" cyc=");
+    usart2_send_u32(cycles);
+    usart2_send_string(" max=");
+    usart2_send_u32(cycles_max);
+    usart2_send_string(" bud=");
+    usart2_send_u32(FFT_HOP * (SCLK / FS_HZ));
+    usart2_send_string(" drop=");
+    usart2_send_u32(frames_dropped);
+    usart2_send_string("\r\n");
+}
+
+int main(void)
+{
+    peak_t peaks[FFT_PEAKS];
+    uint32_t cycles_max = 0U;
+
+   /*--------------------------------------------------
+    * 1) Enable GPIOA, DMA2 clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 TX / PA3 RX (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("ADC FFT spectrum\r\n");
+
+   /*--------------------------------------------------
+    * 3) PA0 analog input
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0;
+    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR0;
+
+   /*--------------------------------------------------
+    * 4) Window table and DWT cycle counter
+    *-------------------------------------------------*/
+#if FFT_USE_Q15
+    window_gain = fft_window_q15(window, FFT_N, FFT_WINDOW);
+#else
+    window_gain = fft_window_f32(window, FFT_N, FFT_WINDOW);
+#endif
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+   /*--------------------------------------------------
+    * 5) TIM2 update at FS_HZ, TRGO on update
+    *-------------------------------------------------*/
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+
+    TIM2->PSC = 0U;
+    TIM2->ARR = (SCLK / FS_HZ) - 1U;
+
+    TIM2->CR2 &= ~TIM_CR2_MMS;
+    TIM2->CR2 |=  TIM_CR2_MMS_1;               /* MMS = 010 update as TRGO */
+
+    TIM2->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 6) ADC1 ch0, TIM2 TRGO rising edge, DMA + DDS
+    *-------------------------------------------------*/
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+    ADC->CCR &= ~ADC_CCR_ADCPRE;
+    ADC->CCR |=  ADC_CCR_ADCPRE_0;             /* PCLK2/4 */
+
+    ADC1->SMPR2 &= ~ADC_SMPR2_SMP0;
+    ADC1->SMPR2 |=  (3U << ADC_SMPR2_SMP0_Pos); /* 56 cycles */
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;                 /* 1 conversion */
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;               /* channel 0 */
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN | ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    ADC1->CR2 |=  (6U << ADC_CR2_EXTSEL_Pos);  /* TIM2 TRGO */
+    ADC1->CR2 |=  ADC_CR2_EXTEN_0;             /* rising edge */
+    ADC1->CR2 |=  ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 7) DMA2 Stream0 channel 0: ADC1->DR to adc_ring
+    *    circular, 16-bit, HT + TC interrupts
+    *-------------------------------------------------*/
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN)
+    {
+        /* wait until disabled */
+    }
+
+    DMA2->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+    DMA2_Stream0->PAR  = (uint32_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)adc_ring;
+    DMA2_Stream0->NDTR = RING_LEN;
+
+    DMA2_Stream0->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC |
+                       DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+   /*--------------------------------------------------
+    * 8) Enable ADC and start TIM2
+    *-------------------------------------------------*/
+    ADC1->CR2 |= ADC_CR2_ADON;
+    TIM2->CR1 |= TIM_CR1_CEN;
+
+   /*--------------------------------------------------
+    * 9) Main loop: one FFT per hop, sleep otherwise
+    *-------------------------------------------------*/
+    while (1)
+    {
+        ring_update();
+
+        if ((produced - next_frame) >= FFT_N)
+        {
+            uint32_t t0 = DWT->CYCCNT;
+            uint32_t cycles;
+
+            frame_load(next_frame);
+            next_frame += FFT_HOP;
+
+#if FFT_USE_Q15
+            fft_cq15(fft_buf, FFT_N);
+#else
+            fft_cf32(fft_buf, FFT_N);
+#endif
+            spectrum_peaks(peaks);
+
+            cycles = DWT->CYCCNT - t0;
+            if (cycles > cycles_max)
+            {
+                cycles_max = cycles;
+            }
+
+            send_summary(peaks, cycles, cycles_max);
+            continue;
+        }
+
+        /* sleep with PRIMASK set so a DMA event between the
+           check above and WFI still wakes the core */
+        __disable_irq();
+        if (dma_events == last_events)
+        {
+            __WFI();
+        }
+        __enable_irq();
+    }
+}
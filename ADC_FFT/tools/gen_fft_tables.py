@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""
+Generate src/fft_tables.c (twiddle factors for fft.c).
+
+The firmware links without libm, so sin/cos are precomputed here and
+placed in flash as const tables.
+
+  W^m = cos(2*pi*m/N_MAX) - j*sin(2*pi*m/N_MAX),  0 <= m < 3*N_MAX/4
+
+The radix-4 butterflies need W^j, W^2j and W^3j of a stage, so the
+table covers three quarters of the circle. Entries are stored as
+interleaved {cos, sin} pairs, once as float and once as Q15.
+
+usage: python3 tools/gen_fft_tables.py > src/fft_tables.c
+"""
+import math
+
+N_MAX = 2048
+LEN = 3 * N_MAX // 4
+PER_LINE = 4
+
+
+def q15(v):
+    return max(-32768, min(32767, int(round(v * 32768.0))))
+
+
+def emit(name, ctype, pairs, fmt):
+    print("const %s %s[2U * FFT_TWIDDLE_LEN] =" % (ctype, name))
+    print("{")
+    for i in range(0, len(pairs), PER_LINE):
+        chunk = pairs[i:i + PER_LINE]
+        print("    " + " ".join("%s, %s," % (fmt(c), fmt(s)) for c, s in chunk))
+    print("};")
+
+
+def main():
+    tw = [(math.cos(2.0 * math.pi * m / N_MAX), math.sin(2.0 * math.pi * m / N_MAX))
+          for m in range(LEN)]
+
+    print("/* generated by tools/gen_fft_tables.py, do not edit */")
+    print("#include \"fft.h\"")
+    print("")
+    print("#if (FFT_N_MAX != %dU)" % N_MAX)
+    print("#error \"fft_tables.c generated for a different FFT_N_MAX\"")
+    print("#endif")
+    print("")
+    emit("fft_twiddle_f32", "float", tw, lambda v: "%.9ef" % v)
+    print("")
+    emit("fft_twiddle_q15", "int16_t", [(q15(c), q15(s)) for c, s in tw],
+         lambda v: "%6d" % v)
+
+
+if __name__ == "__main__":
+    main()
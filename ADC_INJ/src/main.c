@@ -0,0 +1,332 @@
+#include "stm32f4xx.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * ADC1 injected channel next to the regular stream
+    *
+    * Regular group : PA0 (ch0), TIM2 TRGO at REG_HZ,
+    *                 DMA2 Stream0 circular into adc_buf
+    * Injected group: PA1 (ch1), TIM1 CC4 (JEXTSEL 0000)
+    *                 JEOC interrupt
+    *
+    * TIM1 CH1 drives a PWM on PA8 (AF1). CC4 fires in
+    * the middle of the high phase, which is where a
+    * shunt current sense is usually taken. An injected
+    * trigger interrupts a running regular conversion,
+    * the regular one is restarted afterwards, so the
+    * DMA stream keeps running untouched.
+    *
+    * Latency trigger -> JEOC ISR is read from TIM1->CNT
+    * (TIM1 runs at SCLK, so the unit is CPU cycles).
+    * Statistics go out on USART2 twice a second.
+    *-------------------------------------------------*/
+
+#define REG_HZ       1000U
+#define ADC_BUF_LEN  1000U                     /* HT/TC every 0.5 s */
+
+#define PWM_HZ       20000U
+#define PWM_PERIOD   (SCLK / PWM_HZ)           /* TIM1 ticks */
+#define PWM_DUTY     (PWM_PERIOD / 2U)
+#define INJ_POINT    (PWM_DUTY / 2U)           /* CCR4, middle of the high phase */
+
+volatile uint16_t adc_buf[ADC_BUF_LEN];
+volatile uint32_t dma_half_flag = 0;
+volatile uint32_t dma_full_flag = 0;
+
+   /*--------------------------------------------------
+    * Injected conversion statistics
+    * written by ADC_IRQHandler, read with IRQs masked
+    *-------------------------------------------------*/
+typedef struct
+{
+    uint32_t count;
+    uint16_t last;                             /* last JDR1 value */
+    uint32_t lat_last;                         /* cycles */
+    uint32_t lat_min;
+    uint32_t lat_max;
+    uint32_t lat_sum;
+} inj_stats_t;
+
+static volatile inj_stats_t inj_stats = { 0U, 0U, 0U, 0xFFFFFFFFU, 0U, 0U };
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * ADC interrupt handler, injected end of conversion
+    *-------------------------------------------------*/
+void ADC_IRQHandler(void)
+{
+    if (ADC1->SR & ADC_SR_JEOC)
+    {
+        uint32_t cnt = TIM1->CNT;
+        uint32_t lat = (cnt + PWM_PERIOD - INJ_POINT) % PWM_PERIOD;
+
+        ADC1->SR = ~(ADC_SR_JEOC | ADC_SR_JSTRT);  /* rc_w0 */
+
+        inj_stats.last = (uint16_t)ADC1->JDR1;
+        inj_stats.lat_last = lat;
+        inj_stats.lat_sum += lat;
+        inj_stats.count++;
+
+        if (lat < inj_stats.lat_min)
+        {
+            inj_stats.lat_min = lat;
+        }
+        if (lat > inj_stats.lat_max)
+        {
+            inj_stats.lat_max = lat;
+        }
+    }
+}
+
+   /*--------------------------------------------------
+    * DMA2 Stream0 interrupt handler (regular stream)
+    *-------------------------------------------------*/
+void DMA2_Stream0_IRQHandler(void)
+{
+    uint32_t isr = DMA2->LISR;
+
+    DMA2->LIFCR = isr & (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 |
+                         DMA_LISR_DMEIF0 | DMA_LISR_FEIF0);
+
+    if (isr & DMA_LISR_HTIF0)
+    {
+        dma_half_flag = 1U;
+    }
+    if (isr & DMA_LISR_TCIF0)
+    {
+        dma_full_flag = 1U;
+    }
+}
+
+static void report(uint32_t first)
+{
+    inj_stats_t s;
+    uint32_t sum = 0U;
+    uint32_t i;
+
+    for (i = first; i < first + (ADC_BUF_LEN / 2U); i++)
+    {
+        sum += (uint32_t)adc_buf[i];
+    }
+
+    __disable_irq();
+    s = inj_stats;
+    inj_stats.count = 0U;
+    inj_stats.lat_sum = 0U;
+    inj_stats.lat_min = 0xFFFFFFFFU;
+    inj_stats.lat_max = 0U;
+    __enable_irq();
+
+    usart2_send_string("REG avg=");
+    usart2_send_u32(sum / (ADC_BUF_LEN / 2U));
+    usart2_send_string(" INJ n=");
+    usart2_send_u32(s.count);
+    usart2_send_string(" val=");
+    usart2_send_u32(s.last);
+
+    if (s.count != 0U)
+    {
+        usart2_send_string(" lat min/avg/max=");
+        usart2_send_u32(s.lat_min);
+        usart2_send_char('/');
+        usart2_send_u32(s.lat_sum / s.count);
+        usart2_send_char('/');
+        usart2_send_u32(s.lat_max);
+    }
+    usart2_send_string("\r\n");
+}
+
+int main(void)
+{
+   /*--------------------------------------------------
+    * 1) Clocks: GPIOA, DMA2, TIM2, USART2, TIM1, ADC1
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN | RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN | RCC_APB2ENR_ADC1EN;
+
+   /*--------------------------------------------------
+    * 2) Pins
+    *    PA0, PA1 analog
+    *    PA2, PA3 AF7 (USART2)
+    *    PA8 AF1 (TIM1_CH1)
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0 | GPIO_MODER_MODER1;
+    GPIOA->PUPDR &= ~(GPIO_PUPDR_PUPDR0 | GPIO_PUPDR_PUPDR1);
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3 | GPIO_MODER_MODER8);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1 | GPIO_MODER_MODER8_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+    GPIOA->AFR[1] &= ~(0xFU << ((8U - 8U) * 4U));
+    GPIOA->AFR[1] |=  (1U   << ((8U - 8U) * 4U));
+
+   /*--------------------------------------------------
+    * 3) USART2
+    *-------------------------------------------------*/
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("ADC1 injected + regular DMA\r\n");
+
+   /*--------------------------------------------------
+    * 4) TIM2: regular trigger, TRGO on update
+    *-------------------------------------------------*/
+    TIM2->PSC = 16U - 1U;                      /* 1 MHz */
+    TIM2->ARR = (1000000U / REG_HZ) - 1U;
+    TIM2->CR2 &= ~TIM_CR2_MMS;
+    TIM2->CR2 |=  TIM_CR2_MMS_1;               /* MMS = 010 update as TRGO */
+    TIM2->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 5) TIM1: PWM on CH1, CC4 as injected trigger
+    *    OC1M = OC4M = 110 (PWM mode 1), preload on
+    *-------------------------------------------------*/
+    TIM1->PSC = 0U;
+    TIM1->ARR = PWM_PERIOD - 1U;
+    TIM1->CCR1 = PWM_DUTY;
+    TIM1->CCR4 = INJ_POINT;
+
+    TIM1->CCMR1 &= ~(TIM_CCMR1_OC1M | TIM_CCMR1_CC1S);
+    TIM1->CCMR1 |=  (6U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE;
+    TIM1->CCMR2 &= ~(TIM_CCMR2_OC4M | TIM_CCMR2_CC4S);
+    TIM1->CCMR2 |=  (6U << TIM_CCMR2_OC4M_Pos) | TIM_CCMR2_OC4PE;
+
+    TIM1->CCER |= TIM_CCER_CC1E | TIM_CCER_CC4E;  /* CH4 (PA11) left unconfigured: internal trigger only */
+    TIM1->BDTR |= TIM_BDTR_MOE;
+    TIM1->CR1 |= TIM_CR1_ARPE;
+    TIM1->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 6) ADC1
+    *    regular : 1 conversion ch0, EXTSEL 0110 TIM2
+    *              TRGO, DMA + DDS
+    *    injected: JL = 0 -> only JSQ4 is converted,
+    *              JSQ4 = ch1, JEXTSEL 0000 TIM1 CC4
+    *-------------------------------------------------*/
+    ADC->CCR &= ~ADC_CCR_ADCPRE;
+    ADC->CCR |=  ADC_CCR_ADCPRE_0;             /* PCLK2/4 */
+
+    ADC1->SMPR2 &= ~(ADC_SMPR2_SMP0 | ADC_SMPR2_SMP1);
+    ADC1->SMPR2 |=  (3U << ADC_SMPR2_SMP0_Pos); /* 56 cycles, background */
+    ADC1->SMPR2 |=  (0U << ADC_SMPR2_SMP1_Pos); /* 3 cycles, low latency */
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;
+
+    ADC1->JSQR = (1U << ADC_JSQR_JSQ4_Pos);    /* JL = 0, JSQ4 = ch1 */
+
+    ADC1->CR1 &= ~(ADC_CR1_EOCIE | ADC_CR1_JAUTO | ADC_CR1_SCAN);
+    ADC1->CR1 |=  ADC_CR1_JEOCIE;
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN |
+                   ADC_CR2_EXTSEL | ADC_CR2_EXTEN |
+                   ADC_CR2_JEXTSEL | ADC_CR2_JEXTEN);
+    ADC1->CR2 |=  (6U << ADC_CR2_EXTSEL_Pos) | ADC_CR2_EXTEN_0;   /* TIM2 TRGO rising */
+    ADC1->CR2 |=  (0U << ADC_CR2_JEXTSEL_Pos) | ADC_CR2_JEXTEN_0; /* TIM1 CC4 rising */
+    ADC1->CR2 |=  ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 7) DMA2 Stream0 channel 0: ADC1->DR to adc_buf
+    *-------------------------------------------------*/
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN)
+    {
+        /* wait until disabled */
+    }
+
+    DMA2->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+    DMA2_Stream0->PAR  = (uint32_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)adc_buf;
+    DMA2_Stream0->NDTR = ADC_BUF_LEN;
+
+    DMA2_Stream0->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC |
+                       DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    NVIC_EnableIRQ(ADC_IRQn);
+
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+   /*--------------------------------------------------
+    * 8) Enable ADC, start both timers
+    *-------------------------------------------------*/
+    ADC1->SR = 0U;
+    ADC1->CR2 |= ADC_CR2_ADON;
+
+    TIM2->CR1 |= TIM_CR1_CEN;
+    TIM1->CR1 |= TIM_CR1_CEN;
+
+   /*--------------------------------------------------
+    * 9) Main loop
+    *-------------------------------------------------*/
+    while (1)
+    {
+        if (dma_half_flag)
+        {
+            dma_half_flag = 0U;
+            report(0U);
+        }
+
+        if (dma_full_flag)
+        {
+            dma_full_flag = 0U;
+            report(ADC_BUF_LEN / 2U);
+        }
+
+        __disable_irq();
+        if (!dma_half_flag && !dma_full_flag)
+        {
+            __WFI();
+        }
+        __enable_irq();
+    }
+}
@@ -0,0 +1,439 @@
+#include "stm32f4xx.h"
+#include "sample_clock.h"
+#include "spsc.h"
+#include "irq.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Runtime ADC sample-rate changes without glitches
+    *
+    * TIM2 TRGO triggers ADC1 (PA0), DMA2 Stream0 runs
+    * circular into adc_buf. Type a rate in Hz on
+    * USART2 followed by Enter to change it on the fly,
+    * e.g. "250000<CR>".
+    *
+    * The block consumer knows the absolute index of
+    * every sample (DMA position plus the TIM5 trigger
+    * count), reports halves it was too slow for, and
+    * prints each rate change at the sample (and time)
+    * where it took effect. Block averages are printed
+    * about twice a second.
+    *-------------------------------------------------*/
+
+#define START_HZ     1000U
+#define ADC_BUF_LEN  1024U
+#define HALF_LEN     (ADC_BUF_LEN / 2U)
+
+volatile uint16_t adc_buf[ADC_BUF_LEN];
+volatile uint32_t dma_half_flag = 0;
+volatile uint32_t dma_full_flag = 0;
+
+static uint8_t rx_buf[32];
+static spsc_bytes_t rx_q;                      /* USART2 RX ISR -> main */
+
+   /*--------------------------------------------------
+    * Interrupt priorities: 2 preemption bits. DMA
+    * completion must preempt USART servicing, so a
+    * burst of typed bytes never delays the half
+    * buffer handoff. Budgets in CPU cycles.
+    *-------------------------------------------------*/
+static const irq_cfg_t irqs[] =
+{
+    { DMA2_Stream0_IRQn, 0U, 0U, 300U, "DMA2_Stream0" },
+    { USART2_IRQn,       2U, 0U, 200U, "USART2"       },
+};
+
+static const irq_rule_t irq_rules[] =
+{
+    { DMA2_Stream0_IRQn, USART2_IRQn },
+};
+
+static const irq_table_t irq_table =
+{
+    .preempt_bits = 2U,
+    .irqs         = irqs,
+    .n_irqs       = sizeof(irqs) / sizeof(irqs[0]),
+    .rules        = irq_rules,
+    .n_rules      = sizeof(irq_rules) / sizeof(irq_rules[0]),
+};
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * DMA2 Stream0 interrupt handler
+    *-------------------------------------------------*/
+void DMA2_Stream0_IRQHandler(void)
+{
+    uint32_t isr = DMA2->LISR;
+
+    DMA2->LIFCR = isr & (DMA_LISR_TCIF0 | DMA_LISR_HTIF0 | DMA_LISR_TEIF0 |
+                         DMA_LISR_DMEIF0 | DMA_LISR_FEIF0);
+
+    if (isr & DMA_LISR_HTIF0)
+    {
+        dma_half_flag = 1U;
+    }
+    if (isr & DMA_LISR_TCIF0)
+    {
+        dma_full_flag = 1U;
+    }
+}
+
+   /*--------------------------------------------------
+    * USART2 RX interrupt: bytes into rx_q, so typing
+    * while a report is being printed loses nothing
+    *-------------------------------------------------*/
+void USART2_IRQHandler(void)
+{
+    if (USART2->SR & USART_SR_RXNE)
+    {
+        (void)spsc_bytes_put(&rx_q, (uint8_t)USART2->DR);
+    }
+}
+
+static void send_rate(uint32_t period)
+{
+    uint32_t mhz = sample_clock_rate_mhz(period);
+
+    usart2_send_u32(mhz / 1000U);
+    usart2_send_char('.');
+    usart2_send_char((char)('0' + (mhz / 100U) % 10U));
+    usart2_send_char((char)('0' + (mhz / 10U) % 10U));
+    usart2_send_char((char)('0' + mhz % 10U));
+    usart2_send_string("Hz");
+}
+
+   /*--------------------------------------------------
+    * Handlers over their cycle budget since the last
+    * report
+    *-------------------------------------------------*/
+static void report_irqs(void)
+{
+    static uint32_t seen = 0U;
+    const irq_stats_t *st = irq_last_overrun();
+    uint32_t n = irq_overruns();
+
+    if ((n == seen) || (st == 0))
+    {
+        return;
+    }
+    seen = n;
+
+    usart2_send_string("IRQ ");
+    usart2_send_string(st->cfg->name);
+    usart2_send_string(" over budget: max ");
+    usart2_send_u32(st->max_cycles);
+    usart2_send_string(" cycles, budget ");
+    usart2_send_u32(st->cfg->budget_cycles);
+    usart2_send_string("\r\n");
+}
+
+   /*--------------------------------------------------
+    * Samples written to adc_buf so far. NDTR gives the
+    * position in the ring, the TIM5 trigger count the
+    * lap: it is ahead of the DMA by at most the
+    * conversion in flight. NDTR is read first, so the
+    * count can never be behind it.
+    *-------------------------------------------------*/
+static uint32_t dma_written(void)
+{
+    uint32_t pos = (ADC_BUF_LEN - DMA2_Stream0->NDTR) % ADC_BUF_LEN;
+    uint32_t n = sample_clock_count();
+
+    return n - ((n - pos) % ADC_BUF_LEN);
+}
+
+   /*--------------------------------------------------
+    * Block consumer
+    *
+    * consumed is the absolute index of the first
+    * sample in the block. Rate changes inside the
+    * block are reported with their sample index.
+    *-------------------------------------------------*/
+static uint32_t consumed = 0U;
+static uint64_t print_ticks = 0U;              /* sample time since last print */
+static sample_clock_change_t pending;
+static uint32_t have_pending = 0U;
+
+static void process_block(void)
+{
+    uint32_t first = consumed % ADC_BUF_LEN;
+    uint32_t end = consumed + HALF_LEN;
+    uint32_t sum = 0U;
+    uint32_t i;
+
+    for (i = first; i < first + HALF_LEN; i++)
+    {
+        sum += (uint32_t)adc_buf[i];
+    }
+
+    for (;;)
+    {
+        if (!have_pending)
+        {
+            have_pending = sample_clock_pop(&pending);
+        }
+
+        if (!have_pending || ((int32_t)(pending.sample - end) >= 0))
+        {
+            break;
+        }
+
+        usart2_send_string("RATE ");
+        send_rate(pending.period);
+        usart2_send_string(" from sample ");
+        usart2_send_u32(pending.sample);
+        usart2_send_string(" t=");
+        usart2_send_u32((uint32_t)(pending.t_ticks / (SCLK / 1000000U)));
+        usart2_send_string("us\r\n");
+
+        have_pending = 0U;
+    }
+
+    consumed = end;
+    print_ticks += (uint64_t)HALF_LEN * sample_clock_period();
+
+    if (print_ticks >= (SCLK / 2U))
+    {
+        print_ticks = 0U;
+
+        report_irqs();
+
+        usart2_send_string("AVG=");
+        usart2_send_u32(sum / HALF_LEN);
+        usart2_send_string(" n=");
+        usart2_send_u32(consumed);
+        usart2_send_string(" @ ");
+        send_rate(sample_clock_period());
+        usart2_send_string("\r\n");
+    }
+}
+
+   /*--------------------------------------------------
+    * Every complete half since the last call. HT and
+    * TC only wake the loop: while a report is being
+    * printed the DMA can finish more than one half and
+    * the flags do not count them. If the consumer fell
+    * more than one half behind, the older halves are
+    * already overwritten; they are skipped and
+    * consumed moves on to the newest complete half.
+    *-------------------------------------------------*/
+static void consume_blocks(void)
+{
+    uint32_t done = dma_written() & ~(HALF_LEN - 1U);
+
+    if ((done - consumed) > HALF_LEN)
+    {
+        uint32_t skipped = done - HALF_LEN - consumed;
+
+        usart2_send_string("SKIP ");
+        usart2_send_u32(skipped);
+        usart2_send_string(" samples from ");
+        usart2_send_u32(consumed);
+        usart2_send_string("\r\n");
+
+        print_ticks += (uint64_t)skipped * sample_clock_period();
+        consumed = done - HALF_LEN;
+    }
+
+    while (consumed != done)
+    {
+        process_block();
+    }
+}
+
+   /*--------------------------------------------------
+    * Non-blocking line input: digits, then CR/LF
+    *-------------------------------------------------*/
+static void poll_command(void)
+{
+    static uint32_t value = 0U;
+    uint8_t b;
+    char c;
+
+    if (spsc_bytes_read(&rx_q, &b, 1U) == 0U)
+    {
+        return;
+    }
+
+    c = (char)b;
+
+    if ((c >= '0') && (c <= '9'))
+    {
+        value = value * 10U + (uint32_t)(c - '0');
+    }
+    else if ((c == '\r') || (c == '\n'))
+    {
+        if (value != 0U)
+        {
+            uint32_t period = sample_clock_set(value);
+
+            usart2_send_string("set ");
+            send_rate(period);
+            usart2_send_string("\r\n");
+        }
+        value = 0U;
+    }
+    else
+    {
+        value = 0U;
+    }
+}
+
+int main(void)
+{
+    uint32_t bad = 0U;
+    int irq_err;
+
+   /*--------------------------------------------------
+    * 1) Clocks, interrupt priorities before any IRQ
+    *    is enabled
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_DMA2EN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+    irq_err = irq_setup(&irq_table, &bad);
+
+   /*--------------------------------------------------
+    * 2) PA0 analog, USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0;
+    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR0;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_RXNEIE | USART_CR1_UE;
+
+    spsc_bytes_init(&rx_q, rx_buf, sizeof(rx_buf));
+    NVIC_EnableIRQ(USART2_IRQn);
+
+    usart2_send_string("ADC sample clock, type rate in Hz\r\n");
+
+    if (irq_err != IRQ_OK)
+    {
+        usart2_send_string("IRQ table entry ");
+        usart2_send_u32(bad);
+        usart2_send_string(" rejected\r\n");
+        while (1)
+        {
+            /* stop */
+        }
+    }
+
+   /*--------------------------------------------------
+    * 3) Sample clock (TIM2 + TIM5 sample counter)
+    *-------------------------------------------------*/
+    sample_clock_init(START_HZ);
+
+   /*--------------------------------------------------
+    * 4) ADC1: ADCCLK = PCLK2/2 (8 MHz), 3 cycle
+    *    sampling -> 15 ADCCLK = 30 CPU cycles per
+    *    conversion, enough for SAMPLE_CLOCK_MIN_PERIOD
+    *-------------------------------------------------*/
+    ADC->CCR &= ~ADC_CCR_ADCPRE;               /* PCLK2/2 */
+
+    ADC1->SMPR2 &= ~ADC_SMPR2_SMP0;            /* 3 cycles */
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;
+
+    ADC1->CR1 &= ~ADC_CR1_EOCIE;
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN | ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    ADC1->CR2 |=  (6U << ADC_CR2_EXTSEL_Pos) | ADC_CR2_EXTEN_0;   /* TIM2 TRGO */
+    ADC1->CR2 |=  ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 5) DMA2 Stream0 channel 0: ADC1->DR to adc_buf
+    *-------------------------------------------------*/
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while (DMA2_Stream0->CR & DMA_SxCR_EN)
+    {
+        /* wait until disabled */
+    }
+
+    DMA2->LIFCR = DMA_LIFCR_CFEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0;
+
+    DMA2_Stream0->PAR  = (uint32_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)adc_buf;
+    DMA2_Stream0->NDTR = ADC_BUF_LEN;
+
+    DMA2_Stream0->CR = DMA_SxCR_CIRC | DMA_SxCR_MINC |
+                       DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 |
+                       DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    DMA2_Stream0->CR |= DMA_SxCR_EN;
+
+   /*--------------------------------------------------
+    * 6) Enable ADC, start the sample clock
+    *-------------------------------------------------*/
+    ADC1->CR2 |= ADC_CR2_ADON;
+    sample_clock_start();
+
+   /*--------------------------------------------------
+    * 7) Main loop
+    *-------------------------------------------------*/
+    while (1)
+    {
+        poll_command();
+
+        if (dma_half_flag || dma_full_flag)
+        {
+            dma_half_flag = 0U;
+            dma_full_flag = 0U;
+            consume_blocks();
+        }
+    }
+}
@@ -0,0 +1,192 @@
+#include "stm32f4xx.h"
+#include "sample_clock.h"
+
+static uint32_t cur_period;                    /* last set, maybe still preloaded */
+static uint32_t act_period;                    /* running until sample last_sample */
+static uint32_t last_sample = 0U;              /* sample where cur_period began */
+static uint64_t last_t = 0U;                   /* its time, ticks from sample 0 */
+
+static sample_clock_change_t queue[SAMPLE_CLOCK_QUEUE_LEN];
+static uint32_t q_head = 0U;
+static uint32_t q_tail = 0U;
+
+static uint32_t period_for(uint32_t hz)
+{
+    uint32_t n;
+
+    if (hz == 0U)
+    {
+        hz = 1U;
+    }
+
+    n = (SAMPLE_CLOCK_HZ + (hz / 2U)) / hz;
+
+    if (n < SAMPLE_CLOCK_MIN_PERIOD)
+    {
+        n = SAMPLE_CLOCK_MIN_PERIOD;
+    }
+
+    return n;
+}
+
+void sample_clock_init(uint32_t hz)
+{
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN | RCC_APB1ENR_TIM5EN;
+
+    cur_period = period_for(hz);
+    act_period = cur_period;
+
+   /*--------------------------------------------------
+    * TIM2: PSC 0, ARR preloaded, TRGO = update
+    *-------------------------------------------------*/
+    TIM2->CR1 = TIM_CR1_ARPE;
+    TIM2->PSC = 0U;
+    TIM2->ARR = cur_period - 1U;
+    TIM2->CR2 = (TIM2->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+    TIM2->EGR = TIM_EGR_UG;                    /* load shadows, no TRGO yet */
+    TIM2->CNT = 0U;
+
+   /*--------------------------------------------------
+    * TIM5: external clock mode 1 on ITR0 (TIM2 TRGO)
+    *       counts sample triggers, free running
+    *-------------------------------------------------*/
+    TIM5->CR1 = 0U;
+    TIM5->PSC = 0U;
+    TIM5->ARR = 0xFFFFFFFFU;
+    TIM5->SMCR = (0U << TIM_SMCR_TS_Pos) | (7U << TIM_SMCR_SMS_Pos);
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->CNT = 0U;
+
+    last_sample = 0U;
+    last_t = 0U;
+    q_head = 0U;
+    q_tail = 0U;
+}
+
+void sample_clock_start(void)
+{
+    TIM5->CR1 |= TIM_CR1_CEN;
+    TIM2->CR1 |= TIM_CR1_CEN;
+}
+
+   /*--------------------------------------------------
+    * The ARR write must not race the update event,
+    * otherwise it is unknown which sample the new
+    * period starts at. It is done with IRQs masked
+    * and only while TIM2->CNT is at least GUARD ticks
+    * away from the reload on both sides.
+    *
+    * Samples 0..c-1 have been triggered, sample c is
+    * triggered by the next update, which also loads
+    * the new ARR: the gap after sample c is the new
+    * period.
+    *
+    * The guard is checked against the ARR that is
+    * running. While c is still last_sample the
+    * previous set has not reached its update yet and
+    * its ARR is only preloaded: act_period runs.
+    *-------------------------------------------------*/
+uint32_t sample_clock_set(uint32_t hz)
+{
+    uint32_t period = period_for(hz);
+    uint32_t primask;
+    uint32_t c;
+    sample_clock_change_t *e;
+
+    if (period == cur_period)
+    {
+        return period;
+    }
+
+    if ((TIM2->CR1 & TIM_CR1_CEN) == 0U)
+    {
+        /* not started yet: first update will use the new period */
+        TIM2->ARR = period - 1U;
+        TIM2->EGR = TIM_EGR_UG;
+        TIM2->CNT = 0U;
+        TIM5->CNT = 0U;
+        cur_period = period;
+        act_period = period;
+        return period;
+    }
+
+    primask = __get_PRIMASK();
+
+    for (;;)
+    {
+        uint32_t arr_old;
+        uint32_t cnt;
+
+        __disable_irq();
+        c = TIM5->CNT;
+        cnt = TIM2->CNT;                       /* an update in between leaves cnt < GUARD */
+        arr_old = ((c == last_sample) ? act_period : cur_period) - 1U;
+
+        if ((cnt >= SAMPLE_CLOCK_GUARD) && (cnt <= (arr_old - SAMPLE_CLOCK_GUARD)))
+        {
+            TIM2->ARR = period - 1U;
+            break;
+        }
+
+        __set_PRIMASK(primask);
+    }
+
+    __set_PRIMASK(primask);
+
+    if (c != last_sample)
+    {
+        act_period = cur_period;               /* the previous set has taken effect */
+    }
+
+    last_t += (uint64_t)(c - last_sample) * cur_period;
+    last_sample = c;
+    cur_period = period;
+
+   /*--------------------------------------------------
+    * Queue the change. Two changes inside one period
+    * start at the same sample, the later one wins.
+    *-------------------------------------------------*/
+    if ((q_head != q_tail) &&
+        (queue[(q_head - 1U) % SAMPLE_CLOCK_QUEUE_LEN].sample == c))
+    {
+        e = &queue[(q_head - 1U) % SAMPLE_CLOCK_QUEUE_LEN];
+    }
+    else
+    {
+        if ((q_head - q_tail) >= SAMPLE_CLOCK_QUEUE_LEN)
+        {
+            q_tail++;                          /* drop the oldest */
+        }
+        e = &queue[q_head % SAMPLE_CLOCK_QUEUE_LEN];
+        q_head++;
+    }
+
+    e->sample = c;
+    e->period = period;
+    e->t_ticks = last_t;
+
+    return period;
+}
+
+uint32_t sample_clock_pop(sample_clock_change_t *c)
+{
+    if (q_tail == q_head)
+    {
+        return 0U;
+    }
+
+    *c = queue[q_tail % SAMPLE_CLOCK_QUEUE_LEN];
+    q_tail++;
+
+    return 1U;
+}
+
+uint32_t sample_clock_count(void)
+{
+    return TIM5->CNT;
+}
+
+uint32_t sample_clock_period(void)
+{
+    return cur_period;
+}
@@ -0,0 +1,57 @@
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * ADC sample clock on TIM2 (TRGO on update)
+    *
+    * TIM2 is 32-bit, so PSC stays 0 and the period is
+    * round(SCLK / hz) timer ticks, which is the closest
+    * achievable rate. ARR is preloaded (ARPE), a new
+    * rate starts exactly at the next update event.
+    *
+    * TIM5 counts TIM2 TRGO pulses (slave external
+    * clock mode, ITR0), so every trigger has a sample
+    * index and each rate change is reported as
+    * "from sample N on, period P, at time T".
+    *-------------------------------------------------*/
+
+#define SAMPLE_CLOCK_HZ          16000000U     /* TIM2 clock, HSI */
+#define SAMPLE_CLOCK_MIN_PERIOD  32U           /* ~500 ksps, ADC at PCLK2/2 */
+#define SAMPLE_CLOCK_GUARD       10U           /* ticks kept clear of the update */
+#define SAMPLE_CLOCK_QUEUE_LEN   8U
+
+typedef struct
+{
+    uint32_t sample;                           /* first sample of the new period */
+    uint32_t period;                           /* TIM2 ticks between samples */
+    uint64_t t_ticks;                          /* trigger time of that sample */
+} sample_clock_change_t;
+
+   /*--------------------------------------------------
+    * Configure TIM2 / TIM5, timers left stopped
+    *-------------------------------------------------*/
+void sample_clock_init(uint32_t hz);
+void sample_clock_start(void);
+
+   /*--------------------------------------------------
+    * Change the rate (main context). Returns the
+    * period in ticks actually used.
+    *-------------------------------------------------*/
+uint32_t sample_clock_set(uint32_t hz);
+
+   /*--------------------------------------------------
+    * Pop the oldest pending change, 1 if one was there
+    *-------------------------------------------------*/
+uint32_t sample_clock_pop(sample_clock_change_t *c);
+
+uint32_t sample_clock_count(void);             /* samples triggered so far */
+uint32_t sample_clock_period(void);
+
+static inline uint32_t sample_clock_rate_mhz(uint32_t period)
+{
+    return (uint32_t)(((uint64_t)SAMPLE_CLOCK_HZ * 1000U + (period / 2U)) / period);
+}
+
+#endif /* SAMPLE_CLOCK_H */
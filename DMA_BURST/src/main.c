@@ -0,0 +1,420 @@
+#include "stm32f4xx.h"
+#include "dma.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * DMA FIFO / burst tuning: CPU slowdown from bus
+    * contention while ADC1 streams at full rate
+    *
+    * ADC1 (PA0) converts continuously at its maximum
+    * rate for this clock tree: ADCCLK = PCLK2/2 = 8 MHz,
+    * 3 + 12 cycles -> 533 ksps, one sample every 30
+    * CPU cycles. DMA2 writes the samples to SRAM with
+    * each mode in modes[] while the CPU runs a fixed
+    * SRAM read-modify-write workload, timed with DWT.
+    *
+    * The slowdown against the CPU-only run shows what
+    * each memory-side access pattern costs:
+    *   direct 16/16    one SRAM write per sample
+    *   FIFO   16->32   packing, one write per 2 samples
+    *   INCR4 / INCR8   one bus arbitration per burst
+    *
+    * The report itself goes out through DMA1 Stream6
+    * (USART2 TX) with 32-bit memory reads unpacked to
+    * bytes, one SRAM read per 4 characters.
+    *-------------------------------------------------*/
+
+#define ADC_RING_LEN  2048U                    /* samples */
+#define WORK_WORDS    4096U                    /* 16 KB workload buffer */
+#define WORK_PASSES   16U
+#define TX_BUF_LEN    128U                     /* bytes, multiple of 4 */
+
+typedef struct
+{
+    const char  *name;
+    dma_fifo_t   fifo;
+    dma_width_t  msize;
+    dma_burst_t  mburst;
+} adc_mode_t;
+
+static const adc_mode_t modes[] =
+{
+    { "direct 16/16 single ", DMA_FIFO_DIRECT, DMA_WIDTH_16, DMA_BURST_SINGLE },
+    { "fifo1/2 16/32 single", DMA_FIFO_1_2,    DMA_WIDTH_32, DMA_BURST_SINGLE },
+    { "fifo1/2 16/16 INCR4 ", DMA_FIFO_1_2,    DMA_WIDTH_16, DMA_BURST_INCR4  },
+    { "full 16/16 INCR8    ", DMA_FIFO_FULL,   DMA_WIDTH_16, DMA_BURST_INCR8  },
+    { "full 16/32 INCR4    ", DMA_FIFO_FULL,   DMA_WIDTH_32, DMA_BURST_INCR4  },
+};
+
+#define MODE_COUNT  (sizeof(modes) / sizeof(modes[0]))
+
+   /* bursts must not cross 1 KB: keep the ring burst aligned */
+static volatile uint32_t adc_ring[ADC_RING_LEN / 2U] __attribute__((aligned(16)));
+static uint32_t work_buf[WORK_WORDS];
+static volatile uint32_t work_sink;
+
+static dma_stream_t *adc_dma;
+static volatile uint32_t adc_wraps = 0U;
+static volatile uint32_t adc_errors = 0U;
+
+   /*--------------------------------------------------
+    * USART2 TX through DMA, one line at a time
+    *-------------------------------------------------*/
+static dma_stream_t *tx_dma;
+static uint32_t tx_buf[TX_BUF_LEN / 4U];
+static char *const tx_chars = (char *)tx_buf;
+static uint32_t tx_len = 0U;
+static volatile uint32_t tx_busy = 0U;
+
+static void tx_done(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    (void)s;
+    (void)events;
+    (void)ctx;
+
+    tx_busy = 0U;
+}
+
+static void tx_begin(void)
+{
+    while (tx_busy)
+    {
+        /* previous line still going out */
+    }
+    tx_len = 0U;
+}
+
+static void tx_char(char c)
+{
+    if (tx_len < (TX_BUF_LEN - 5U))            /* room for pad + CR LF */
+    {
+        tx_chars[tx_len++] = c;
+    }
+}
+
+static void tx_string(const char *s)
+{
+    while (*s)
+    {
+        tx_char(*s++);
+    }
+}
+
+static void tx_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        tx_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        tx_char(buf[--i]);
+    }
+}
+
+static void tx_end(void)
+{
+    dma_desc_t desc =
+    {
+        .dir      = DMA_DIR_M2P,
+        .psize    = DMA_WIDTH_8,
+        .msize    = DMA_WIDTH_32,
+        .minc     = 1U,
+        .fifo     = DMA_FIFO_1_2,
+        .prio     = DMA_PRIO_LOW,
+        .periph   = (uint32_t)&USART2->DR,
+        .mem0     = (uint32_t)tx_buf,
+        .events   = DMA_EVT_TC | DMA_EVT_TE,
+        .callback = tx_done,
+    };
+
+    /* unpacking reads whole words: pad with spaces */
+    while (((tx_len + 2U) & 3U) != 0U)
+    {
+        tx_chars[tx_len++] = ' ';
+    }
+    tx_chars[tx_len++] = '\r';
+    tx_chars[tx_len++] = '\n';
+
+    desc.count = (uint16_t)tx_len;
+
+    __DSB();                                   /* line in SRAM before the DMA reads it */
+
+    tx_busy = 1U;
+    if (dma_config(tx_dma, &desc) != DMA_OK)
+    {
+        tx_busy = 0U;
+        return;
+    }
+    dma_start(tx_dma);
+}
+
+   /*--------------------------------------------------
+    * ADC stream callback: count ring wraps and errors
+    *-------------------------------------------------*/
+static void adc_dma_event(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    (void)s;
+    (void)ctx;
+
+    if (events & DMA_EVT_TC)
+    {
+        adc_wraps++;
+    }
+    if (events & DMA_EVT_ERR)
+    {
+        adc_errors++;
+    }
+}
+
+   /*--------------------------------------------------
+    * CPU workload: SRAM read-modify-write, every
+    * access goes over the same bus matrix slave as
+    * the DMA2 memory port writes
+    *-------------------------------------------------*/
+static uint32_t workload(void)
+{
+    uint32_t t0 = DWT->CYCCNT;
+    uint32_t sum = 0U;
+    uint32_t pass;
+    uint32_t i;
+
+    for (pass = 0U; pass < WORK_PASSES; pass++)
+    {
+        for (i = 0U; i < WORK_WORDS; i++)
+        {
+            uint32_t v = work_buf[i];
+
+            sum += v;
+            work_buf[i] = v + sum;
+        }
+    }
+
+    work_sink = sum;
+
+    return DWT->CYCCNT - t0;
+}
+
+static void delay_cycles(uint32_t n)
+{
+    uint32_t t0 = DWT->CYCCNT;
+
+    while ((DWT->CYCCNT - t0) < n)
+    {
+        /* wait */
+    }
+}
+
+   /*--------------------------------------------------
+    * One benchmark run. Returns workload cycles, the
+    * number of samples streamed meanwhile and whether
+    * the ADC overran (DMA did not keep up).
+    *-------------------------------------------------*/
+static uint32_t run_mode(const adc_mode_t *m, uint32_t *samples, uint32_t *ovr)
+{
+    dma_desc_t desc =
+    {
+        .dir      = DMA_DIR_P2M,
+        .psize    = DMA_WIDTH_16,
+        .msize    = m->msize,
+        .minc     = 1U,
+        .pburst   = DMA_BURST_SINGLE,
+        .mburst   = m->mburst,
+        .fifo     = m->fifo,
+        .prio     = DMA_PRIO_HIGH,
+        .circular = 1U,
+        .periph   = (uint32_t)&ADC1->DR,
+        .mem0     = (uint32_t)adc_ring,
+        .count    = ADC_RING_LEN,
+        .events   = DMA_EVT_TC | DMA_EVT_ERR,
+        .callback = adc_dma_event,
+    };
+    uint32_t cycles;
+
+    ADC1->CR2 &= ~ADC_CR2_ADON;
+
+    if (dma_config(adc_dma, &desc) != DMA_OK)
+    {
+        *samples = 0U;
+        *ovr = 0U;
+        return 0U;
+    }
+
+    adc_wraps = 0U;
+    adc_errors = 0U;
+    dma_start(adc_dma);
+
+    ADC1->SR = 0U;
+    ADC1->CR2 |= ADC_CR2_ADON;
+    delay_cycles(SCLK / 100000U);              /* tSTAB, 10 us */
+    ADC1->CR2 |= ADC_CR2_SWSTART;
+
+    cycles = workload();
+
+    ADC1->CR2 &= ~ADC_CR2_ADON;
+    dma_stop(adc_dma);                         /* flushes the FIFO to memory */
+
+    *samples = adc_wraps * ADC_RING_LEN + (ADC_RING_LEN - dma_remaining(adc_dma));
+    *ovr = (ADC1->SR & ADC_SR_OVR) ? 1U : 0U;
+
+    return cycles;
+}
+
+static void report_mode(const adc_mode_t *m, uint32_t cycles, uint32_t base,
+                        uint32_t samples, uint32_t ovr)
+{
+    static const uint8_t beats[4] = { 1U, 4U, 8U, 16U };
+    uint32_t writes = 32U >> m->msize;         /* SRAM writes per 16 samples */
+
+    tx_begin();
+    tx_string(m->name);
+
+    if (cycles == 0U)
+    {
+        tx_string("  rejected by dma_config");
+        tx_end();
+        return;
+    }
+
+    tx_string("  cyc=");
+    tx_u32(cycles);
+
+    if (cycles >= base)
+    {
+        uint32_t pm = ((cycles - base) * 1000U + (base / 2U)) / base;
+
+        tx_string("  +");
+        tx_u32(pm / 10U);
+        tx_char('.');
+        tx_char((char)('0' + pm % 10U));
+        tx_char('%');
+    }
+    else
+    {
+        tx_string("  -0.0%");
+    }
+
+    tx_string("  wr/16=");
+    tx_u32(writes);
+    tx_string(" arb/16=");
+    tx_u32(writes / beats[m->mburst]);
+    tx_string("  n=");
+    tx_u32(samples);
+    tx_string(" ovr=");
+    tx_u32(ovr);
+    tx_string(" err=");
+    tx_u32(adc_errors);
+    tx_end();
+}
+
+int main(void)
+{
+    uint32_t base;
+    uint32_t i;
+
+   /*--------------------------------------------------
+    * 1) Clocks (DMA clocks are enabled by dma_alloc)
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+   /*--------------------------------------------------
+    * 2) PA0 analog, USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0;
+    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR0;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR3 |= USART_CR3_DMAT;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+   /*--------------------------------------------------
+    * 3) DWT cycle counter
+    *-------------------------------------------------*/
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+   /*--------------------------------------------------
+    * 4) DMA streams: USART2 TX (DMA1 S6), ADC1 (DMA2)
+    *-------------------------------------------------*/
+    tx_dma  = dma_alloc(DMA_REQ_USART2_TX);
+    adc_dma = dma_alloc(DMA_REQ_ADC1);
+
+    if ((tx_dma == 0) || (adc_dma == 0))
+    {
+        while (1)
+        {
+            /* no stream available */
+        }
+    }
+
+    tx_begin();
+    tx_string("DMA FIFO/burst vs CPU, ADC1 533 ksps");
+    tx_end();
+
+   /*--------------------------------------------------
+    * 5) ADC1: ADCCLK = PCLK2/2, 3 cycle sampling,
+    *    continuous, DMA requests kept on (DDS)
+    *-------------------------------------------------*/
+    ADC->CCR &= ~ADC_CCR_ADCPRE;               /* PCLK2/2 */
+
+    ADC1->SMPR2 &= ~ADC_SMPR2_SMP0;            /* 3 cycles */
+
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;
+
+    ADC1->CR1 &= ~ADC_CR1_EOCIE;
+
+    ADC1->CR2 &= ~(ADC_CR2_ALIGN | ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    ADC1->CR2 |=  ADC_CR2_CONT | ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 6) Main loop: CPU-only baseline, then each mode
+    *-------------------------------------------------*/
+    while (1)
+    {
+        base = workload();
+
+        tx_begin();
+        tx_string("cpu only              cyc=");
+        tx_u32(base);
+        tx_end();
+
+        for (i = 0U; i < MODE_COUNT; i++)
+        {
+            uint32_t samples;
+            uint32_t ovr;
+            uint32_t cycles;
+
+            tx_begin();                        /* UART DMA idle during the run */
+            cycles = run_mode(&modes[i], &samples, &ovr);
+            report_mode(&modes[i], cycles, base, samples, ovr);
+        }
+
+        tx_begin();
+        tx_end();
+
+        delay_cycles(SCLK);
+    }
+}
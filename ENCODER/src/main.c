@@ -0,0 +1,227 @@
+#include "stm32f4xx.h"
+#include "encoder.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Quadrature encoder with M/T velocity
+    *
+    * TIM1 simulates an encoder: CH1 (PA8) and CH2
+    * (PA9) toggle on compare, half a period apart,
+    * i.e. A and B in quadrature. Wire PA8 to PA6 and
+    * PA9 to PA7 (TIM3 CH1 / CH2, encoder mode). TIM2
+    * stamps the A edges.
+    *
+    * A 1 kHz SysTick plays the motion loop and calls
+    * enc_update(). Every 2 s the simulated speed and
+    * direction change, from 4 counts/s to 400 k
+    * counts/s; main prints position and velocity
+    * every 100 ms and sleeps in between.
+    *-------------------------------------------------*/
+
+#define LOOP_HZ    1000U
+#define PRINT_MS   100U
+#define STEP_MS    2000U
+
+typedef struct
+{
+    uint16_t psc;
+    uint16_t arr;
+    uint8_t  reverse;
+} sim_speed_t;
+
+   /* A frequency = 16 MHz / (psc + 1) / (2 * (arr + 1)), counts = 4 x that */
+static const sim_speed_t speeds[] =
+{
+    { 159U, 49999U, 0U },                      /* 1 Hz A, 4 counts/s */
+    { 159U,   499U, 0U },                      /* 100 Hz */
+    {   0U,  7999U, 0U },                      /* 1 kHz */
+    {   0U,  7999U, 1U },                      /* 1 kHz backwards */
+    {   0U,    79U, 0U },                      /* 100 kHz, 400 k counts/s */
+    {   0U,    79U, 1U },
+};
+
+#define SPEEDS  (sizeof(speeds) / sizeof(speeds[0]))
+
+static enc_t enc;
+static volatile uint32_t ms = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void usart2_send_i32(int32_t v)
+{
+    if (v < 0)
+    {
+        usart2_send_char('-');
+        usart2_send_u32((uint32_t)0U - (uint32_t)v);
+    }
+    else
+    {
+        usart2_send_u32((uint32_t)v);
+    }
+}
+
+   /*--------------------------------------------------
+    * Motion loop tick
+    *-------------------------------------------------*/
+void SysTick_Handler(void)
+{
+    (void)enc_update(&enc);
+    ms++;
+}
+
+static void sim_set(const sim_speed_t *s)
+{
+    uint32_t half = (s->arr + 1U) / 2U;
+
+    TIM1->CR1 &= ~TIM_CR1_CEN;
+    TIM1->PSC = s->psc;
+    TIM1->ARR = s->arr;
+    TIM1->CCR1 = s->reverse ? half : 0U;       /* B leads A when reversed */
+    TIM1->CCR2 = s->reverse ? 0U : half;
+    TIM1->EGR = TIM_EGR_UG;
+    TIM1->CR1 |= TIM_CR1_CEN;
+}
+
+int main(void)
+{
+    uint32_t next_print = PRINT_MS;
+    uint32_t next_step = STEP_MS;
+    uint32_t step = 0U;
+
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+   /*--------------------------------------------------
+    * 3) Encoder inputs PA6 / PA7 TIM3 (AF2),
+    *    simulator outputs PA8 / PA9 TIM1 (AF1)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER7 |
+                      GPIO_MODER_MODER8 | GPIO_MODER_MODER9);
+    GPIOA->MODER |=  (GPIO_MODER_MODER6_1 | GPIO_MODER_MODER7_1 |
+                      GPIO_MODER_MODER8_1 | GPIO_MODER_MODER9_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (6U * 4U)) | (0xFU << (7U * 4U)));
+    GPIOA->AFR[0] |=  ((2U  << (6U * 4U)) | (2U  << (7U * 4U)));
+    GPIOA->AFR[1] &= ~((0xFU << ((8U - 8U) * 4U)) | (0xFU << ((9U - 8U) * 4U)));
+    GPIOA->AFR[1] |=  ((1U  << ((8U - 8U) * 4U)) | (1U  << ((9U - 8U) * 4U)));
+
+   /*--------------------------------------------------
+    * 4) Simulator: TIM1 CH1 / CH2 toggle on match
+    *-------------------------------------------------*/
+    TIM1->CCMR1 = (3U << TIM_CCMR1_OC1M_Pos) | (3U << TIM_CCMR1_OC2M_Pos);
+    TIM1->CCER = TIM_CCER_CC1E | TIM_CCER_CC2E;
+    TIM1->BDTR = TIM_BDTR_MOE;
+    sim_set(&speeds[0]);
+
+   /*--------------------------------------------------
+    * 5) Encoder on TIM3, A edges stamped by TIM2
+    *-------------------------------------------------*/
+    {
+        enc_cfg_t cfg =
+        {
+            .tim     = TIM3,
+            .stamp   = TIM2,
+            .filter  = 2U,                     /* 4 samples at fCK_INT */
+            .invert  = 0U,
+            .stop_us = 2000000U,
+        };
+
+        if (enc_init(&enc, &cfg) != ENC_OK)
+        {
+            usart2_send_string("encoder init failed\r\n");
+            while (1)
+            {
+                /* stop */
+            }
+        }
+    }
+
+    usart2_send_string("encoder M/T\r\n");
+
+    SysTick_Config(SystemCoreClock / LOOP_HZ);
+
+   /*--------------------------------------------------
+    * 6) Print and change speed, sleep in between
+    *-------------------------------------------------*/
+    while (1)
+    {
+        __WFI();
+
+        if ((int32_t)(ms - next_print) >= 0)
+        {
+            next_print += PRINT_MS;
+
+            usart2_send_string("pos=");
+            usart2_send_i32(enc_position(&enc));
+            usart2_send_string(" v=");
+            usart2_send_i32((int32_t)enc_velocity(&enc));
+            usart2_send_string(" counts/s\r\n");
+        }
+
+        if ((int32_t)(ms - next_step) >= 0)
+        {
+            next_step += STEP_MS;
+            step = (step + 1U) % SPEEDS;
+            sim_set(&speeds[step]);
+        }
+    }
+}
@@ -0,0 +1,276 @@
+#include "stm32f4xx.h"
+#include "gpio.h"
+#include "exti.h"
+#include "swtimer.h"
+#include "delay.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * EXTI driver: timestamped edges and debounce
+    *
+    * PA1 plays a bouncing contact: every 500 ms main
+    * flips it with a burst of 7 edges, 40..300 us
+    * apart. Wire PA1 to PA0 and to PB1.
+    *   PA0 (line 0)   debounced, 5 ms: one change per
+    *                  burst, one interrupt per burst
+    *   PB1 (line 1)   raw, rising edges only: every
+    *                  bounce, with its timestamp
+    *   PC13 (line 13) user button, debounced 20 ms,
+    *                  pressed = falling edge
+    *
+    * The callbacks run from exti_process() in the
+    * main loop; a 1 kHz SysTick wakes the loop so the
+    * debounce windows are closed on time.
+    *-------------------------------------------------*/
+
+#define BURST_MS   500U
+
+static const uint16_t bounce_us[] = { 40U, 120U, 60U, 300U, 80U, 150U };
+
+#define BOUNCES  (sizeof(bounce_us) / sizeof(bounce_us[0]))
+
+static volatile uint32_t ms = 0U;
+static uint32_t raw_edges = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void usart2_send_u64(uint64_t v)
+{
+    char buf[20];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 20)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+void SysTick_Handler(void)
+{
+    ms++;
+}
+
+   /*--------------------------------------------------
+    * Line callbacks (task context)
+    *-------------------------------------------------*/
+static void on_change(uint32_t line, uint32_t level, uint64_t t_us, void *ctx)
+{
+    usart2_send_string((const char *)ctx);
+    usart2_send_string(" line ");
+    usart2_send_u32(line);
+    usart2_send_string(level ? " high at " : " low at ");
+    usart2_send_u64(t_us);
+    usart2_send_string(" us\r\n");
+}
+
+static void on_raw(uint32_t line, uint32_t level, uint64_t t_us, void *ctx)
+{
+    (void)line;
+    (void)level;
+    (void)t_us;
+    (void)ctx;
+
+    raw_edges++;
+}
+
+static void attach(const exti_cfg_t *cfg)
+{
+    if (exti_attach(cfg) < 0)
+    {
+        usart2_send_string("exti attach failed\r\n");
+        while (1)
+        {
+            /* stop */
+        }
+    }
+}
+
+static void bounce(uint32_t level)
+{
+    uint32_t i;
+
+    for (i = 0U; i < BOUNCES; i++)
+    {
+        gpio_write(GPIO_PA(1), ((i & 1U) == 0U) ? level : !level);
+        delay_us(bounce_us[i]);
+    }
+    gpio_write(GPIO_PA(1), level);
+}
+
+int main(void)
+{
+    uint32_t next_burst = BURST_MS;
+    uint32_t level = 0U;
+
+   /*--------------------------------------------------
+    * 1) Pins: USART2 PA2 / PA3, bouncer PA1 (low),
+    *    inputs PA0 / PB1 pulled down, PC13 (the board
+    *    has the pull-up)
+    *-------------------------------------------------*/
+    {
+        static const gpio_cfg_t pins[] =
+        {
+            { .port = GPIO_PORT_A, .pins = (1U << 2) | (1U << 3), .mode = GPIO_MODE_AF,
+              .af = 7U, .pull = GPIO_PULL_NONE },
+            { .port = GPIO_PORT_A, .pins = 1U << 1, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_LOW, .pull = GPIO_PULL_NONE, .level = 0U },
+            { .port = GPIO_PORT_A, .pins = 1U << 0, .mode = GPIO_MODE_INPUT,
+              .pull = GPIO_PULL_DOWN },
+            { .port = GPIO_PORT_B, .pins = 1U << 1, .mode = GPIO_MODE_INPUT,
+              .pull = GPIO_PULL_DOWN },
+            { .port = GPIO_PORT_C, .pins = 1U << 13, .mode = GPIO_MODE_INPUT,
+              .pull = GPIO_PULL_NONE },
+        };
+
+        gpio_config(pins, sizeof(pins) / sizeof(pins[0]));
+    }
+
+   /*--------------------------------------------------
+    * 2) USART2
+    *-------------------------------------------------*/
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("EXTI edges\r\n");
+
+   /*--------------------------------------------------
+    * 3) Timebase for the stamps, DWT for the bouncer
+    *-------------------------------------------------*/
+    timebase_init();
+    delay_init();
+
+   /*--------------------------------------------------
+    * 4) EXTI lines, all vectors at priority 5
+    *-------------------------------------------------*/
+    exti_init(5U);
+
+    {
+        exti_cfg_t cfg =
+        {
+            .pin         = GPIO_PA(0),
+            .edge        = EXTI_EDGE_BOTH,
+            .debounce_us = 5000U,
+            .fn          = on_change,
+            .ctx         = "PA0",
+        };
+
+        attach(&cfg);
+    }
+
+    {
+        exti_cfg_t cfg =
+        {
+            .pin         = GPIO_PB(1),
+            .edge        = EXTI_EDGE_RISING,
+            .debounce_us = 0U,
+            .fn          = on_raw,
+            .ctx         = 0,
+        };
+
+        attach(&cfg);
+    }
+
+    {
+        exti_cfg_t cfg =
+        {
+            .pin         = GPIO_PC(13),
+            .edge        = EXTI_EDGE_FALLING,
+            .debounce_us = 20000U,
+            .fn          = on_change,
+            .ctx         = "button",
+        };
+
+        attach(&cfg);
+    }
+
+    SysTick_Config(SystemCoreClock / 1000U);
+
+   /*--------------------------------------------------
+    * 5) Bursts every 500 ms, events in between
+    *-------------------------------------------------*/
+    while (1)
+    {
+        __WFI();
+
+        (void)exti_process();
+
+        if ((int32_t)(ms - next_burst) >= 0)
+        {
+            const exti_stats_t *st = exti_stats(0U);
+
+            next_burst += BURST_MS;
+
+            usart2_send_string("raw rising ");
+            usart2_send_u32(raw_edges);
+            usart2_send_string(", PA0 irqs ");
+            usart2_send_u32(st->irqs);
+            usart2_send_string(" reported ");
+            usart2_send_u32(st->reported);
+            usart2_send_string(" rejected ");
+            usart2_send_u32(st->rejected);
+            usart2_send_string(", dropped ");
+            usart2_send_u32(exti_dropped());
+            usart2_send_string("\r\n");
+
+            level = !level;
+            bounce(level);
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#include "stm32f4xx.h"
+#include "fault.h"
+#include "delay.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Fault handlers and crash record
+    *
+    * At boot the record of the previous crash (if any)
+    * is printed. Then, after 2 s, the demo crashes on
+    * purpose, a different way on every boot:
+    *   0  integer division by zero   UsageFault
+    *   1  read from an unmapped      BusFault
+    *      address
+    *   2  call through an even       UsageFault
+    *      address (no Thumb bit)
+    *   3  undefined instruction      UsageFault
+    * The handler saves the record and resets, the
+    * next boot prints it. Feed the log and the .elf
+    * to common/tools/fault_decode.py for source lines.
+    *-------------------------------------------------*/
+
+#define DEMO_MAGIC  0x5EED5EEDU
+#define KINDS       4U
+
+static uint32_t demo_magic FAULT_NOINIT;
+static uint32_t demo_step FAULT_NOINIT;
+
+static volatile uint32_t divisor = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * Crash sites, not inlined so the backtrace has
+    * something to show
+    *-------------------------------------------------*/
+__attribute__((noinline)) static uint32_t crash(uint32_t kind)
+{
+    switch (kind)
+    {
+        case 0U:
+            return 100U / divisor;
+
+        case 1U:
+            return *(volatile uint32_t *)0xCCCCCCC0U;
+
+        case 2U:
+            ((void (*)(void))FLASH_BASE)();    /* bit 0 clear: INVSTATE */
+            return 0U;
+
+        default:
+            __asm volatile ("udf #0");
+            return 0U;
+    }
+}
+
+__attribute__((noinline)) static uint32_t work(uint32_t kind)
+{
+    return crash(kind) + 1U;
+}
+
+int main(void)
+{
+    uint32_t kind;
+
+   /*--------------------------------------------------
+    * 1) Fault handlers first
+    *-------------------------------------------------*/
+    fault_init();
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("\r\nboot\r\n");
+
+   /*--------------------------------------------------
+    * 3) Report the last crash, pick the next one
+    *-------------------------------------------------*/
+    if (!fault_report(usart2_send_string))
+    {
+        usart2_send_string("no crash record\r\n");
+    }
+
+    if (demo_magic != DEMO_MAGIC)
+    {
+        demo_magic = DEMO_MAGIC;
+        demo_step = 0U;
+    }
+    kind = demo_step % KINDS;
+    demo_step++;
+
+    delay_init();
+
+    usart2_send_string("crash ");
+    usart2_send_u32(kind);
+    usart2_send_string(" in 2 s\r\n");
+    delay_ms(2000U);
+
+   /*--------------------------------------------------
+    * 4) Crash
+    *-------------------------------------------------*/
+    usart2_send_u32(work(kind));
+
+    while (1)
+    {
+        /* not reached */
+    }
+}
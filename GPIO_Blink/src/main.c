@@ -1,65 +1,57 @@
 #include "stm32f4xx.h"
+#include "swtimer.h"
+#include "gpio.h"
 
-volatile uint32_t ms = 0;
+#define BLINK_US  100000U   // 100 ms
+#define LED       GPIO_PA(5)
 
-// SysTick interrupt handler: runs every 1 ms
-void SysTick_Handler(void)
+static swtimer_t blink_timer;
+
+// Timer callback (TIM5 interrupt): runs only when the deadline is reached
+static void blink(swtimer_t *t, void *ctx)
 {
-    ms++;
+    (void)t;
+    (void)ctx;
+
+    gpio_toggle(LED);             // toggle PA5: reads ODR, writes BSRR
 }
 
 int main(void)
 {
     /*--------------------------------------------------
-     * 1) Enable GPIOA clock (RCC AHB1ENR)
-     *-------------------------------------------------*/
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;   // GPIOAEN bit = 1 → enable GPIOA
-
-    /*--------------------------------------------------
-     * 2) Configure PA5 as push-pull output
+     * 1) Enable GPIOA clock and configure PA5 as
+     *    push-pull output
      *    - MODER5 = 01 (output)
      *    - OTYPER5 = 0 (push-pull)
      *    - OSPEEDR5 = 11 (high speed, optional)
      *    - PUPDR5 = 00 (no pull-up/pull-down)
+     *    gpio_config() writes each register once
      *-------------------------------------------------*/
+    {
+        static const gpio_cfg_t pins[] =
+        {
+            { .port = GPIO_PORT_A, .pins = 1U << 5, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_HIGH, .pull = GPIO_PULL_NONE },
+        };
 
-    // MODER: clear both bits for pin 5, then set to 01 (output)
-    GPIOA->MODER &= ~GPIO_MODER_MODER5;    // clear mode bits for PA5
-    GPIOA->MODER |=  GPIO_MODER_MODER5_0;  // 01: general-purpose output
-
-    // OTYPER: 0 = push-pull
-    GPIOA->OTYPER &= ~GPIO_OTYPER_OT_5;    // clear bit 5 → push-pull
-
-    // OSPEEDR: set high speed for PA5 (optional)
-    GPIOA->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR5;  // 11: very high speed
-
-    // PUPDR: no pull-up, no pull-down → 00
-    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR5;
+        gpio_config(pins, 1U);
+    }
 
     /*--------------------------------------------------
-     * 3) Configure SysTick for 1 ms tick
-     *    Assuming SystemCoreClock = 16 MHz (HSI)
+     * 2) Tickless timebase: TIM5 free-runs at 1 MHz,
+     *    a compare interrupt fires only at the next
+     *    blink deadline (no 1 ms SysTick)
      *-------------------------------------------------*/
+    timebase_init();
 
-    SysTick->LOAD = 16000U - 1U;   // 16000 cycles @ 16 MHz = 1 ms
-    SysTick->VAL  = 0U;            // clear current value
-
-    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk |  // use processor clock
-                    SysTick_CTRL_TICKINT_Msk   |  // enable SysTick interrupt
-                    SysTick_CTRL_ENABLE_Msk;      // enable SysTick
+    swtimer_init(&blink_timer, blink, 0);
+    swtimer_start(&blink_timer, BLINK_US, BLINK_US);   // periodic, no drift
 
     /*--------------------------------------------------
-     * 4) Main loop: toggle LED every 100 ms
+     * 3) Main loop: sleep until the next interrupt
      *-------------------------------------------------*/
-    uint32_t last = 0;
-
     while (1)
     {
-        if ((ms - last) >= 100U)   // 100 ms elapsed?
-        {
-            GPIOA->ODR ^= GPIO_ODR_OD5;   // toggle PA5
-            last += 100U;
-        }
+        __WFI();
     }
 }
-
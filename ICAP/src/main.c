@@ -0,0 +1,241 @@
+#include "stm32f4xx.h"
+#include "icap.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Input capture through DMA, no IRQ per edge
+    *
+    * TIM3 CH1 (PA6) outputs a 100 kHz, 30 % test
+    * signal. Wire PA6 to PA0 and PA1:
+    *   - TIM2 CH1 (PA0) in PWM input mode: period and
+    *     high time of every cycle
+    *   - TIM5 CH2 (PA1) in period mode with the IC
+    *     prescaler at 8: one capture per 8 edges
+    *
+    * The main loop only folds new captures into the
+    * statistics; once per second it prints frequency,
+    * duty, min / max period, the period histogram,
+    * overruns and the CPU share spent in icap_batch().
+    *-------------------------------------------------*/
+
+#define TEST_ARR    (160U - 1U)                /* 16 MHz / 160 = 100 kHz */
+#define TEST_CCR    48U                        /* 30 % high */
+
+#define PWM_LEN     8192U                      /* words = 4096 pairs, 41 ms: covers a report */
+#define PER_LEN     1024U
+
+static uint32_t pwm_buf[PWM_LEN];
+static uint32_t per_buf[PER_LEN];
+
+static icap_t       pwm_ic;
+static icap_t       per_ic;
+static icap_stats_t pwm_st;
+static icap_stats_t per_st;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void report(const char *name, const icap_t *ic, const icap_stats_t *st, uint32_t duty)
+{
+    uint32_t i;
+
+    usart2_send_string(name);
+    usart2_send_string(" f=");
+    usart2_send_u32(icap_freq_hz(ic, st));
+    usart2_send_string(" Hz");
+    if (duty)
+    {
+        usart2_send_string(" duty=");
+        usart2_send_u32(icap_duty_permille(st));
+        usart2_send_string("/1000");
+    }
+    usart2_send_string(" n=");
+    usart2_send_u32(st->count);
+    usart2_send_string(" min=");
+    usart2_send_u32(st->period_min);
+    usart2_send_string(" max=");
+    usart2_send_u32(st->period_max);
+    usart2_send_string(" ovr=");
+    usart2_send_u32(ic->overruns);
+    usart2_send_string("\r\n  hist");
+
+    for (i = 0U; i < ICAP_HIST_BINS; i++)
+    {
+        usart2_send_char(' ');
+        usart2_send_u32(st->hist[i]);
+    }
+    usart2_send_string("\r\n");
+}
+
+int main(void)
+{
+    uint32_t t_last;
+    uint32_t busy = 0U;
+
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN | RCC_APB1ENR_TIM3EN;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+   /*--------------------------------------------------
+    * 3) Capture pins: PA0 TIM2_CH1 (AF1),
+    *    PA1 TIM5_CH2 (AF2). Test output PA6
+    *    TIM3_CH1 (AF2)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER0 | GPIO_MODER_MODER1 | GPIO_MODER_MODER6);
+    GPIOA->MODER |=  (GPIO_MODER_MODER0_1 | GPIO_MODER_MODER1_1 | GPIO_MODER_MODER6_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (0U * 4U)) | (0xFU << (1U * 4U)) | (0xFU << (6U * 4U)));
+    GPIOA->AFR[0] |=  ((1U  << (0U * 4U)) | (2U  << (1U * 4U)) | (2U  << (6U * 4U)));
+
+    GPIOA->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR6;
+
+   /*--------------------------------------------------
+    * 4) Test signal: TIM3 CH1 PWM mode 1
+    *-------------------------------------------------*/
+    TIM3->PSC = 0U;
+    TIM3->ARR = TEST_ARR;
+    TIM3->CCR1 = TEST_CCR;
+    TIM3->CCMR1 = (6U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE;
+    TIM3->CCER = TIM_CCER_CC1E;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+   /*--------------------------------------------------
+    * 5) Capture engines
+    *-------------------------------------------------*/
+    {
+        icap_cfg_t pwm_cfg =
+        {
+            .tim       = TIM2,
+            .channel   = 1U,
+            .mode      = ICAP_MODE_PWM,
+            .edge      = ICAP_EDGE_RISING,
+            .filter    = 0U,                   /* fs = fCK_INT, no filter */
+            .psc       = 0U,
+            .buf       = pwm_buf,
+            .len       = PWM_LEN,
+            .hist_min  = TEST_ARR + 1U - (ICAP_HIST_BINS / 2U),
+            .hist_step = 1U,
+        };
+        icap_cfg_t per_cfg =
+        {
+            .tim          = TIM5,
+            .channel      = 2U,
+            .mode         = ICAP_MODE_PERIOD,
+            .edge         = ICAP_EDGE_RISING,
+            .filter       = 0U,
+            .ic_prescaler = 3U,                /* every 8th edge */
+            .psc          = 0U,
+            .buf          = per_buf,
+            .len          = PER_LEN,
+            .hist_min     = (8U * (TEST_ARR + 1U)) - (ICAP_HIST_BINS / 2U),
+            .hist_step    = 1U,
+        };
+
+        if ((icap_init(&pwm_ic, &pwm_cfg) != ICAP_OK) ||
+            (icap_init(&per_ic, &per_cfg) != ICAP_OK))
+        {
+            usart2_send_string("icap init failed\r\n");
+            while (1)
+            {
+                /* stop */
+            }
+        }
+    }
+
+    usart2_send_string("input capture via DMA\r\n");
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    icap_stats_reset(&pwm_st);
+    icap_stats_reset(&per_st);
+    icap_start(&pwm_ic);
+    icap_start(&per_ic);
+
+    t_last = DWT->CYCCNT;
+
+   /*--------------------------------------------------
+    * 6) Main loop: batch, report once per second
+    *-------------------------------------------------*/
+    while (1)
+    {
+        uint32_t t0 = DWT->CYCCNT;
+
+        (void)icap_batch(&pwm_ic, &pwm_st);
+        (void)icap_batch(&per_ic, &per_st);
+        busy += DWT->CYCCNT - t0;
+
+        if ((DWT->CYCCNT - t_last) >= SCLK)
+        {
+            t_last += SCLK;
+
+            report("pwm", &pwm_ic, &pwm_st, 1U);
+            report("per/8", &per_ic, &per_st, 0U);
+            usart2_send_string("batch cpu=");
+            usart2_send_u32(busy / (SCLK / 100U));
+            usart2_send_string(" %\r\n\r\n");
+
+            icap_stats_reset(&pwm_st);
+            icap_stats_reset(&per_st);
+            busy = 0U;
+        }
+    }
+}
@@ -0,0 +1,243 @@
+#include "stm32f4xx.h"
+#include "opm.h"
+#include "delay.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * One-pulse timer service and DWT delays
+    *
+    * TIM1 CH1 (PA8) gives a 1 kHz, 10 us trigger
+    * pulse. Wire PA8 to PA6 (TIM3 TI1): every rising
+    * edge starts TIM3 in hardware, and TIM3 CH2 (PA7)
+    * answers with a 500 ns pulse 2.5 us after the
+    * edge. No interrupt, no CPU.
+    *
+    * TIM4 CH1 (PB6) is fired from software every
+    * 100 ms with a width stepping 62.5 ns .. 8 us.
+    *
+    * At start the delay_us() error is measured on the
+    * DWT cycle counter and printed.
+    *-------------------------------------------------*/
+
+#define TRIG_DELAY_NS  2500U
+#define TRIG_WIDTH_NS  500U
+
+static const uint32_t widths_ns[] = { 63U, 125U, 250U, 500U, 1000U, 2000U, 4000U, 8000U };
+
+#define WIDTHS  (sizeof(widths_ns) / sizeof(widths_ns[0]))
+
+static opm_t echo;
+static opm_t shot;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void fail(const char *what)
+{
+    usart2_send_string(what);
+    usart2_send_string(" failed\r\n");
+    while (1)
+    {
+        /* stop */
+    }
+}
+
+   /*--------------------------------------------------
+    * delay_us(us) against CYCCNT, worst of a few runs
+    *-------------------------------------------------*/
+static void measure_delay(uint32_t us)
+{
+    uint32_t worst = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < 8U; i++)
+    {
+        uint32_t t0 = DWT->CYCCNT;
+        uint32_t dt;
+
+        delay_us(us);
+        dt = DWT->CYCCNT - t0;
+
+        if (dt > worst)
+        {
+            worst = dt;
+        }
+    }
+
+    usart2_send_string("delay_us(");
+    usart2_send_u32(us);
+    usart2_send_string(") = ");
+    usart2_send_u32(worst);
+    usart2_send_string(" cycles, want ");
+    usart2_send_u32(us * (SystemCoreClock / 1000000U));
+    usart2_send_string("\r\n");
+}
+
+int main(void)
+{
+    uint32_t step = 0U;
+
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_GPIOBEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("one-pulse timers\r\n");
+
+   /*--------------------------------------------------
+    * 3) PA6 / PA7 TIM3 (AF2), PA8 TIM1 (AF1),
+    *    PB6 TIM4 (AF2), outputs at very high speed
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER7 | GPIO_MODER_MODER8);
+    GPIOA->MODER |=  (GPIO_MODER_MODER6_1 | GPIO_MODER_MODER7_1 | GPIO_MODER_MODER8_1);
+    GPIOA->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR7 | GPIO_OSPEEDER_OSPEEDR8;
+
+    GPIOA->AFR[0] &= ~((0xFU << (6U * 4U)) | (0xFU << (7U * 4U)));
+    GPIOA->AFR[0] |=  ((2U  << (6U * 4U)) | (2U  << (7U * 4U)));
+    GPIOA->AFR[1] &= ~(0xFU << ((8U - 8U) * 4U));
+    GPIOA->AFR[1] |=  (1U  << ((8U - 8U) * 4U));
+
+    GPIOB->MODER &= ~GPIO_MODER_MODER6;
+    GPIOB->MODER |=  GPIO_MODER_MODER6_1;
+    GPIOB->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR6;
+    GPIOB->AFR[0] &= ~(0xFU << (6U * 4U));
+    GPIOB->AFR[0] |=  (2U  << (6U * 4U));
+
+   /*--------------------------------------------------
+    * 4) DWT delays
+    *-------------------------------------------------*/
+    delay_init();
+
+    usart2_send_string("delay overhead ");
+    usart2_send_u32(delay_overhead());
+    usart2_send_string(" cycles\r\n");
+
+    measure_delay(1U);
+    measure_delay(10U);
+    measure_delay(1000U);
+
+   /*--------------------------------------------------
+    * 5) TIM3: TI1 rising edge -> CH2 pulse
+    *-------------------------------------------------*/
+    {
+        opm_cfg_t cfg =
+        {
+            .tim          = TIM3,
+            .channel      = 2U,
+            .active_low   = 0U,
+            .trigger      = OPM_TRIG_TI1,
+            .trig_falling = 0U,
+            .max_ns       = 4000U,
+        };
+
+        if ((opm_init(&echo, &cfg) != OPM_OK) ||
+            (opm_set(&echo, TRIG_DELAY_NS, TRIG_WIDTH_NS) != OPM_OK))
+        {
+            fail("TIM3 one-pulse");
+        }
+    }
+
+   /*--------------------------------------------------
+    * 6) TIM4 CH1: software fired pulse
+    *-------------------------------------------------*/
+    {
+        opm_cfg_t cfg =
+        {
+            .tim          = TIM4,
+            .channel      = 1U,
+            .active_low   = 0U,
+            .trigger      = OPM_TRIG_SOFTWARE,
+            .trig_falling = 0U,
+            .max_ns       = 10000U,
+        };
+
+        if (opm_init(&shot, &cfg) != OPM_OK)
+        {
+            fail("TIM4 one-pulse");
+        }
+    }
+
+   /*--------------------------------------------------
+    * 7) TIM1 CH1: 1 kHz trigger, 10 us high
+    *-------------------------------------------------*/
+    TIM1->PSC = 15U;                           /* 1 MHz */
+    TIM1->ARR = 999U;
+    TIM1->CCR1 = 10U;
+    TIM1->CCMR1 = (6U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE;
+    TIM1->CCER = TIM_CCER_CC1E;
+    TIM1->BDTR = TIM_BDTR_MOE;
+    TIM1->EGR = TIM_EGR_UG;
+    TIM1->CR1 = TIM_CR1_CEN;
+
+   /*--------------------------------------------------
+    * 8) Software pulses, width stepping
+    *-------------------------------------------------*/
+    while (1)
+    {
+        (void)opm_set(&shot, 1000U, widths_ns[step]);
+        (void)opm_fire(&shot);
+
+        usart2_send_string("PB6 pulse ");
+        usart2_send_u32(widths_ns[step]);
+        usart2_send_string(" ns\r\n");
+
+        step = (step + 1U) % WIDTHS;
+        delay_ms(100U);
+    }
+}
@@ -0,0 +1,220 @@
+#include "stm32f4xx.h"
+#include "gpio.h"
+#include "delay.h"
+#include "pbus.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Parallel GPIO bus by timer paced DMA
+    *
+    * Port C carries two devices, both driven from one
+    * pattern buffer at 1 M words/s:
+    *   PC0..PC7  data, PC8 WR      8080 style display
+    *                               write, 16 bytes
+    *   PC10 data, PC11 clock,      two 74HC595 in a
+    *   PC12 latch                  chain, 16 bits
+    *
+    * Every 100 ms main builds the next frame (a
+    * running counter on both devices), starts it as
+    * a one-shot and sleeps; the DMA callback stops
+    * the timer. The time from start to the callback
+    * is measured on DWT and printed: it is the word
+    * count at 1 us each, whatever the CPU does.
+    *-------------------------------------------------*/
+
+#define BUS_HZ       1000000U
+#define DISP_BYTES   16U
+#define SR_BYTES     2U
+
+#define PIN_WR       (1U << 8)
+#define PIN_SDATA    (1U << 10)
+#define PIN_SCLK     (1U << 11)
+#define PIN_LATCH    (1U << 12)
+#define BUS_PINS     (0x00FFU | PIN_WR | PIN_SDATA | PIN_SCLK | PIN_LATCH)
+
+   /* 2 words per byte, 2 per shifted bit + latch, 1 idle */
+#define FRAME_WORDS  ((2U * DISP_BYTES) + (16U * SR_BYTES) + 2U + 1U)
+
+static uint32_t frame[FRAME_WORDS];
+static pbus_t bus;
+static pbus_build_t build;
+
+static volatile uint32_t done_at = 0U;
+static volatile uint32_t frame_done = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void sent(pbus_t *b, void *ctx)
+{
+    (void)b;
+    (void)ctx;
+
+    done_at = DWT->CYCCNT;
+    frame_done = 1U;
+}
+
+static int build_frame(uint32_t n)
+{
+    uint8_t disp[DISP_BYTES];
+    uint8_t sr[SR_BYTES];
+    uint32_t i;
+
+    for (i = 0U; i < DISP_BYTES; i++)
+    {
+        disp[i] = (uint8_t)(n + i);
+    }
+    sr[0] = (uint8_t)(n >> 8);
+    sr[1] = (uint8_t)n;
+
+    pbus_build_reset(&build);
+
+    if ((pbus_build_strobed(&build, 0U, PIN_WR, disp, DISP_BYTES) != PBUS_OK) ||
+        (pbus_build_shift(&build, PIN_SDATA, PIN_SCLK, PIN_LATCH, sr, SR_BYTES, 1U) != PBUS_OK))
+    {
+        return PBUS_ERR_FULL;
+    }
+
+    /* leave the bus idle: WR high, data low */
+    pbus_put(&build, 0x00FFU, 0U);
+    return pbus_emit(&build, 1U);
+}
+
+int main(void)
+{
+    uint32_t n = 0U;
+
+   /*--------------------------------------------------
+    * 1) Pins: USART2 PA2 / PA3 (AF7), bus on port C,
+    *    idle levels set before the pins turn output
+    *-------------------------------------------------*/
+    {
+        static const gpio_cfg_t pins[] =
+        {
+            { .port = GPIO_PORT_A, .pins = (1U << 2) | (1U << 3), .mode = GPIO_MODE_AF,
+              .af = 7U, .pull = GPIO_PULL_NONE },
+            { .port = GPIO_PORT_C, .pins = BUS_PINS, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_HIGH, .pull = GPIO_PULL_NONE, .level = 0U },
+            { .port = GPIO_PORT_C, .pins = PIN_WR, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_HIGH, .pull = GPIO_PULL_NONE, .level = 1U },
+        };
+
+        gpio_config(pins, sizeof(pins) / sizeof(pins[0]));
+    }
+
+   /*--------------------------------------------------
+    * 2) USART2
+    *-------------------------------------------------*/
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("parallel bus DMA\r\n");
+
+    delay_init();
+
+   /*--------------------------------------------------
+    * 3) Bus: TIM1 update -> DMA2 -> GPIOC->BSRR
+    *-------------------------------------------------*/
+    {
+        pbus_cfg_t cfg =
+        {
+            .port    = GPIOC,
+            .target  = PBUS_BSRR,
+            .rate_hz = BUS_HZ,
+        };
+
+        if (pbus_init(&bus, &cfg) != PBUS_OK)
+        {
+            usart2_send_string("pbus init failed\r\n");
+            while (1)
+            {
+                /* stop */
+            }
+        }
+    }
+
+    pbus_build_init(&build, frame, FRAME_WORDS, BUS_PINS, PIN_WR);
+
+   /*--------------------------------------------------
+    * 4) One frame every 100 ms
+    *-------------------------------------------------*/
+    while (1)
+    {
+        uint32_t t0;
+
+        if (build_frame(n) != PBUS_OK)
+        {
+            usart2_send_string("frame too long\r\n");
+            break;
+        }
+
+        frame_done = 0U;
+        t0 = DWT->CYCCNT;
+        (void)pbus_start(&bus, frame, build.len, 0U, sent, 0);
+
+        while (!frame_done)
+        {
+            __WFI();
+        }
+
+        usart2_send_string("frame ");
+        usart2_send_u32(n);
+        usart2_send_string(": ");
+        usart2_send_u32(build.len);
+        usart2_send_string(" words in ");
+        usart2_send_u32((done_at - t0) / (SystemCoreClock / 1000000U));
+        usart2_send_string(" us\r\n");
+
+        n++;
+        delay_ms(100U);
+    }
+
+    while (1)
+    {
+        /* stop */
+    }
+}
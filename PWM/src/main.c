@@ -0,0 +1,212 @@
+#include "stm32f4xx.h"
+#include "pwm.h"
+
+#define SCLK 16000000U
+
+   /*--------------------------------------------------
+    * PWM driver and DMA waveforms
+    *
+    * TIM1 CH1 (PA8) / CH1N (PA7): 20 kHz center
+    * aligned, complementary with 500 ns dead-time,
+    * duty stepping through a 64 point sine table by
+    * circular DMA burst: a 312 Hz sine after an RC
+    * low-pass, the CPU never touches it.
+    *
+    * TIM3 CH1 (PA6): WS2812 LED strip, 800 kHz, one
+    * PWM period per bit (0: 0.4 us high, 1: 0.8 us
+    * high). Every 20 ms main builds the next frame of
+    * a rainbow running over 8 LEDs and sends it as a
+    * one-shot wave, then sleeps until the next frame.
+    *-------------------------------------------------*/
+
+#define SINE_HZ      20000U
+#define SINE_POINTS  64U
+#define DEADTIME_NS  500U
+
+#define LED_HZ       800000U
+#define LEDS         8U
+#define LED_BITS     (LEDS * 24U)
+#define LED_TAIL     2U                        /* low periods after the last bit */
+#define FRAME_US     20000U
+
+static const uint16_t sine_permille[SINE_POINTS] =
+{
+     500U,  549U,  597U,  645U,  691U,  735U,  777U,  817U,
+     853U,  886U,  915U,  940U,  961U,  978U,  989U,  997U,
+     999U,  997U,  989U,  978U,  961U,  940U,  915U,  886U,
+     853U,  817U,  777U,  735U,  691U,  645U,  597U,  549U,
+     500U,  451U,  403U,  355U,  309U,  265U,  223U,  183U,
+     147U,  114U,   85U,   60U,   39U,   22U,   11U,    3U,
+       1U,    3U,   11U,   22U,   39U,   60U,   85U,  114U,
+     147U,  183U,  223U,  265U,  309U,  355U,  403U,  451U,
+};
+
+static uint16_t sine_ccr[SINE_POINTS];
+static uint16_t led_ccr[LED_BITS + LED_TAIL];
+
+static pwm_t motor;
+static pwm_t strip;
+
+static volatile uint32_t frame_sent = 0U;
+
+static void frame_done(pwm_t *p, void *ctx)
+{
+    (void)p;
+    (void)ctx;
+
+    frame_sent = 1U;
+}
+
+   /*--------------------------------------------------
+    * Colour wheel: 0..255 -> r, g, b
+    *-------------------------------------------------*/
+static uint32_t wheel_grb(uint32_t pos)
+{
+    uint32_t r;
+    uint32_t g;
+    uint32_t b;
+
+    pos &= 0xFFU;
+
+    if (pos < 85U)
+    {
+        r = 255U - (pos * 3U); g = pos * 3U; b = 0U;
+    }
+    else if (pos < 170U)
+    {
+        pos -= 85U;
+        r = 0U; g = 255U - (pos * 3U); b = pos * 3U;
+    }
+    else
+    {
+        pos -= 170U;
+        r = pos * 3U; g = 0U; b = 255U - (pos * 3U);
+    }
+
+    /* quarter brightness, WS2812 order G R B */
+    return ((g >> 2U) << 16U) | ((r >> 2U) << 8U) | (b >> 2U);
+}
+
+   /*--------------------------------------------------
+    * One CCR value per bit, MSB first
+    *-------------------------------------------------*/
+static void build_frame(uint32_t step, uint16_t t0h, uint16_t t1h)
+{
+    uint32_t led;
+    uint32_t bit;
+    uint32_t n = 0U;
+
+    for (led = 0U; led < LEDS; led++)
+    {
+        uint32_t grb = wheel_grb(step + (led * (256U / LEDS)));
+
+        for (bit = 0U; bit < 24U; bit++)
+        {
+            led_ccr[n++] = (grb & (1UL << (23U - bit))) ? t1h : t0h;
+        }
+    }
+
+    while (n < (LED_BITS + LED_TAIL))
+    {
+        led_ccr[n++] = 0U;
+    }
+}
+
+int main(void)
+{
+    uint32_t i;
+    uint32_t step = 0U;
+    uint16_t t0h;
+    uint16_t t1h;
+
+   /*--------------------------------------------------
+    * 1) Pins: PA8 TIM1_CH1, PA7 TIM1_CH1N (AF1),
+    *    PA6 TIM3_CH1 (AF2)
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER7 | GPIO_MODER_MODER8);
+    GPIOA->MODER |=  (GPIO_MODER_MODER6_1 | GPIO_MODER_MODER7_1 | GPIO_MODER_MODER8_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (6U * 4U)) | (0xFU << (7U * 4U)));
+    GPIOA->AFR[0] |=  ((2U  << (6U * 4U)) | (1U  << (7U * 4U)));
+    GPIOA->AFR[1] &= ~(0xFU << ((8U - 8U) * 4U));
+    GPIOA->AFR[1] |=  (1U  << ((8U - 8U) * 4U));
+
+    GPIOA->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR6 | GPIO_OSPEEDER_OSPEEDR7 | GPIO_OSPEEDER_OSPEEDR8;
+
+   /*--------------------------------------------------
+    * 2) TIM1: complementary sine PWM, circular wave
+    *-------------------------------------------------*/
+    {
+        pwm_cfg_t cfg =
+        {
+            .tim         = TIM1,
+            .freq_hz     = SINE_HZ,
+            .align       = PWM_ALIGN_CENTER,
+            .deadtime_ns = DEADTIME_NS,
+        };
+
+        (void)pwm_init(&motor, &cfg);
+        (void)pwm_channel(&motor, 1U, 0U, 1U);
+    }
+
+    for (i = 0U; i < SINE_POINTS; i++)
+    {
+        sine_ccr[i] = (uint16_t)((motor.period * sine_permille[i]) / 1000U);
+    }
+
+    pwm_start(&motor);
+    (void)pwm_wave_start(&motor, 1U, 1U, sine_ccr, DMA_WIDTH_16, SINE_POINTS, 1U, 0, 0);
+
+   /*--------------------------------------------------
+    * 3) TIM3: WS2812 bit timing
+    *-------------------------------------------------*/
+    {
+        pwm_cfg_t cfg =
+        {
+            .tim     = TIM3,
+            .freq_hz = LED_HZ,
+            .align   = PWM_ALIGN_EDGE,
+        };
+
+        (void)pwm_init(&strip, &cfg);
+        (void)pwm_channel(&strip, 1U, 0U, 0U);
+    }
+
+    t0h = (uint16_t)((strip.period * 8U) / 25U);   /* 0.4 of 1.25 us */
+    t1h = (uint16_t)((strip.period * 16U) / 25U);  /* 0.8 of 1.25 us */
+
+    pwm_start(&strip);
+
+   /*--------------------------------------------------
+    * 4) Frame loop: DMA sends, the core sleeps
+    *-------------------------------------------------*/
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    while (1)
+    {
+        uint32_t t0 = DWT->CYCCNT;
+
+        build_frame(step++, t0h, t1h);
+
+        frame_sent = 0U;
+        (void)pwm_wave_start(&strip, 1U, 1U, led_ccr, DMA_WIDTH_16,
+                             LED_BITS + LED_TAIL, 0U, frame_done, 0);
+
+        __disable_irq();
+        while (!frame_sent)
+        {
+            __WFI();
+            __enable_irq();
+            __disable_irq();
+        }
+        __enable_irq();
+
+        while ((DWT->CYCCNT - t0) < ((SCLK / 1000000U) * FRAME_US))
+        {
+            /* frame gap, also the WS2812 latch */
+        }
+    }
+}
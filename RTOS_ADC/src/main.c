@@ -0,0 +1,431 @@
+#include "stm32f4xx.h"
+#include "dma.h"
+#include "os.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * ADC pipeline on the os kernel
+    *
+    * TIM2 TRGO triggers ADC1 (PA0), DMA2 runs circular
+    * into adc_buf. Three threads instead of a superloop:
+    *
+    *   dsp        prio 1  block statistics for each
+    *                      finished half, posted by the
+    *                      DMA callback through blk_q
+    *   command    prio 2  USART2 RX bytes from the ISR
+    *                      through rx_q: "r<hz>" sets
+    *                      the sample rate, "s" prints
+    *                      thread statistics
+    *   telemetry  prio 3  prints dsp results once per
+    *                      TELEM_MS at 115200 baud
+    *
+    * The printing thread is the lowest, so a slow UART
+    * line never delays block processing: dsp preempts
+    * it as soon as a block is posted. Its wake-up
+    * latency (DMA ISR -> dsp running) is measured with
+    * DWT and reported as min / max.
+    *-------------------------------------------------*/
+
+#define ADC_BUF_LEN  256U
+#define HALF_LEN     (ADC_BUF_LEN / 2U)
+#define START_HZ     10000U
+#define TELEM_MS     500U
+
+volatile uint16_t adc_buf[ADC_BUF_LEN];
+
+typedef struct
+{
+    uint32_t first;                            /* index of the block in adc_buf */
+    uint32_t t_isr;                            /* DWT at the DMA interrupt */
+} blk_msg_t;
+
+typedef struct
+{
+    uint16_t avg;
+    uint16_t min;
+    uint16_t max;
+    uint16_t pad;
+} dsp_result_t;
+
+static os_thread_t dsp_thread;
+static os_thread_t cmd_thread;
+static os_thread_t telem_thread;
+
+static uint32_t dsp_stack[256] __attribute__((aligned(8)));
+static uint32_t cmd_stack[256] __attribute__((aligned(8)));
+static uint32_t telem_stack[256] __attribute__((aligned(8)));
+
+static blk_msg_t    blk_buf[4];
+static os_queue_t   blk_q;
+static uint8_t      rx_buf[32];
+static os_queue_t   rx_q;
+static dsp_result_t res_buf[8];
+static os_queue_t   res_q;
+static os_sem_t     uart_lock;
+
+static uint32_t lat_min = 0xFFFFFFFFU;
+static uint32_t lat_max = 0U;
+static uint32_t blocks = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+   /*--------------------------------------------------
+    * Interrupts: hand the work to the threads
+    *-------------------------------------------------*/
+static void adc_dma_done(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    blk_msg_t m;
+
+    (void)s;
+    (void)ctx;
+
+    m.t_isr = DWT->CYCCNT;
+
+    if (events & DMA_EVT_HT)
+    {
+        m.first = 0U;
+        (void)os_queue_send(&blk_q, &m, 0U);
+    }
+
+    if (events & DMA_EVT_TC)
+    {
+        m.first = HALF_LEN;
+        (void)os_queue_send(&blk_q, &m, 0U);
+    }
+}
+
+void USART2_IRQHandler(void)
+{
+    if (USART2->SR & USART_SR_RXNE)
+    {
+        uint8_t b = (uint8_t)USART2->DR;
+
+        (void)os_queue_send(&rx_q, &b, 0U);
+    }
+}
+
+   /*--------------------------------------------------
+    * dsp thread: statistics of each finished half
+    *-------------------------------------------------*/
+static void dsp_run(void *arg)
+{
+    blk_msg_t m;
+
+    (void)arg;
+
+    while (1)
+    {
+        dsp_result_t r;
+        uint32_t sum = 0U;
+        uint32_t lat;
+        uint32_t i;
+
+        if (os_queue_recv(&blk_q, &m, OS_WAIT_FOREVER) != OS_OK)
+        {
+            continue;
+        }
+
+        lat = DWT->CYCCNT - m.t_isr;
+        if (lat < lat_min)
+        {
+            lat_min = lat;
+        }
+        if (lat > lat_max)
+        {
+            lat_max = lat;
+        }
+
+        r.min = 0xFFFFU;
+        r.max = 0U;
+        r.pad = 0U;
+
+        for (i = m.first; i < (m.first + HALF_LEN); i++)
+        {
+            uint16_t v = adc_buf[i];
+
+            sum += v;
+            if (v < r.min)
+            {
+                r.min = v;
+            }
+            if (v > r.max)
+            {
+                r.max = v;
+            }
+        }
+
+        r.avg = (uint16_t)(sum / HALF_LEN);
+        blocks++;
+
+        /* telemetry only keeps the newest results */
+        (void)os_queue_send(&res_q, &r, 0U);
+    }
+}
+
+   /*--------------------------------------------------
+    * telemetry thread: newest result every TELEM_MS
+    *-------------------------------------------------*/
+static void telem_run(void *arg)
+{
+    uint32_t last = os_ticks();
+
+    (void)arg;
+
+    while (1)
+    {
+        dsp_result_t r;
+        dsp_result_t newest = { 0U, 0U, 0U, 0U };
+        uint32_t n = 0U;
+
+        os_sleep_until(&last, TELEM_MS * OS_TICK_HZ / 1000U);
+
+        while (os_queue_recv(&res_q, &r, 0U) == OS_OK)
+        {
+            newest = r;
+            n++;
+        }
+
+        if (n == 0U)
+        {
+            continue;
+        }
+
+        (void)os_sem_wait(&uart_lock, OS_WAIT_FOREVER);
+        usart2_send_string("AVG=");
+        usart2_send_u32(newest.avg);
+        usart2_send_string(" MIN=");
+        usart2_send_u32(newest.min);
+        usart2_send_string(" MAX=");
+        usart2_send_u32(newest.max);
+        usart2_send_string(" lat=");
+        usart2_send_u32(lat_min);
+        usart2_send_string("..");
+        usart2_send_u32(lat_max);
+        usart2_send_string(" cyc\r\n");
+        os_sem_post(&uart_lock);
+    }
+}
+
+static void print_thread(const os_thread_t *t)
+{
+    usart2_send_string(t->name);
+    usart2_send_string(" prio=");
+    usart2_send_u32(t->prio);
+    usart2_send_string(" switches=");
+    usart2_send_u32(t->switches);
+    usart2_send_string(" stack_free=");
+    usart2_send_u32(os_stack_free(t));
+    usart2_send_string("w\r\n");
+}
+
+static void set_rate(uint32_t hz)
+{
+    if (hz == 0U)
+    {
+        return;
+    }
+
+    TIM2->ARR = (SCLK / hz) - 1U;              /* preloaded, next update */
+}
+
+   /*--------------------------------------------------
+    * command thread: "r<hz>" CR, "s" CR
+    *-------------------------------------------------*/
+static void cmd_run(void *arg)
+{
+    char cmd = 0;
+    uint32_t value = 0U;
+
+    (void)arg;
+
+    while (1)
+    {
+        uint8_t b;
+
+        if (os_queue_recv(&rx_q, &b, OS_WAIT_FOREVER) != OS_OK)
+        {
+            continue;
+        }
+
+        if ((b == 'r') || (b == 's'))
+        {
+            cmd = (char)b;
+            value = 0U;
+        }
+        else if ((b >= '0') && (b <= '9'))
+        {
+            value = value * 10U + (uint32_t)(b - '0');
+        }
+        else if ((b == '\r') || (b == '\n'))
+        {
+            (void)os_sem_wait(&uart_lock, OS_WAIT_FOREVER);
+
+            if (cmd == 'r')
+            {
+                set_rate(value);
+                usart2_send_string("rate ");
+                usart2_send_u32(value);
+                usart2_send_string(" Hz\r\n");
+            }
+            else if (cmd == 's')
+            {
+                usart2_send_string("blocks=");
+                usart2_send_u32(blocks);
+                usart2_send_string(" dropped=");
+                usart2_send_u32(blk_q.dropped);
+                usart2_send_string(" idle_sleeps=");
+                usart2_send_u32(os_idle_sleeps());
+                usart2_send_string("\r\n");
+                print_thread(&dsp_thread);
+                print_thread(&cmd_thread);
+                print_thread(&telem_thread);
+            }
+
+            os_sem_post(&uart_lock);
+            cmd = 0;
+            value = 0U;
+        }
+    }
+}
+
+int main(void)
+{
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN | RCC_APB1ENR_TIM2EN;
+    RCC->APB2ENR |= RCC_APB2ENR_ADC1EN;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+   /*--------------------------------------------------
+    * 2) PA0 analog, USART2 on PA2 / PA3 (AF7), RX IRQ
+    *-------------------------------------------------*/
+    GPIOA->MODER |= GPIO_MODER_MODER0;
+    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR0;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_RXNEIE | USART_CR1_UE;
+
+    usart2_send_string("RTOS ADC: r<hz> / s\r\n");
+
+   /*--------------------------------------------------
+    * 3) Kernel objects and threads
+    *-------------------------------------------------*/
+    os_init();
+
+    os_queue_init(&blk_q, blk_buf, sizeof(blk_buf[0]), 4U);
+    os_queue_init(&rx_q, rx_buf, 1U, sizeof(rx_buf));
+    os_queue_init(&res_q, res_buf, sizeof(res_buf[0]), 8U);
+    os_sem_init(&uart_lock, 1U);
+
+    (void)os_thread_create(&dsp_thread, "dsp", dsp_run, 0, 1U, dsp_stack, 256U);
+    (void)os_thread_create(&cmd_thread, "command", cmd_run, 0, 2U, cmd_stack, 256U);
+    (void)os_thread_create(&telem_thread, "telemetry", telem_run, 0, 3U, telem_stack, 256U);
+
+   /*--------------------------------------------------
+    * 4) TIM2 TRGO at START_HZ, ARR preloaded
+    *-------------------------------------------------*/
+    TIM2->PSC = 0U;
+    TIM2->ARR = (SCLK / START_HZ) - 1U;
+    TIM2->CR1 |= TIM_CR1_ARPE;
+    TIM2->CR2 = (TIM2->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+    TIM2->EGR = TIM_EGR_UG;
+
+   /*--------------------------------------------------
+    * 5) ADC1 on TIM2 TRGO, DMA requests kept on
+    *-------------------------------------------------*/
+    ADC->CCR = (ADC->CCR & ~ADC_CCR_ADCPRE) | ADC_CCR_ADCPRE_0;   /* PCLK2/4 */
+
+    ADC1->SMPR2 = (ADC1->SMPR2 & ~ADC_SMPR2_SMP0) | (3U << ADC_SMPR2_SMP0_Pos);
+    ADC1->SQR1 &= ~ADC_SQR1_L;
+    ADC1->SQR3 &= ~ADC_SQR3_SQ1;
+
+    ADC1->CR2 &= ~(ADC_CR2_CONT | ADC_CR2_ALIGN | ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+    ADC1->CR2 |=  (6U << ADC_CR2_EXTSEL_Pos) | ADC_CR2_EXTEN_0;  /* TIM2 TRGO */
+    ADC1->CR2 |=  ADC_CR2_DMA | ADC_CR2_DDS;
+
+   /*--------------------------------------------------
+    * 6) ADC1 DMA stream, HT / TC to adc_dma_done
+    *-------------------------------------------------*/
+    {
+        dma_stream_t *adc_dma = dma_alloc(DMA_REQ_ADC1);
+        dma_desc_t desc =
+        {
+            .dir      = DMA_DIR_P2M,
+            .psize    = DMA_WIDTH_16,
+            .msize    = DMA_WIDTH_16,
+            .minc     = 1U,
+            .circular = 1U,
+            .periph   = (uint32_t)&ADC1->DR,
+            .mem0     = (uint32_t)adc_buf,
+            .count    = ADC_BUF_LEN,
+            .events   = DMA_EVT_HT | DMA_EVT_TC,
+            .callback = adc_dma_done,
+        };
+
+        dma_config(adc_dma, &desc);
+        dma_start(adc_dma);
+    }
+
+    NVIC_EnableIRQ(USART2_IRQn);
+
+   /*--------------------------------------------------
+    * 7) Start: ADC on, TIM2 running, kernel takes over
+    *-------------------------------------------------*/
+    ADC1->CR2 |= ADC_CR2_ADON;
+    TIM2->CR1 |= TIM_CR1_CEN;
+
+    os_start();
+}
@@ -1,4 +1,7 @@
 #include "stm32f4xx.h"
+#include "gpio.h"
+
+#define LED  GPIO_PA(5)
 
    /*--------------------------------------------------
     * This code explains the usage of timer interrupts
@@ -19,40 +22,33 @@ void TIM2_IRQHandler(void)
     if (TIM2->SR & TIM_SR_UIF)
     {
         TIM2->SR &= ~TIM_SR_UIF;        /* clear flag */
-        GPIOA->ODR ^= GPIO_ODR_OD5;     /* toggle LED on PA5 */
+        gpio_toggle(LED);               /* toggle LED on PA5: reads ODR, writes BSRR */
     }
 }
 
 int main(void)
 {
    /*--------------------------------------------------
-    * 1) Enable GPIOA clock (RCC AHB1ENR)
-    *-------------------------------------------------*/
-    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
-     
-   /*--------------------------------------------------
-    * 2) Configure PA5 as push-pull output
+    * 1) Enable GPIOA clock, configure PA5 as
+    *    push-pull output
     *    - MODER5 = 01 (output)
     *    - OTYPER5 = 0 (push-pull)
     *    - OSPEEDR5 = 11 (high speed, optional)
     *    - PUPDR5 = 00 (no pull-up / pull-down)
+    *    gpio_config() writes each register once
     *-------------------------------------------------*/
-     
-    /* MODER: clear pin 5 and set it to output (01) */
-    GPIOA->MODER &= ~GPIO_MODER_MODER5;
-    GPIOA->MODER |=  GPIO_MODER_MODER5_0;
-     
-    /* OTYPER: push-pull (bit = 0) */
-    GPIOA->OTYPER &= ~GPIO_OTYPER_OT_5;
-     
-    /* OSPEEDR: set pin 5 output to high speed (11) */
-    GPIOA->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR5;
-     
-    /* PUPDR: no pull-up, no pull-down on PA5 */
-    GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR5;
+    {
+        static const gpio_cfg_t pins[] =
+        {
+            { .port = GPIO_PORT_A, .pins = 1U << 5, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_HIGH, .pull = GPIO_PULL_NONE },
+        };
+
+        gpio_config(pins, 1U);
+    }
      
    /*--------------------------------------------------
-    * 3) Configure Timer 2 interrupt
+    * 2) Configure Timer 2 interrupt
     *
     *    Timer clock assumed 16 MHz (HSI, no PLL).
     *    We want 500 ms period:
@@ -96,8 +92,8 @@ int main(void)
     /* Main loop: all the work happens in the interrupt */
     while (1)
     {
-        /* optional: low power wait for interrupt */
-        /* __WFI(); */
+        /* sleep until the next interrupt */
+        __WFI();
     }
 }
 
@@ -1,20 +1,23 @@
 #include "stm32f4xx.h"
+#include "sched.h"
+#include "gpio.h"
 
 #define SCLK 16000000U
 #define BAUD 9600U
+#define LED  GPIO_PA(5)
 
    /*--------------------------------------------------
     * TIM2 TRGO triggers ADC1 conversion
     * ADC end of conversion triggers ADC interrupt
-    * Main loop prints ADC value using USART2
+    * The ISR posts each value to print_task, the
+    * scheduler prints it and sleeps in between
     *
     * LED on PA5 toggles on each ADC interrupt
     * ADC input on PA0 (ADC1 channel 0)
     * USART2 on PA2 TX and PA3 RX (AF7)
     *-------------------------------------------------*/
 
-volatile uint32_t adc_value = 0;
-volatile uint32_t adc_ready_flag = 0;
+static int print_task;
 
    /*--------------------------------------------------
     * Send one character over USART2 (blocking)
@@ -67,57 +70,58 @@ static void usart2_send_u32(uint32_t v)
 
    /*--------------------------------------------------
     * ADC interrupt handler
-    * Reads ADC1->DR and sets adc_ready_flag
+    * Reads ADC1->DR and posts it to print_task
     *-------------------------------------------------*/
 void ADC_IRQHandler(void)
 {
     /* check EOC flag */
     if ((ADC1->SR >> 1U) & 1U)             /* ADC_SR_EOC bit 1 */
     {
-        adc_value = (uint32_t)ADC1->DR;    /* reading DR clears EOC */
-        adc_ready_flag = 1U;
+        /* reading DR clears EOC */
+        sched_post(print_task, (uint32_t)ADC1->DR);
 
         /* toggle LED PA5 */
-        GPIOA->ODR ^= (1U << 5U);          /* GPIO_ODR_OD5 */
+        gpio_toggle(LED);                  /* reads ODR, writes BSRR */
     }
 }
 
-int main(void)
-{
    /*--------------------------------------------------
-    * 1) Enable GPIOA clock
+    * Print task, arg is the converted value
     *-------------------------------------------------*/
-    RCC->AHB1ENR |= (1U << 0U);            /* RCC_AHB1ENR_GPIOAEN */
-
-   /*--------------------------------------------------
-    * 2) Configure PA5 as output (LED)
-    * MODER5 = 01, OT5 = 0, OSPEED5 = 11, PUPD5 = 00
-    *-------------------------------------------------*/
-    GPIOA->MODER &= ~(3U << (5U * 2U));    /* ~GPIO_MODER_MODER5 */
-    GPIOA->MODER |=  (1U << (5U * 2U));    /* GPIO_MODER_MODER5_0 */
-
-    GPIOA->OTYPER &= ~(1U << 5U);          /* ~GPIO_OTYPER_OT_5 */
-
-    GPIOA->OSPEEDR &= ~(3U << (5U * 2U));  /* clear speed bits */
-    GPIOA->OSPEEDR |=  (3U << (5U * 2U));  /* OSPEED5 = 11 */
+static void print_run(uint32_t value, void *ctx)
+{
+    (void)ctx;
 
-    GPIOA->PUPDR &= ~(3U << (5U * 2U));    /* ~GPIO_PUPDR_PUPDR5 */
+    usart2_send_string("ADC = ");
+    usart2_send_u32(value);
+    usart2_send_string("\r\n");
+}
 
+int main(void)
+{
    /*--------------------------------------------------
-    * 3) Configure USART2 pins PA2 and PA3
-    * MODER2 = 10, MODER3 = 10, AFRL2 = AF7, AFRL3 = AF7
+    * 1) GPIOA clock and all pins in one pass
+    * PA5 LED:        MODER5 = 01, OT5 = 0, OSPEED5 = 11
+    * PA2 / PA3:      MODER = 10, AFRL = AF7 (USART2)
+    * PA0 ADC1 ch0:   MODER0 = 11, PUPD0 = 00
+    * one masked write per GPIOA register
     *-------------------------------------------------*/
-    GPIOA->MODER &= ~(3U << (2U * 2U));    /* ~GPIO_MODER_MODER2 */
-    GPIOA->MODER |=  (2U << (2U * 2U));    /* GPIO_MODER_MODER2_1 */
-
-    GPIOA->MODER &= ~(3U << (3U * 2U));    /* ~GPIO_MODER_MODER3 */
-    GPIOA->MODER |=  (2U << (3U * 2U));    /* GPIO_MODER_MODER3_1 */
-
-    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U))); /* clear AFRL */
-    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));   /* AF7 USART2 */
+    {
+        static const gpio_cfg_t pins[] =
+        {
+            { .port = GPIO_PORT_A, .pins = 1U << 5, .mode = GPIO_MODE_OUTPUT,
+              .speed = GPIO_SPEED_HIGH, .pull = GPIO_PULL_NONE },
+            { .port = GPIO_PORT_A, .pins = (1U << 2) | (1U << 3), .mode = GPIO_MODE_AF,
+              .af = 7U, .pull = GPIO_PULL_NONE },
+            { .port = GPIO_PORT_A, .pins = 1U << 0, .mode = GPIO_MODE_ANALOG,
+              .pull = GPIO_PULL_NONE },
+        };
+
+        gpio_config(pins, sizeof(pins) / sizeof(pins[0]));
+    }
 
    /*--------------------------------------------------
-    * 4) Enable USART2 clock and configure USART2
+    * 2) Enable USART2 clock and configure USART2
     * APB1ENR USART2EN bit 17
     * CR1 TE bit 3, RE bit 2, UE bit 13
     *-------------------------------------------------*/
@@ -132,14 +136,7 @@ int main(void)
     usart2_send_string("TIM2 TRGO ADC IRQ\r\n");
 
    /*--------------------------------------------------
-    * 5) Configure PA0 as analog input (ADC1 channel 0)
-    * MODER0 = 11, PUPD0 = 00
-    *-------------------------------------------------*/
-    GPIOA->MODER |= (3U << (0U * 2U));     /* GPIO_MODER_MODER0 */
-    GPIOA->PUPDR &= ~(3U << (0U * 2U));    /* ~GPIO_PUPDR_PUPDR0 */
-
-   /*--------------------------------------------------
-    * 6) Configure TIM2 for periodic update and TRGO
+    * 3) Configure TIM2 for periodic update and TRGO
     * APB1ENR TIM2EN bit 0
     * PSC = 16000-1 -> 1 kHz
     * ARR = 500-1   -> 500 ms
@@ -156,7 +153,7 @@ int main(void)
     TIM2->EGR = (1U << 0U);                /* TIM_EGR_UG */
 
    /*--------------------------------------------------
-    * 7) Configure ADC1 external trigger and interrupt
+    * 4) Configure ADC1 external trigger and interrupt
     * APB2ENR ADC1EN bit 8
     *
     * ADC common prescaler ADCPRE bits [17:16] set to 01 (PCLK2/4)
@@ -192,6 +189,10 @@ int main(void)
     ADC1->CR2 &= ~(3U << 28U);             /* clear EXTEN[29:28] */
     ADC1->CR2 |=  (1U << 28U);             /* EXTEN = 01 rising edge */
 
+    /* scheduler task before the first EOC can post */
+    sched_init();
+    print_task = sched_task_add(print_run, 0U, 0);
+
     /* enable ADC interrupt in NVIC (ADC_IRQn = 18) */
     NVIC->ISER[0] |= (1U << 18U);          /* NVIC_ISER0 set bit 18 */
 
@@ -199,26 +200,13 @@ int main(void)
     ADC1->CR2 |= (1U << 0U);               /* ADC_CR2_ADON */
 
    /*--------------------------------------------------
-    * 8) Start TIM2
+    * 5) Start TIM2
     * ADC starts conversions automatically on TRGO
     *-------------------------------------------------*/
     TIM2->CR1 |= (1U << 0U);               /* TIM_CR1_CEN */
 
    /*--------------------------------------------------
-    * 9) Main loop prints ADC value when ready
+    * 6) Scheduler runs print_task for every value
     *-------------------------------------------------*/
-    while (1)
-    {
-        if (adc_ready_flag)
-        {
-            adc_ready_flag = 0U;
-
-            usart2_send_string("ADC = ");
-            usart2_send_u32(adc_value);
-            usart2_send_string("\r\n");
-        }
-
-        /* optional low power */
-        /* __WFI(); */
-    }
+    sched_run();
 }
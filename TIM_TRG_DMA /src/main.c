@@ -1,13 +1,24 @@
 #include "stm32f4xx.h"
+#include "dma.h"
+#include "sched.h"
+#include "swtimer.h"
 
 #define SCLK 16000000U
 #define BAUD 9600U
 
 #define ADC_BUF_LEN 64U
 
+#define HALF_LEN    (ADC_BUF_LEN / 2U)
+#define STATS_EVERY 16U                         /* blocks between stats lines */
+#define TIM2_TICK_US 1U                         /* TIM2 count = 1 us */
+#define SAMPLE_US   (10000U * TIM2_TICK_US)     /* TRGO period */
+
 volatile uint16_t adc_buf[ADC_BUF_LEN];
-volatile uint32_t dma_half_flag = 0;
-volatile uint32_t dma_full_flag = 0;
+
+static volatile uint64_t block_t0[2];          /* us, first sample of each half */
+
+static int block_task;
+static int stats_task;
 
    /*--------------------------------------------------
     * USART2 send helpers (blocking)
@@ -52,38 +63,117 @@ static void usart2_send_u32(uint32_t v)
     }
 }
 
+static void usart2_send_u64(uint64_t v)
+{
+    char buf[20];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 20)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
    /*--------------------------------------------------
-    * DMA2 Stream0 interrupt handler
-    * Sets half or full buffer flags
+    * DMA completion callback (runs in the stream ISR)
+    * Stamps the finished half and posts its index to
+    * block_task. The last sample was triggered by the
+    * TIM2 update TIM2->CNT us ago, not by this IRQ, so
+    * the stamp does not depend on interrupt latency.
     *-------------------------------------------------*/
-void DMA2_Stream0_IRQHandler(void)
+static void adc_dma_done(dma_stream_t *s, uint32_t events, void *ctx)
 {
-    /* DMA2 low interrupt status register flags for Stream0 */
-    /* HTIF0 bit 4, TCIF0 bit 5 in DMA2->LISR */
-    if ((DMA2->LISR >> 4U) & 1U)                /* DMA_LISR_HTIF0 */
+    uint64_t t_last = timebase_now64() - ((uint64_t)TIM2->CNT * TIM2_TICK_US);
+    uint64_t t_first = t_last - ((uint64_t)(HALF_LEN - 1U) * SAMPLE_US);
+
+    (void)s;
+    (void)ctx;
+
+    if (events & DMA_EVT_HT)
     {
-        DMA2->LIFCR = (1U << 4U);               /* DMA_LIFCR_CHTIF0 clear */
-        dma_half_flag = 1U;
+        block_t0[0] = t_first;
+        sched_post(block_task, 0U);
     }
 
-    if ((DMA2->LISR >> 5U) & 1U)                /* DMA_LISR_TCIF0 */
+    if (events & DMA_EVT_TC)
     {
-        DMA2->LIFCR = (1U << 5U);               /* DMA_LIFCR_CTCIF0 clear */
-        dma_full_flag = 1U;
+        block_t0[1] = t_first;
+        sched_post(block_task, HALF_LEN);
     }
+}
+
+   /*--------------------------------------------------
+    * Block task: print the average of one half and
+    * the time of its first sample (us)
+    *-------------------------------------------------*/
+static void block_run(uint32_t first, void *ctx)
+{
+    static uint32_t blocks = 0U;
+    uint32_t sum = 0U;
+    uint32_t i;
 
-    /* optional clear TEIF0, DMEIF0, FEIF0 if needed */
-    if ((DMA2->LISR >> 3U) & 1U)                /* DMA_LISR_TEIF0 */
+    (void)ctx;
+
+    for (i = first; i < (first + HALF_LEN); i++)
     {
-        DMA2->LIFCR = (1U << 3U);               /* DMA_LIFCR_CTEIF0 */
+        sum += (uint32_t)adc_buf[i];
     }
-    if ((DMA2->LISR >> 2U) & 1U)                /* DMA_LISR_DMEIF0 */
+
+    usart2_send_string((first == 0U) ? "AVG0 = " : "AVG1 = ");
+    usart2_send_u32(sum / HALF_LEN);
+    usart2_send_string(" t0 = ");
+    usart2_send_u64(block_t0[(first == 0U) ? 0U : 1U]);
+    usart2_send_string("\r\n");
+
+    if (++blocks >= STATS_EVERY)
     {
-        DMA2->LIFCR = (1U << 2U);               /* DMA_LIFCR_CDMEIF0 */
+        blocks = 0U;
+        sched_post(stats_task, 0U);
     }
-    if ((DMA2->LISR >> 0U) & 1U)                /* DMA_LISR_FEIF0 */
+}
+
+   /*--------------------------------------------------
+    * Stats task (low priority): run time per task
+    *-------------------------------------------------*/
+static void stats_run(uint32_t arg, void *ctx)
+{
+    const sched_stats_t *st = sched_stats(block_task);
+
+    (void)arg;
+    (void)ctx;
+
+    usart2_send_string("block runs=");
+    usart2_send_u32(st->runs);
+    usart2_send_string(" avg=");
+    usart2_send_u32(st->cycles / st->runs);
+    usart2_send_string(" max=");
+    usart2_send_u32(st->max_cycles);
+    usart2_send_string(" cyc, dropped=");
+    usart2_send_u32(st->dropped);
+    usart2_send_string(" sleeps=");
+    usart2_send_u32(sched_sleeps());
+    usart2_send_string("\r\n");
+}
+
+static void stop(const char *what)
+{
+    usart2_send_string(what);
+    usart2_send_string(" failed\r\n");
+    while (1)
     {
-        DMA2->LIFCR = (1U << 0U);               /* DMA_LIFCR_CFEIF0 */
+        /* stay here */
     }
 }
 
@@ -133,28 +223,26 @@ int main(void)
     GPIOA->PUPDR &= ~(3U << (0U * 2U));         /* ~GPIO_PUPDR_PUPDR0 */
 
    /*--------------------------------------------------
-    * 5) Enable DMA2 clock
-    *-------------------------------------------------*/
-    RCC->AHB1ENR |= (1U << 22U);                /* RCC_AHB1ENR_DMA2EN */
-
-   /*--------------------------------------------------
-    * 6) Configure TIM2 for periodic update and TRGO
-    * PSC = 16000-1 -> 1 kHz
-    * ARR = 10-1    -> 10 ms sample period (100 Hz)
+    * 5) Configure TIM2 for periodic update and TRGO
+    * PSC = 16-1    -> 1 MHz, CNT in us for the stamps
+    * ARR = 10000-1 -> 10 ms sample period (100 Hz)
     * MMS = 010 update event as TRGO
     *-------------------------------------------------*/
     RCC->APB1ENR |= (1U << 0U);                 /* RCC_APB1ENR_TIM2EN */
 
-    TIM2->PSC = 16000U - 1U;
-    TIM2->ARR = 10U - 1U;
+    TIM2->PSC = 16U - 1U;
+    TIM2->ARR = 10000U - 1U;
 
     TIM2->CR2 &= ~(7U << 4U);                   /* clear TIM_CR2_MMS */
     TIM2->CR2 |=  (2U << 4U);                   /* MMS = 010 update as TRGO */
 
     TIM2->EGR = (1U << 0U);                     /* TIM_EGR_UG */
 
+    /* 64-bit us timebase (TIM5) for the block timestamps */
+    timebase_init();
+
    /*--------------------------------------------------
-    * 7) Configure ADC1
+    * 6) Configure ADC1
     * external trigger TIM2 TRGO rising edge
     * enable DMA in ADC
     *-------------------------------------------------*/
@@ -187,108 +275,53 @@ int main(void)
     ADC1->CR2 |= (1U << 9U);                    /* ADC_CR2_DDS */
 
    /*--------------------------------------------------
-    * 8) Configure DMA2 Stream0 for ADC1->DR to adc_buf
-    * CHSEL = 0 (channel 0)
-    * DIR = 00 (peripheral to memory)
-    * CIRC = 1
-    * MINC = 1
-    * PSIZE = 01 (16-bit)
-    * MSIZE = 01 (16-bit)
-    * HTIE = 1, TCIE = 1
+    * 7) Configure the ADC1 DMA stream
+    * dma_alloc picks DMA2 Stream0 or Stream4 (channel 0)
+    * peripheral to memory, circular, 16-bit both sides
+    * HT and TC events to adc_dma_done, which posts
+    * to the scheduler tasks created first
     *-------------------------------------------------*/
+    sched_init();
+    block_task = sched_task_add(block_run, 0U, 0);
+    stats_task = sched_task_add(stats_run, 2U, 0);
 
-    /* disable stream before config */
-    DMA2_Stream0->CR &= ~(1U << 0U);            /* DMA_SxCR_EN */
-    while ((DMA2_Stream0->CR >> 0U) & 1U)
     {
-        /* wait until disabled */
+        dma_stream_t *adc_dma = dma_alloc(DMA_REQ_ADC1);
+        dma_desc_t desc =
+        {
+            .dir      = DMA_DIR_P2M,
+            .psize    = DMA_WIDTH_16,
+            .msize    = DMA_WIDTH_16,
+            .minc     = 1U,
+            .circular = 1U,
+            .periph   = (uint32_t)&ADC1->DR,
+            .mem0     = (uint32_t)adc_buf,
+            .count    = ADC_BUF_LEN,
+            .events   = DMA_EVT_HT | DMA_EVT_TC,
+            .callback = adc_dma_done,
+        };
+
+        if (adc_dma == 0)
+        {
+            stop("adc dma alloc");
+        }
+        if (dma_config(adc_dma, &desc) != DMA_OK)
+        {
+            stop("adc dma config");
+        }
+        dma_start(adc_dma);
     }
 
-    /* clear pending flags for stream0 */
-    DMA2->LIFCR = (1U << 0U) | (1U << 2U) | (1U << 3U) | (1U << 4U) | (1U << 5U);
-
-    DMA2_Stream0->PAR  = (uint32_t)&ADC1->DR;   /* peripheral address */
-    DMA2_Stream0->M0AR = (uint32_t)adc_buf;     /* memory address */
-    DMA2_Stream0->NDTR = (uint32_t)ADC_BUF_LEN; /* number of transfers */
-
-    DMA2_Stream0->CR = 0;
-
-    DMA2_Stream0->CR &= ~(7U << 25U);           /* CHSEL */
-    DMA2_Stream0->CR |=  (0U << 25U);           /* channel 0 */
-
-    DMA2_Stream0->CR &= ~(3U << 6U);            /* DIR */
-    DMA2_Stream0->CR |=  (0U << 6U);            /* peripheral to memory */
-
-    DMA2_Stream0->CR |= (1U << 8U);             /* CIRC */
-    DMA2_Stream0->CR |= (1U << 10U);            /* MINC */
-
-    DMA2_Stream0->CR &= ~(3U << 11U);           /* PSIZE */
-    DMA2_Stream0->CR |=  (1U << 11U);           /* PSIZE = 01 16-bit */
-
-    DMA2_Stream0->CR &= ~(3U << 13U);           /* MSIZE */
-    DMA2_Stream0->CR |=  (1U << 13U);           /* MSIZE = 01 16-bit */
-
-    DMA2_Stream0->CR |= (1U << 3U);             /* HTIE */
-    DMA2_Stream0->CR |= (1U << 4U);             /* TCIE */
-
-    /* enable DMA2 Stream0 IRQ in NVIC
-       DMA2_Stream0_IRQn is usually 56 on STM32F4
-       56 -> ISER[1] bit 24 (because 32..63 in ISER[1])
-    */
-    NVIC->ISER[1] |= (1U << 24U);
-
-    /* enable stream */
-    DMA2_Stream0->CR |= (1U << 0U);             /* EN */
-
    /*--------------------------------------------------
-    * 9) Enable ADC and start TIM2
+    * 8) Enable ADC and start TIM2
     *-------------------------------------------------*/
     ADC1->CR2 |= (1U << 0U);                    /* ADC_CR2_ADON */
 
     TIM2->CR1 |= (1U << 0U);                    /* TIM_CR1_CEN */
 
    /*--------------------------------------------------
-    * 10) Main loop
-    * Print average of half buffer or full buffer
+    * 9) Scheduler: the DMA callback posts finished
+    *    halves, the core sleeps in between
     *-------------------------------------------------*/
-    while (1)
-    {
-        if (dma_half_flag)
-        {
-            uint32_t sum = 0;
-            uint32_t i;
-
-            dma_half_flag = 0;
-
-            for (i = 0; i < (ADC_BUF_LEN / 2U); i++)
-            {
-                sum += (uint32_t)adc_buf[i];
-            }
-
-            usart2_send_string("AVG0 = ");
-            usart2_send_u32(sum / (ADC_BUF_LEN / 2U));
-            usart2_send_string("\r\n");
-        }
-
-        if (dma_full_flag)
-        {
-            uint32_t sum = 0;
-            uint32_t i;
-
-            dma_full_flag = 0;
-
-            for (i = (ADC_BUF_LEN / 2U); i < ADC_BUF_LEN; i++)
-            {
-                sum += (uint32_t)adc_buf[i];
-            }
-
-            usart2_send_string("AVG1 = ");
-            usart2_send_u32(sum / (ADC_BUF_LEN / 2U));
-            usart2_send_string("\r\n");
-        }
-
-        /* optional low power */
-        /* __WFI(); */
-    }
+    sched_run();
 }
-
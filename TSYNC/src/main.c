@@ -0,0 +1,179 @@
+#include "stm32f4xx.h"
+#include "pwm.h"
+#include "tsync.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Timer chaining
+    *
+    * Synchronized start: TIM1 (master, MMS = enable)
+    * and TIM3 / TIM4 (trigger mode slaves) run 10 kHz
+    * PWM at 25 % duty. TIM3 is preloaded a quarter
+    * period ahead, TIM4 half a period; one CEN on TIM1
+    * starts the slaves a fixed few clocks after it
+    * (trigger resynchronization), the same lag on
+    * every boot, so the outputs stay 90 / 180 degrees
+    * apart to within those clocks:
+    *   PA8 TIM1_CH1, PA6 TIM3_CH1, PB6 TIM4_CH1
+    *
+    * 48-bit cascade: TIM2 (32-bit, 16 MHz) sends its
+    * update to TIM9, which counts the wraps. Once per
+    * second the 48-bit time and the counter offsets of
+    * the group (read back to back) are printed.
+    *-------------------------------------------------*/
+
+#define PWM_HZ  10000U
+
+static pwm_t pwm1;
+static pwm_t pwm3;
+static pwm_t pwm4;
+
+static tsync_cascade_t clock48;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u64(uint64_t v)
+{
+    char buf[20];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 20)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static void pwm_setup(pwm_t *p, TIM_TypeDef *tim)
+{
+    pwm_cfg_t cfg =
+    {
+        .tim     = tim,
+        .freq_hz = PWM_HZ,
+        .align   = PWM_ALIGN_EDGE,
+    };
+
+    (void)pwm_init(p, &cfg);
+    (void)pwm_channel(p, 1U, 0U, 0U);
+    pwm_set_permille(p, 1U, 250U);
+}
+
+int main(void)
+{
+    static TIM_TypeDef *const slaves[2] = { TIM3, TIM4 };
+    uint32_t phase[2];
+    uint64_t last = 0U;
+
+   /*--------------------------------------------------
+    * 1) Clocks, USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_GPIOBEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+   /*--------------------------------------------------
+    * 2) PWM pins: PA8 (AF1), PA6 (AF2), PB6 (AF2)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER8);
+    GPIOA->MODER |=  (GPIO_MODER_MODER6_1 | GPIO_MODER_MODER8_1);
+    GPIOA->AFR[0] &= ~(0xFU << (6U * 4U));
+    GPIOA->AFR[0] |=  (2U  << (6U * 4U));
+    GPIOA->AFR[1] &= ~(0xFU << ((8U - 8U) * 4U));
+    GPIOA->AFR[1] |=  (1U  << ((8U - 8U) * 4U));
+
+    GPIOB->MODER &= ~GPIO_MODER_MODER6;
+    GPIOB->MODER |=  GPIO_MODER_MODER6_1;
+    GPIOB->AFR[0] &= ~(0xFU << (6U * 4U));
+    GPIOB->AFR[0] |=  (2U  << (6U * 4U));
+
+   /*--------------------------------------------------
+    * 3) Group: TIM1 master, TIM3 / TIM4 phase shifted
+    *-------------------------------------------------*/
+    pwm_setup(&pwm1, TIM1);
+    pwm_setup(&pwm3, TIM3);
+    pwm_setup(&pwm4, TIM4);
+
+    phase[0] = pwm3.period / 4U;
+    phase[1] = pwm4.period / 2U;
+
+    if (tsync_group(TIM1, slaves, phase, 2U) != TSYNC_OK)
+    {
+        usart2_send_string("no trigger path\r\n");
+    }
+
+    TIM1->BDTR |= TIM_BDTR_MOE;                /* TIM1 outputs */
+    tsync_start(TIM1);
+
+   /*--------------------------------------------------
+    * 4) 48-bit clock: TIM2 low, TIM9 high
+    *-------------------------------------------------*/
+    (void)tsync_cascade_init(&clock48, TIM2, TIM9);
+
+    usart2_send_string("timer sync\r\n");
+
+    while (1)
+    {
+        uint64_t now = tsync_cascade_read(&clock48);
+        uint32_t c1;
+        uint32_t c3;
+        uint32_t c4;
+
+        if ((now - last) < SCLK)
+        {
+            continue;
+        }
+        last = now;
+
+        /* back to back reads, each a few clocks after the one before */
+        c1 = TIM1->CNT;
+        c3 = TIM3->CNT;
+        c4 = TIM4->CNT;
+
+        usart2_send_string("t48=");
+        usart2_send_u64(now);
+        usart2_send_string(" tim3-tim1=");
+        usart2_send_u64((c3 + pwm1.period - c1) % pwm1.period);
+        usart2_send_string(" tim4-tim1=");
+        usart2_send_u64((c4 + pwm1.period - c1) % pwm1.period);
+        usart2_send_string("\r\n");
+    }
+}
@@ -0,0 +1,238 @@
+#include "stm32f4xx.h"
+#include "swtimer.h"
+#include "sched.h"
+#include "twheel.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Timer wheel on the tickless timebase
+    *
+    * N_TIMERS timers run as a workload: each one
+    * re-arms itself with a random 10 ms .. 5 s delay,
+    * every second one coalesced to 16 ms. The wheel
+    * ticks in 1 ms steps, but nothing runs every 1 ms:
+    * a one-shot TIM5 software timer wakes the wheel
+    * task only at twheel_next(), and the callbacks run
+    * in that scheduler task, not in the interrupt.
+    * Once per second the fire count, wake-ups and
+    * scheduler sleeps are printed.
+    *
+    * The benchmark with 10k+ timers runs on the host:
+    * make -C common/host test.
+    *-------------------------------------------------*/
+
+#define N_TIMERS     1024U
+#define TICK_US      1000U                     /* wheel tick, 1 ms */
+#define DELAY_MIN    10U                       /* ticks */
+#define DELAY_SPAN   5000U
+#define GRANULE      16U                       /* coalescing, ticks */
+#define REPORT_US    1000000U
+
+static twheel_t       wheel;
+static twheel_timer_t timers[N_TIMERS];
+
+static swtimer_t wake_timer;
+static swtimer_t report_timer;
+
+static int task_wheel;
+static int task_report;
+
+static uint32_t wheel_us;                      /* timebase of the last tick */
+static uint32_t fired = 0U;
+static uint32_t wakeups = 0U;
+static uint32_t rng = 1U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+static uint32_t rand_delay(void)
+{
+    rng = (rng * 1664525U) + 1013904223U;
+
+    return DELAY_MIN + ((rng >> 8) % DELAY_SPAN);
+}
+
+   /*--------------------------------------------------
+    * Workload callback (wheel task context)
+    *-------------------------------------------------*/
+static void work_fn(twheel_timer_t *t, void *ctx)
+{
+    (void)ctx;
+
+    fired++;
+
+    if ((uint32_t)(t - timers) & 1U)
+    {
+        twheel_arm_coalesced(&wheel, t, rand_delay(), GRANULE);
+    }
+    else
+    {
+        twheel_arm(&wheel, t, rand_delay());
+    }
+}
+
+   /*--------------------------------------------------
+    * TIM5 interrupt callbacks: only post to the tasks
+    *-------------------------------------------------*/
+static void wake_cb(swtimer_t *t, void *ctx)
+{
+    (void)t;
+    (void)ctx;
+
+    (void)sched_post(task_wheel, 0U);
+}
+
+static void report_cb(swtimer_t *t, void *ctx)
+{
+    (void)t;
+    (void)ctx;
+
+    (void)sched_post(task_report, 0U);
+}
+
+   /*--------------------------------------------------
+    * Wheel task: bring the wheel up to the timebase,
+    * run what expired, sleep until the next tick that
+    * has work
+    *-------------------------------------------------*/
+static void wheel_task(uint32_t arg, void *ctx)
+{
+    uint32_t ticks;
+    uint32_t next;
+
+    (void)arg;
+    (void)ctx;
+
+    wakeups++;
+
+    ticks = (timebase_now() - wheel_us) / TICK_US;
+    wheel_us += ticks * TICK_US;
+
+    (void)twheel_advance(&wheel, wheel.now + ticks);
+    (void)twheel_dispatch(&wheel);
+
+    next = twheel_next(&wheel);
+    if (next != TWHEEL_IDLE)
+    {
+        (void)swtimer_start_at(&wake_timer, wheel_us + (next * TICK_US), 0U);
+    }
+}
+
+static void report_task(uint32_t arg, void *ctx)
+{
+    (void)arg;
+    (void)ctx;
+
+    usart2_send_string("fired=");
+    usart2_send_u32(fired);
+    usart2_send_string(" wakeups=");
+    usart2_send_u32(wakeups);
+    usart2_send_string(" sleeps=");
+    usart2_send_u32(sched_sleeps());
+    usart2_send_string(" armed=");
+    usart2_send_u32(wheel.armed);
+    usart2_send_string(" max=");
+    usart2_send_u32(sched_stats(task_wheel)->max_cycles);
+    usart2_send_string(" cyc\r\n");
+
+    fired = 0U;
+    wakeups = 0U;
+}
+
+int main(void)
+{
+    uint32_t i;
+
+   /*--------------------------------------------------
+    * 1) Clocks
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+   /*--------------------------------------------------
+    * 2) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+   /*--------------------------------------------------
+    * 3) Scheduler
+    *-------------------------------------------------*/
+    sched_init();
+    task_wheel  = sched_task_add(wheel_task, 0U, 0);
+    task_report = sched_task_add(report_task, 2U, 0);
+
+    usart2_send_string("timer wheel\r\n");
+
+   /*--------------------------------------------------
+    * 4) Workload: every timer armed, half coalesced
+    *-------------------------------------------------*/
+    timebase_init();
+    wheel_us = timebase_now();
+
+    twheel_init(&wheel, 0U);
+    for (i = 0U; i < N_TIMERS; i++)
+    {
+        twheel_timer_init(&timers[i], work_fn, 0);
+        twheel_arm(&wheel, &timers[i], rand_delay());
+    }
+
+    swtimer_init(&wake_timer, wake_cb, 0);
+    swtimer_init(&report_timer, report_cb, 0);
+
+    (void)sched_post(task_wheel, 0U);
+    (void)swtimer_start(&report_timer, REPORT_US, REPORT_US);
+
+   /*--------------------------------------------------
+    * 5) Run tasks, sleep in between
+    *-------------------------------------------------*/
+    sched_run();
+}
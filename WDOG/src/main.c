@@ -0,0 +1,234 @@
+#include "stm32f4xx.h"
+#include "wdog.h"
+
+#define SCLK 16000000U
+#define BAUD 115200U
+
+   /*--------------------------------------------------
+    * Watchdog supervisor
+    *
+    * Two supervised stages check in from the main
+    * loop: "adc" every 20 ms (deadline 100 ms) and
+    * "telemetry" every 100 ms (deadline 300 ms). A
+    * 1 kHz SysTick runs wdog_service() every 10 ms.
+    * WWDG 100 ms, IWDG 500 ms.
+    *
+    * After 3 s something breaks, a different thing on
+    * every boot:
+    *   0  telemetry stops checking in -> WWDG, record
+    *      names telemetry
+    *   1  Stop mode with no wake-up source: PCLK1
+    *      stops and the WWDG with it -> IWDG, on the
+    *      LSI, no record
+    *   2  the adc stage stops -> WWDG, record names
+    *      adc
+    *   3  main hangs with interrupts masked -> WWDG
+    *      still, but its early wakeup cannot run:
+    *      no record
+    * The next boot prints the reset cause and record.
+    * Scenario 1 needs the debugger detached (DBGMCU
+    * DBG_STOP keeps the clocks running).
+    *-------------------------------------------------*/
+
+#define TICK_MS       10U
+#define ADC_MS        20U
+#define TELEM_MS      100U
+#define BREAK_MS      3000U
+#define SCENARIOS     4U
+
+#define BOOT_MAGIC    0xB007B007U
+
+static uint32_t boot_magic __attribute__((section(".noinit")));
+static uint32_t boot_count __attribute__((section(".noinit")));
+
+static volatile uint32_t ms = 0U;
+
+   /*--------------------------------------------------
+    * USART2 send helpers (blocking)
+    *-------------------------------------------------*/
+static void usart2_send_char(char c)
+{
+    while (!(USART2->SR & USART_SR_TXE))
+    {
+        /* wait */
+    }
+    USART2->DR = (uint16_t)c;
+}
+
+static void usart2_send_string(const char *s)
+{
+    while (*s)
+    {
+        usart2_send_char(*s++);
+    }
+}
+
+static void usart2_send_u32(uint32_t v)
+{
+    char buf[11];
+    int i = 0;
+
+    if (v == 0U)
+    {
+        usart2_send_char('0');
+        return;
+    }
+
+    while (v > 0U && i < 10)
+    {
+        buf[i++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    }
+
+    while (i > 0)
+    {
+        usart2_send_char(buf[--i]);
+    }
+}
+
+void SysTick_Handler(void)
+{
+    ms++;
+
+    if ((ms % TICK_MS) == 0U)
+    {
+        wdog_service();
+    }
+}
+
+static void stop(const char *what)
+{
+    usart2_send_string(what);
+    usart2_send_string(" failed\r\n");
+    while (1)
+    {
+        /* the IWDG is not running yet: stay here */
+    }
+}
+
+int main(void)
+{
+    uint32_t next_adc = ADC_MS;
+    uint32_t next_telem = TELEM_MS;
+    uint32_t scenario;
+    int adc;
+    int telem;
+
+   /*--------------------------------------------------
+    * 1) USART2 on PA2 / PA3 (AF7)
+    *-------------------------------------------------*/
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
+    RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
+
+    GPIOA->MODER &= ~(GPIO_MODER_MODER2 | GPIO_MODER_MODER3);
+    GPIOA->MODER |=  (GPIO_MODER_MODER2_1 | GPIO_MODER_MODER3_1);
+
+    GPIOA->AFR[0] &= ~((0xFU << (2U * 4U)) | (0xFU << (3U * 4U)));
+    GPIOA->AFR[0] |=  ((7U  << (2U * 4U)) | (7U  << (3U * 4U)));
+
+    USART2->BRR = (SCLK + (BAUD / 2U)) / BAUD;
+    USART2->CR1 |= USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+    usart2_send_string("\r\nwatchdog supervisor\r\n");
+
+   /*--------------------------------------------------
+    * 2) Supervisor: tasks first, so the report can
+    *    name them
+    *-------------------------------------------------*/
+    {
+        wdog_cfg_t cfg =
+        {
+            .iwdg_ms = 500U,
+            .wwdg_ms = 100U,
+            .tick_ms = TICK_MS,
+        };
+
+        if (wdog_init(&cfg) != WDOG_OK)
+        {
+            stop("wdog init");
+        }
+    }
+
+    adc = wdog_task_add("adc", 100U);
+    telem = wdog_task_add("telemetry", 300U);
+    if ((adc < 0) || (telem < 0))
+    {
+        stop("wdog task");
+    }
+
+    (void)wdog_report(usart2_send_string);
+
+    if (boot_magic != BOOT_MAGIC)
+    {
+        boot_magic = BOOT_MAGIC;
+        boot_count = 0U;
+    }
+    scenario = boot_count % SCENARIOS;
+    boot_count++;
+
+    usart2_send_string("scenario ");
+    usart2_send_u32(scenario);
+    usart2_send_string("\r\n");
+
+   /*--------------------------------------------------
+    * 3) Start: from here on the check-ins decide
+    *-------------------------------------------------*/
+    SysTick_Config(SystemCoreClock / 1000U);
+    wdog_start();
+
+    while (1)
+    {
+        uint32_t broken;
+
+        __WFI();
+
+        broken = ((int32_t)(ms - BREAK_MS) >= 0) ? 1U : 0U;
+
+        if (broken && (scenario == 1U))
+        {
+            usart2_send_string("stop mode, no wake-up\r\n");
+            while (!(USART2->SR & USART_SR_TC))
+            {
+                /* let the line drain */
+            }
+
+            RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+            PWR->CR &= ~PWR_CR_PDDS;           /* Stop, not Standby */
+            SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+            SysTick->CTRL = 0U;
+            __disable_irq();
+            while (1)
+            {
+                __WFI();                       /* only the IWDG gets out of here */
+            }
+        }
+
+        if (broken && (scenario == 3U))
+        {
+            usart2_send_string("main hangs, IRQs off\r\n");
+            __disable_irq();
+            while (1)
+            {
+                /* the WWDG resets, its interrupt never runs */
+            }
+        }
+
+        if ((int32_t)(ms - next_adc) >= 0)
+        {
+            next_adc += ADC_MS;
+            if (!(broken && (scenario == 2U)))
+            {
+                wdog_checkin(adc);
+            }
+        }
+
+        if ((int32_t)(ms - next_telem) >= 0)
+        {
+            next_telem += TELEM_MS;
+            if (!(broken && (scenario == 0U)))
+            {
+                wdog_checkin(telem);
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "delay.h"
+
+static uint32_t overhead = 0U;
+static uint32_t cycles_per_us = 16U;
+
+void delay_cycles(uint32_t cycles)
+{
+    uint32_t t0 = DWT->CYCCNT;
+
+    if (cycles <= overhead)
+    {
+        return;
+    }
+    cycles -= overhead;
+
+    while ((DWT->CYCCNT - t0) < cycles)
+    {
+        /* wait */
+    }
+}
+
+   /*--------------------------------------------------
+    * overhead: a zero length delay_cycles() call as
+    * seen from the caller, minimum of a few runs (an
+    * interrupt may hit one of them)
+    *-------------------------------------------------*/
+void delay_init(void)
+{
+    uint32_t best = 0xFFFFFFFFU;
+    uint32_t i;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cycles_per_us = SystemCoreClock / 1000000U;
+    overhead = 0U;
+
+    for (i = 0U; i < 4U; i++)
+    {
+        uint32_t t0 = DWT->CYCCNT;
+        uint32_t dt;
+
+        delay_cycles(1U);
+        dt = DWT->CYCCNT - t0;
+
+        if (dt < best)
+        {
+            best = dt;
+        }
+    }
+
+    overhead = best;
+}
+
+void delay_us(uint32_t us)
+{
+    delay_cycles(us * cycles_per_us);
+}
+
+void delay_ms(uint32_t ms)
+{
+    while (ms > 0U)
+    {
+        delay_cycles(1000U * cycles_per_us);
+        ms--;
+    }
+}
+
+uint32_t delay_overhead(void)
+{
+    return overhead;
+}
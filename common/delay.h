@@ -0,0 +1,30 @@
+#ifndef DELAY_H
+#define DELAY_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Blocking delays on the DWT cycle counter
+    *
+    * The wait compares CYCCNT against the start value,
+    * so it does not depend on the optimization level
+    * or on flash wait states, and follows the clock
+    * through SystemCoreClock (call delay_init() again
+    * after changing it). delay_init() also measures
+    * the fixed cost of a delay_cycles() call, which is
+    * taken off every wait: the remaining error is one
+    * turn of the polling loop, a few cycles.
+    *
+    * Interrupts that hit during a wait make it longer,
+    * never shorter. For timing that must not move use
+    * the timer pulse service (opm.h).
+    *-------------------------------------------------*/
+
+void delay_init(void);                         /* starts DWT CYCCNT */
+void delay_cycles(uint32_t cycles);
+void delay_us(uint32_t us);                    /* up to 2^32 cycles */
+void delay_ms(uint32_t ms);
+
+uint32_t delay_overhead(void);                 /* cycles taken off each call */
+
+#endif /* DELAY_H */
@@ -0,0 +1,416 @@
+#include "dma.h"
+
+   /*--------------------------------------------------
+    * Request mapping, F401 (RM0368 tables 27/28)
+    * One byte per option: controller, stream, channel.
+    * Options are tried in order, 0xFF ends the list.
+    *-------------------------------------------------*/
+#define M(ctrl, stream, ch)  ((uint8_t)((((ctrl) - 1U) << 6U) | ((stream) << 3U) | (ch)))
+#define M_NONE               0xFFU
+#define M_OPTIONS            3U
+
+static const uint8_t dma_map[DMA_REQ_COUNT][M_OPTIONS] =
+{
+    [DMA_REQ_MEM2MEM]   = { M_NONE, M_NONE, M_NONE },  /* handled in dma_alloc() */
+
+    [DMA_REQ_ADC1]      = { M(2, 0, 0), M(2, 4, 0), M_NONE },
+
+    [DMA_REQ_SPI1_RX]   = { M(2, 0, 3), M(2, 2, 3), M_NONE },
+    [DMA_REQ_SPI1_TX]   = { M(2, 3, 3), M(2, 5, 3), M_NONE },
+    [DMA_REQ_SPI2_RX]   = { M(1, 3, 0), M_NONE,     M_NONE },
+    [DMA_REQ_SPI2_TX]   = { M(1, 4, 0), M_NONE,     M_NONE },
+    [DMA_REQ_SPI3_RX]   = { M(1, 0, 0), M(1, 2, 0), M_NONE },
+    [DMA_REQ_SPI3_TX]   = { M(1, 5, 0), M(1, 7, 0), M_NONE },
+    [DMA_REQ_SPI4_RX]   = { M(2, 0, 4), M(2, 3, 5), M_NONE },
+    [DMA_REQ_SPI4_TX]   = { M(2, 1, 4), M(2, 4, 5), M_NONE },
+
+    [DMA_REQ_I2C1_RX]   = { M(1, 0, 1), M(1, 5, 1), M_NONE },
+    [DMA_REQ_I2C1_TX]   = { M(1, 6, 1), M(1, 7, 1), M_NONE },
+    [DMA_REQ_I2C2_RX]   = { M(1, 2, 7), M(1, 3, 7), M_NONE },
+    [DMA_REQ_I2C2_TX]   = { M(1, 7, 7), M_NONE,     M_NONE },
+    [DMA_REQ_I2C3_RX]   = { M(1, 1, 1), M(1, 2, 3), M_NONE },
+    [DMA_REQ_I2C3_TX]   = { M(1, 4, 3), M_NONE,     M_NONE },
+
+    [DMA_REQ_USART1_RX] = { M(2, 2, 4), M(2, 5, 4), M_NONE },
+    [DMA_REQ_USART1_TX] = { M(2, 7, 4), M_NONE,     M_NONE },
+    [DMA_REQ_USART2_RX] = { M(1, 5, 4), M_NONE,     M_NONE },
+    [DMA_REQ_USART2_TX] = { M(1, 6, 4), M_NONE,     M_NONE },
+    [DMA_REQ_USART6_RX] = { M(2, 1, 5), M(2, 2, 5), M_NONE },
+    [DMA_REQ_USART6_TX] = { M(2, 6, 5), M(2, 7, 5), M_NONE },
+
+    [DMA_REQ_SDIO]      = { M(2, 3, 4), M(2, 6, 4), M_NONE },
+
+    [DMA_REQ_TIM1_UP]   = { M(2, 5, 6), M_NONE,     M_NONE },
+    [DMA_REQ_TIM1_TRIG] = { M(2, 0, 6), M(2, 4, 6), M_NONE },
+    [DMA_REQ_TIM1_CH1]  = { M(2, 1, 6), M(2, 3, 6), M(2, 6, 0) },
+    [DMA_REQ_TIM1_CH2]  = { M(2, 2, 6), M(2, 6, 0), M_NONE },
+    [DMA_REQ_TIM1_CH3]  = { M(2, 6, 6), M(2, 6, 0), M_NONE },
+    [DMA_REQ_TIM1_CH4]  = { M(2, 4, 6), M_NONE,     M_NONE },
+
+    [DMA_REQ_TIM2_UP]   = { M(1, 1, 3), M(1, 7, 3), M_NONE },
+    [DMA_REQ_TIM2_CH1]  = { M(1, 5, 3), M_NONE,     M_NONE },
+    [DMA_REQ_TIM2_CH2]  = { M(1, 6, 3), M_NONE,     M_NONE },
+    [DMA_REQ_TIM2_CH3]  = { M(1, 1, 3), M_NONE,     M_NONE },
+    [DMA_REQ_TIM2_CH4]  = { M(1, 6, 3), M(1, 7, 3), M_NONE },
+
+    [DMA_REQ_TIM3_UP]   = { M(1, 2, 5), M_NONE,     M_NONE },
+    [DMA_REQ_TIM3_TRIG] = { M(1, 4, 5), M_NONE,     M_NONE },
+    [DMA_REQ_TIM3_CH1]  = { M(1, 4, 5), M_NONE,     M_NONE },
+    [DMA_REQ_TIM3_CH2]  = { M(1, 5, 5), M_NONE,     M_NONE },
+    [DMA_REQ_TIM3_CH3]  = { M(1, 7, 5), M_NONE,     M_NONE },
+    [DMA_REQ_TIM3_CH4]  = { M(1, 2, 5), M_NONE,     M_NONE },
+
+    [DMA_REQ_TIM4_UP]   = { M(1, 6, 2), M_NONE,     M_NONE },
+    [DMA_REQ_TIM4_CH1]  = { M(1, 0, 2), M_NONE,     M_NONE },
+    [DMA_REQ_TIM4_CH2]  = { M(1, 3, 2), M_NONE,     M_NONE },
+    [DMA_REQ_TIM4_CH3]  = { M(1, 7, 2), M_NONE,     M_NONE },
+
+    [DMA_REQ_TIM5_UP]   = { M(1, 0, 6), M(1, 6, 6), M_NONE },
+    [DMA_REQ_TIM5_TRIG] = { M(1, 1, 6), M(1, 3, 6), M_NONE },
+    [DMA_REQ_TIM5_CH1]  = { M(1, 2, 6), M_NONE,     M_NONE },
+    [DMA_REQ_TIM5_CH2]  = { M(1, 4, 6), M_NONE,     M_NONE },
+    [DMA_REQ_TIM5_CH3]  = { M(1, 0, 6), M_NONE,     M_NONE },
+    [DMA_REQ_TIM5_CH4]  = { M(1, 1, 6), M(1, 3, 6), M_NONE },
+};
+
+#define S(ctrl, n) \
+    { DMA##ctrl, DMA##ctrl##_Stream##n, DMA##ctrl##_Stream##n##_IRQn, ctrl, n, 0U, 0U, 0U, 0, 0 }
+
+static dma_stream_t dma_streams[16] =
+{
+    S(1, 0), S(1, 1), S(1, 2), S(1, 3), S(1, 4), S(1, 5), S(1, 6), S(1, 7),
+    S(2, 0), S(2, 1), S(2, 2), S(2, 3), S(2, 4), S(2, 5), S(2, 6), S(2, 7),
+};
+
+   /* flag position of stream n & 3 inside LISR / HISR */
+static const uint8_t dma_flag_shift[4] = { 0U, 6U, 16U, 22U };
+
+static void dma_clear_flags(dma_stream_t *s)
+{
+    uint32_t bits = DMA_EVT_ALL << dma_flag_shift[s->index & 3U];
+
+    if (s->index < 4U)
+    {
+        s->dma->LIFCR = bits;
+    }
+    else
+    {
+        s->dma->HIFCR = bits;
+    }
+}
+
+   /*--------------------------------------------------
+    * FIFO mode rules (RM0368 9.3.11 / 9.3.12)
+    *
+    * - a burst on either port must fit the FIFO
+    *   threshold an integer number of times
+    *   (beats * size divides threshold bytes), which
+    *   also rules out INCR16 half-words and INCR8 /
+    *   INCR16 words
+    * - the transfer must end on a whole memory burst
+    *   and a whole memory word when packing
+    * - addresses aligned to the data size, memory
+    *   aligned to the burst so it can never cross a
+    *   1 KB boundary
+    *-------------------------------------------------*/
+static const uint8_t dma_burst_beats[4] = { 1U, 4U, 8U, 16U };
+
+static int dma_fifo_valid(const dma_desc_t *d)
+{
+    uint32_t fifo_bytes   = 4U * (uint32_t)(d->fifo - DMA_FIFO_DIRECT);
+    uint32_t mburst_bytes = (uint32_t)dma_burst_beats[d->mburst] << d->msize;
+    uint32_t pburst_bytes = (uint32_t)dma_burst_beats[d->pburst] << d->psize;
+    uint32_t total_bytes  = (uint32_t)d->count << d->psize;
+
+    if (((fifo_bytes % mburst_bytes) != 0U) || ((fifo_bytes % pburst_bytes) != 0U))
+    {
+        return 0;
+    }
+
+    if (((total_bytes % mburst_bytes) != 0U) || ((total_bytes % (1U << d->msize)) != 0U))
+    {
+        return 0;
+    }
+
+    if ((d->periph & ((1U << d->psize) - 1U)) != 0U)
+    {
+        return 0;
+    }
+
+    if (d->minc && (d->mburst != DMA_BURST_SINGLE))
+    {
+        if (((d->mem0 % mburst_bytes) != 0U) ||
+            (d->double_buffer && ((d->mem1 % mburst_bytes) != 0U)))
+        {
+            return 0;
+        }
+    }
+    else if (((d->mem0 | (d->double_buffer ? d->mem1 : 0U)) & ((1U << d->msize) - 1U)) != 0U)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+static dma_stream_t *dma_claim(uint32_t id, uint32_t channel)
+{
+    dma_stream_t *s = &dma_streams[id];
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (s->in_use)
+    {
+        __set_PRIMASK(primask);
+        return 0;
+    }
+
+    s->in_use = 1U;
+    __set_PRIMASK(primask);
+
+    s->channel = (uint8_t)channel;
+    s->events = 0U;
+    s->callback = 0;
+    s->ctx = 0;
+
+    RCC->AHB1ENR |= (s->controller == 1U) ? RCC_AHB1ENR_DMA1EN : RCC_AHB1ENR_DMA2EN;
+
+    return s;
+}
+
+dma_stream_t *dma_alloc(dma_request_t req)
+{
+    uint32_t i;
+
+    if ((uint32_t)req >= DMA_REQ_COUNT)
+    {
+        return 0;
+    }
+
+    if (req == DMA_REQ_MEM2MEM)
+    {
+        /* any DMA2 stream, from the top: ADC1 lives on 0 and 4 */
+        for (i = 8U; i > 0U; i--)
+        {
+            dma_stream_t *s = dma_claim(8U + (i - 1U), 0U);
+
+            if (s != 0)
+            {
+                return s;
+            }
+        }
+        return 0;
+    }
+
+    for (i = 0U; i < M_OPTIONS; i++)
+    {
+        uint8_t m = dma_map[req][i];
+        dma_stream_t *s;
+
+        if (m == M_NONE)
+        {
+            break;
+        }
+
+        s = dma_claim(((uint32_t)(m >> 6U) * 8U) + ((m >> 3U) & 7U), m & 7U);
+
+        if (s != 0)
+        {
+            return s;
+        }
+    }
+
+    return 0;
+}
+
+void dma_free(dma_stream_t *s)
+{
+    dma_stop(s);
+    NVIC_DisableIRQ(s->irqn);
+
+    s->callback = 0;
+    s->in_use = 0U;
+}
+
+void dma_stop(dma_stream_t *s)
+{
+    s->regs->CR &= ~DMA_SxCR_EN;
+
+    while (s->regs->CR & DMA_SxCR_EN)
+    {
+        /* current transfer finishes first */
+    }
+}
+
+int dma_config(dma_stream_t *s, const dma_desc_t *d)
+{
+    uint32_t cr;
+    uint32_t fcr;
+
+   /*--------------------------------------------------
+    * Combinations the hardware does not support
+    *-------------------------------------------------*/
+    if (d->count == 0U)
+    {
+        return DMA_ERR_CONFIG;
+    }
+
+    if (d->dir == DMA_DIR_M2M)
+    {
+        /* no M2M on DMA1, no circular / direct mode in M2M */
+        if ((s->controller != 2U) || d->circular || d->double_buffer ||
+            (d->fifo == DMA_FIFO_DIRECT))
+        {
+            return DMA_ERR_CONFIG;
+        }
+    }
+
+    if ((d->fifo == DMA_FIFO_DIRECT) &&
+        ((d->pburst != DMA_BURST_SINGLE) || (d->mburst != DMA_BURST_SINGLE) ||
+         (d->psize != d->msize)))
+    {
+        /* direct mode: no bursts, no packing */
+        return DMA_ERR_CONFIG;
+    }
+
+    if ((d->fifo != DMA_FIFO_DIRECT) && !dma_fifo_valid(d))
+    {
+        return DMA_ERR_CONFIG;
+    }
+
+    dma_stop(s);
+    dma_clear_flags(s);
+
+    cr = ((uint32_t)s->channel << DMA_SxCR_CHSEL_Pos) |
+         ((uint32_t)d->mburst  << DMA_SxCR_MBURST_Pos) |
+         ((uint32_t)d->pburst  << DMA_SxCR_PBURST_Pos) |
+         ((uint32_t)d->prio    << DMA_SxCR_PL_Pos) |
+         ((uint32_t)d->msize   << DMA_SxCR_MSIZE_Pos) |
+         ((uint32_t)d->psize   << DMA_SxCR_PSIZE_Pos) |
+         ((uint32_t)d->dir     << DMA_SxCR_DIR_Pos);
+
+    if (d->minc)
+    {
+        cr |= DMA_SxCR_MINC;
+    }
+    if (d->pinc)
+    {
+        cr |= DMA_SxCR_PINC;
+    }
+    if (d->circular)
+    {
+        cr |= DMA_SxCR_CIRC;
+    }
+    if (d->double_buffer)
+    {
+        cr |= DMA_SxCR_DBM | DMA_SxCR_CIRC;
+    }
+
+    if (d->events & DMA_EVT_TC)
+    {
+        cr |= DMA_SxCR_TCIE;
+    }
+    if (d->events & DMA_EVT_HT)
+    {
+        cr |= DMA_SxCR_HTIE;
+    }
+    if (d->events & DMA_EVT_TE)
+    {
+        cr |= DMA_SxCR_TEIE;
+    }
+    if (d->events & DMA_EVT_DME)
+    {
+        cr |= DMA_SxCR_DMEIE;
+    }
+
+    fcr = 0U;
+    if (d->fifo != DMA_FIFO_DIRECT)
+    {
+        fcr = DMA_SxFCR_DMDIS | ((uint32_t)(d->fifo - DMA_FIFO_1_4) << DMA_SxFCR_FTH_Pos);
+    }
+    if (d->events & DMA_EVT_FE)
+    {
+        fcr |= DMA_SxFCR_FEIE;
+    }
+
+    s->regs->PAR  = d->periph;
+    s->regs->M0AR = d->mem0;
+    s->regs->M1AR = d->mem1;
+    s->regs->NDTR = d->count;
+    s->regs->FCR  = fcr;
+    s->regs->CR   = cr;
+
+    s->callback = d->callback;
+    s->ctx = d->ctx;
+    s->events = d->events;
+
+    if (d->events != 0U)
+    {
+        NVIC_ClearPendingIRQ(s->irqn);
+        NVIC_EnableIRQ(s->irqn);
+    }
+    else
+    {
+        NVIC_DisableIRQ(s->irqn);
+    }
+
+    return DMA_OK;
+}
+
+void dma_start(dma_stream_t *s)
+{
+    dma_clear_flags(s);
+    s->regs->CR |= DMA_SxCR_EN;
+}
+
+   /*--------------------------------------------------
+    * Common stream interrupt: one read, one clear
+    *-------------------------------------------------*/
+static void dma_irq(uint32_t id)
+{
+    dma_stream_t *s = &dma_streams[id];
+    uint32_t shift = dma_flag_shift[s->index & 3U];
+    uint32_t events;
+
+    if (s->index < 4U)
+    {
+        events = (s->dma->LISR >> shift) & DMA_EVT_ALL;
+        s->dma->LIFCR = events << shift;
+    }
+    else
+    {
+        events = (s->dma->HISR >> shift) & DMA_EVT_ALL;
+        s->dma->HIFCR = events << shift;
+    }
+
+    events &= s->events;
+
+    if ((events != 0U) && (s->callback != 0))
+    {
+        s->callback(s, events, s->ctx);
+    }
+}
+
+#define DMA_IRQ_HANDLER(ctrl, n)                        \
+    void DMA##ctrl##_Stream##n##_IRQHandler(void)       \
+    {                                                   \
+        dma_irq(((ctrl) - 1U) * 8U + (n));              \
+    }
+
+DMA_IRQ_HANDLER(1, 0)
+DMA_IRQ_HANDLER(1, 1)
+DMA_IRQ_HANDLER(1, 2)
+DMA_IRQ_HANDLER(1, 3)
+DMA_IRQ_HANDLER(1, 4)
+DMA_IRQ_HANDLER(1, 5)
+DMA_IRQ_HANDLER(1, 6)
+DMA_IRQ_HANDLER(1, 7)
+DMA_IRQ_HANDLER(2, 0)
+DMA_IRQ_HANDLER(2, 1)
+DMA_IRQ_HANDLER(2, 2)
+DMA_IRQ_HANDLER(2, 3)
+DMA_IRQ_HANDLER(2, 4)
+DMA_IRQ_HANDLER(2, 5)
+DMA_IRQ_HANDLER(2, 6)
+DMA_IRQ_HANDLER(2, 7)
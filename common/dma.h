@@ -0,0 +1,189 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * DMA1 / DMA2 stream driver for STM32F401
+    *
+    * dma_alloc() picks a free stream + channel for a
+    * peripheral request from the F401 request mapping
+    * (RM0368 tables 27/28), dma_config() programs it
+    * from a descriptor, dma_start() enables it.
+    *
+    * dma.c defines all 16 DMAx_Streamy_IRQHandler. Each
+    * reads the stream's 6 flag bits from LISR/HISR once,
+    * clears exactly those bits with one IFCR write and
+    * passes them to the stream callback. A project that
+    * links dma.c must not define these handlers itself.
+    *-------------------------------------------------*/
+
+typedef enum
+{
+    DMA_REQ_MEM2MEM = 0,                       /* DMA2 only, any stream */
+
+    DMA_REQ_ADC1,
+
+    DMA_REQ_SPI1_RX, DMA_REQ_SPI1_TX,
+    DMA_REQ_SPI2_RX, DMA_REQ_SPI2_TX,
+    DMA_REQ_SPI3_RX, DMA_REQ_SPI3_TX,
+    DMA_REQ_SPI4_RX, DMA_REQ_SPI4_TX,
+
+    DMA_REQ_I2C1_RX, DMA_REQ_I2C1_TX,
+    DMA_REQ_I2C2_RX, DMA_REQ_I2C2_TX,
+    DMA_REQ_I2C3_RX, DMA_REQ_I2C3_TX,
+
+    DMA_REQ_USART1_RX, DMA_REQ_USART1_TX,
+    DMA_REQ_USART2_RX, DMA_REQ_USART2_TX,
+    DMA_REQ_USART6_RX, DMA_REQ_USART6_TX,
+
+    DMA_REQ_SDIO,
+
+    DMA_REQ_TIM1_UP, DMA_REQ_TIM1_TRIG,
+    DMA_REQ_TIM1_CH1, DMA_REQ_TIM1_CH2, DMA_REQ_TIM1_CH3, DMA_REQ_TIM1_CH4,
+
+    DMA_REQ_TIM2_UP,                           /* shares requests with CH3 / CH4 */
+    DMA_REQ_TIM2_CH1, DMA_REQ_TIM2_CH2, DMA_REQ_TIM2_CH3, DMA_REQ_TIM2_CH4,
+
+    DMA_REQ_TIM3_UP, DMA_REQ_TIM3_TRIG,
+    DMA_REQ_TIM3_CH1, DMA_REQ_TIM3_CH2, DMA_REQ_TIM3_CH3, DMA_REQ_TIM3_CH4,
+
+    DMA_REQ_TIM4_UP,
+    DMA_REQ_TIM4_CH1, DMA_REQ_TIM4_CH2, DMA_REQ_TIM4_CH3,
+
+    DMA_REQ_TIM5_UP, DMA_REQ_TIM5_TRIG,
+    DMA_REQ_TIM5_CH1, DMA_REQ_TIM5_CH2, DMA_REQ_TIM5_CH3, DMA_REQ_TIM5_CH4,
+
+    DMA_REQ_COUNT
+} dma_request_t;
+
+typedef enum
+{
+    DMA_DIR_P2M = 0,                           /* peripheral to memory */
+    DMA_DIR_M2P = 1,                           /* memory to peripheral */
+    DMA_DIR_M2M = 2                            /* memory to memory, DMA2 only */
+} dma_dir_t;
+
+typedef enum
+{
+    DMA_WIDTH_8  = 0,
+    DMA_WIDTH_16 = 1,
+    DMA_WIDTH_32 = 2
+} dma_width_t;
+
+typedef enum
+{
+    DMA_BURST_SINGLE = 0,
+    DMA_BURST_INCR4  = 1,
+    DMA_BURST_INCR8  = 2,
+    DMA_BURST_INCR16 = 3
+} dma_burst_t;
+
+   /*--------------------------------------------------
+    * FIFO mode
+    *
+    * In direct mode every PSIZE item is one AHB access
+    * on each port. With the 4-word FIFO the memory
+    * port only runs once the threshold is reached, as
+    * one MBURST, and PSIZE < MSIZE packs items (e.g.
+    * two ADC half-words per 32-bit write). dma_config()
+    * rejects threshold / burst / size combinations the
+    * hardware does not support (RM0368 9.3.12).
+    *-------------------------------------------------*/
+typedef enum
+{
+    DMA_FIFO_DIRECT = 0,                       /* direct mode, no FIFO */
+    DMA_FIFO_1_4,                              /* FIFO mode, threshold */
+    DMA_FIFO_1_2,
+    DMA_FIFO_3_4,
+    DMA_FIFO_FULL
+} dma_fifo_t;
+
+typedef enum
+{
+    DMA_PRIO_LOW = 0,
+    DMA_PRIO_MEDIUM,
+    DMA_PRIO_HIGH,
+    DMA_PRIO_VERY_HIGH
+} dma_prio_t;
+
+   /*--------------------------------------------------
+    * Event bits passed to callbacks, same layout as the
+    * stream 0 bits of LISR
+    *-------------------------------------------------*/
+#define DMA_EVT_FE   (1U << 0U)                /* FIFO error */
+#define DMA_EVT_DME  (1U << 2U)                /* direct mode error */
+#define DMA_EVT_TE   (1U << 3U)                /* transfer error */
+#define DMA_EVT_HT   (1U << 4U)                /* half transfer */
+#define DMA_EVT_TC   (1U << 5U)                /* transfer complete */
+#define DMA_EVT_ALL  (DMA_EVT_FE | DMA_EVT_DME | DMA_EVT_TE | DMA_EVT_HT | DMA_EVT_TC)
+#define DMA_EVT_ERR  (DMA_EVT_FE | DMA_EVT_DME | DMA_EVT_TE)
+
+#define DMA_OK          0
+#define DMA_ERR_CONFIG -1                      /* descriptor not valid for stream */
+
+typedef struct dma_stream dma_stream_t;
+
+typedef void (*dma_callback_t)(dma_stream_t *s, uint32_t events, void *ctx);
+
+typedef struct
+{
+    dma_dir_t      dir;
+    dma_width_t    psize;
+    dma_width_t    msize;
+    uint8_t        pinc;                       /* increment peripheral address */
+    uint8_t        minc;                       /* increment memory address */
+    dma_burst_t    pburst;
+    dma_burst_t    mburst;
+    dma_fifo_t     fifo;
+    dma_prio_t     prio;
+    uint8_t        circular;
+    uint8_t        double_buffer;              /* DBM, mem0 / mem1 alternate */
+    uint32_t       periph;                     /* PAR (source for M2M) */
+    uint32_t       mem0;                       /* M0AR */
+    uint32_t       mem1;                       /* M1AR, DBM only */
+    uint16_t       count;                      /* NDTR, in units of psize */
+    uint32_t       events;                     /* DMA_EVT_* to enable */
+    dma_callback_t callback;
+    void          *ctx;
+} dma_desc_t;
+
+struct dma_stream
+{
+    DMA_TypeDef        *dma;
+    DMA_Stream_TypeDef *regs;
+    IRQn_Type           irqn;
+    uint8_t             controller;            /* 1 or 2 */
+    uint8_t             index;                 /* stream 0..7 */
+    uint8_t             channel;               /* CHSEL of the allocated request */
+    volatile uint8_t    in_use;
+    uint32_t            events;                /* DMA_EVT_* enabled */
+    dma_callback_t      callback;
+    void               *ctx;
+};
+
+dma_stream_t *dma_alloc(dma_request_t req);
+void          dma_free(dma_stream_t *s);
+
+int      dma_config(dma_stream_t *s, const dma_desc_t *d);
+void     dma_start(dma_stream_t *s);
+void     dma_stop(dma_stream_t *s);            /* waits until EN reads back 0 */
+
+static inline uint32_t dma_remaining(const dma_stream_t *s)
+{
+    return s->regs->NDTR;
+}
+
+   /* FIFO fill: 0 = <1/4 ... 3 = <full, 4 = empty, 5 = full */
+static inline uint32_t dma_fifo_level(const dma_stream_t *s)
+{
+    return (s->regs->FCR & DMA_SxFCR_FS) >> DMA_SxFCR_FS_Pos;
+}
+
+   /* DBM: memory target in use by hardware (0 or 1) */
+static inline uint32_t dma_current_target(const dma_stream_t *s)
+{
+    return (s->regs->CR & DMA_SxCR_CT) ? 1U : 0U;
+}
+
+#endif /* DMA_H */
@@ -0,0 +1,241 @@
+#include "stm32f4xx.h"
+#include "dma.h"
+#include "dma_copy.h"
+
+#define CHUNK_MAX  0xFFF0U                     /* items, multiple of any burst */
+
+typedef struct
+{
+    uint32_t      dst;
+    uint32_t      src;
+    uint32_t      len;                         /* bytes still to move */
+    uint32_t      fill;                        /* memset pattern, src points here */
+    uint8_t       is_fill;
+    dma_copy_cb_t cb;
+    void         *ctx;
+} dma_copy_req_t;
+
+static dma_stream_t *m2m;
+static dma_copy_req_t queue[DMA_COPY_QUEUE_LEN];
+static volatile uint32_t q_head = 0U;
+static volatile uint32_t q_tail = 0U;
+static volatile uint32_t active = 0U;
+static uint32_t chunk_bytes;
+
+static void dma_copy_event(dma_stream_t *s, uint32_t events, void *ctx);
+
+   /*--------------------------------------------------
+    * Program the next chunk of r. Width: widest size
+    * dst / src / len are aligned to. Bursts only when
+    * all are 16-byte aligned, so every chunk is one or
+    * more full FIFOs (16 bytes = INCR4 words,
+    * INCR8 half-words or INCR16 bytes).
+    *-------------------------------------------------*/
+static void start_chunk(dma_copy_req_t *r)
+{
+    uint32_t align = r->dst | r->len | (r->is_fill ? 0U : r->src);
+    dma_width_t w;
+    dma_burst_t burst = DMA_BURST_SINGLE;
+    uint32_t items;
+    dma_desc_t desc =
+    {
+        .dir      = DMA_DIR_M2M,
+        .pinc     = r->is_fill ? 0U : 1U,
+        .minc     = 1U,
+        .fifo     = DMA_FIFO_FULL,
+        .prio     = DMA_PRIO_LOW,
+        .periph   = r->src,
+        .mem0     = r->dst,
+        .events   = DMA_EVT_TC | DMA_EVT_TE,
+        .callback = dma_copy_event,
+    };
+
+    if ((align & 3U) == 0U)
+    {
+        w = DMA_WIDTH_32;
+    }
+    else if ((align & 1U) == 0U)
+    {
+        w = DMA_WIDTH_16;
+    }
+    else
+    {
+        w = DMA_WIDTH_8;
+    }
+
+    if ((align & 15U) == 0U)
+    {
+        burst = (w == DMA_WIDTH_32) ? DMA_BURST_INCR4 :
+                (w == DMA_WIDTH_16) ? DMA_BURST_INCR8 : DMA_BURST_INCR16;
+    }
+
+    items = r->len >> w;
+    if (items > CHUNK_MAX)
+    {
+        items = CHUNK_MAX;
+    }
+    chunk_bytes = items << w;
+
+    desc.psize  = w;
+    desc.msize  = w;
+    desc.mburst = burst;
+    desc.pburst = r->is_fill ? DMA_BURST_SINGLE : burst;
+    desc.count  = (uint16_t)items;
+
+    (void)dma_config(m2m, &desc);              /* always valid for the sizes above */
+    dma_start(m2m);
+}
+
+   /*--------------------------------------------------
+    * DMA interrupt: next chunk, or finish the request
+    * and start the next one before its callback runs
+    *-------------------------------------------------*/
+static void dma_copy_event(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    dma_copy_req_t *r = &queue[q_tail % DMA_COPY_QUEUE_LEN];
+    dma_copy_cb_t cb;
+    void *cb_ctx;
+    uint32_t primask;
+    int status = DMA_COPY_OK;
+
+    (void)s;
+    (void)ctx;
+
+    if (events & DMA_EVT_ERR)
+    {
+        status = DMA_COPY_ERR_BUS;
+    }
+    else
+    {
+        r->dst += chunk_bytes;
+        if (!r->is_fill)
+        {
+            r->src += chunk_bytes;
+        }
+        r->len -= chunk_bytes;
+
+        if (r->len != 0U)
+        {
+            start_chunk(r);
+            return;
+        }
+    }
+
+    cb = r->cb;
+    cb_ctx = r->ctx;
+
+    /* a submit from a higher priority ISR sees the start or active == 0 */
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    q_tail++;
+
+    if (q_tail != q_head)
+    {
+        start_chunk(&queue[q_tail % DMA_COPY_QUEUE_LEN]);
+    }
+    else
+    {
+        active = 0U;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (cb != 0)
+    {
+        cb(status, cb_ctx);
+    }
+}
+
+int dma_copy_init(void)
+{
+    m2m = dma_alloc(DMA_REQ_MEM2MEM);
+
+    if (m2m == 0)
+    {
+        return DMA_COPY_ERR_INIT;
+    }
+
+    q_head = 0U;
+    q_tail = 0U;
+    active = 0U;
+
+    return DMA_COPY_OK;
+}
+
+static int submit(uint32_t dst, uint32_t src, uint32_t fill, uint8_t is_fill,
+                  uint32_t len, dma_copy_cb_t cb, void *ctx)
+{
+    dma_copy_req_t *r;
+    uint32_t primask;
+
+    if (m2m == 0)
+    {
+        return DMA_COPY_ERR_INIT;
+    }
+
+    if (len == 0U)
+    {
+        if (cb != 0)
+        {
+            cb(DMA_COPY_OK, ctx);
+        }
+        return DMA_COPY_OK;
+    }
+
+    __DSB();                                   /* CPU writes done before DMA reads */
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((q_head - q_tail) >= DMA_COPY_QUEUE_LEN)
+    {
+        __set_PRIMASK(primask);
+        return DMA_COPY_ERR_FULL;
+    }
+
+    r = &queue[q_head % DMA_COPY_QUEUE_LEN];
+    r->dst = dst;
+    r->fill = fill;
+    r->src = is_fill ? (uint32_t)&r->fill : src;
+    r->len = len;
+    r->is_fill = is_fill;
+    r->cb = cb;
+    r->ctx = ctx;
+    q_head++;
+
+    if (!active)
+    {
+        active = 1U;
+        start_chunk(r);
+    }
+
+    __set_PRIMASK(primask);
+
+    return DMA_COPY_OK;
+}
+
+int dma_memcpy_async(void *dst, const void *src, uint32_t len,
+                     dma_copy_cb_t cb, void *ctx)
+{
+    return submit((uint32_t)dst, (uint32_t)src, 0U, 0U, len, cb, ctx);
+}
+
+int dma_memset_async(void *dst, uint8_t value, uint32_t len,
+                     dma_copy_cb_t cb, void *ctx)
+{
+    return submit((uint32_t)dst, 0U, (uint32_t)value * 0x01010101U, 1U, len, cb, ctx);
+}
+
+uint32_t dma_copy_pending(void)
+{
+    return q_head - q_tail;
+}
+
+void dma_copy_flush(void)
+{
+    while (q_head != q_tail)
+    {
+        /* callbacks run from the DMA interrupt */
+    }
+}
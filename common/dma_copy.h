@@ -0,0 +1,44 @@
+#ifndef DMA_COPY_H
+#define DMA_COPY_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * Asynchronous memcpy / memset on DMA2 (M2M)
+    *
+    * DMA2 is the only F401 controller that can do
+    * memory-to-memory. dma_copy_init() takes one DMA2
+    * stream for good, requests are queued and run one
+    * after the other, each completion calls the
+    * request's callback from the DMA interrupt.
+    *
+    * Each request runs at the widest data size the
+    * addresses and length allow, with FIFO bursts when
+    * everything is 16-byte aligned, and is split into
+    * chunks of up to 0xFFF0 items (NDTR is 16 bits).
+    *
+    * Buffers must stay untouched until the callback:
+    * the CPU may run DSP on other data meanwhile.
+    * Submitting is safe from main and from ISRs.
+    *-------------------------------------------------*/
+
+#define DMA_COPY_QUEUE_LEN  8U
+
+#define DMA_COPY_OK          0
+#define DMA_COPY_ERR_FULL   -1                 /* queue full, nothing queued */
+#define DMA_COPY_ERR_BUS    -2                 /* transfer error, request aborted */
+#define DMA_COPY_ERR_INIT   -3                 /* no free DMA2 stream */
+
+typedef void (*dma_copy_cb_t)(int status, void *ctx);
+
+int dma_copy_init(void);
+
+int dma_memcpy_async(void *dst, const void *src, uint32_t len,
+                     dma_copy_cb_t cb, void *ctx);
+int dma_memset_async(void *dst, uint8_t value, uint32_t len,
+                     dma_copy_cb_t cb, void *ctx);
+
+uint32_t dma_copy_pending(void);               /* queued + running requests */
+void     dma_copy_flush(void);                 /* wait until the queue is empty */
+
+#endif /* DMA_COPY_H */
@@ -0,0 +1,174 @@
+#include "encoder.h"
+
+#define EDGE_COUNTS  4                         /* x4: counts per A period */
+
+   /*--------------------------------------------------
+    * Stamp timer trigger input (ITRx) that carries the
+    * encoder timer's TRGO (RM0368 table 55 / 59)
+    *-------------------------------------------------*/
+static int stamp_trigger(TIM_TypeDef *tim, TIM_TypeDef *stamp, uint32_t *ts)
+{
+    if (stamp == TIM2)
+    {
+        if      (tim == TIM3) { *ts = 2U; }    /* ITR2 */
+        else if (tim == TIM4) { *ts = 3U; }    /* ITR3 */
+        else                  { return ENC_ERR_CONFIG; }
+
+        RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    }
+    else if (stamp == TIM5)
+    {
+        if      (tim == TIM3) { *ts = 1U; }    /* ITR1 */
+        else if (tim == TIM4) { *ts = 2U; }    /* ITR2 */
+        else                  { return ENC_ERR_CONFIG; }
+
+        RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+    }
+    else
+    {
+        return ENC_ERR_CONFIG;
+    }
+
+    return ENC_OK;
+}
+
+int enc_init(enc_t *e, const enc_cfg_t *cfg)
+{
+    TIM_TypeDef *tim = cfg->tim;
+    TIM_TypeDef *stamp = cfg->stamp;
+    uint32_t ts;
+    uint32_t f;
+
+    if ((cfg->filter > 15U) || (stamp_trigger(tim, stamp, &ts) != ENC_OK))
+    {
+        return ENC_ERR_CONFIG;
+    }
+
+    RCC->APB1ENR |= (tim == TIM3) ? RCC_APB1ENR_TIM3EN : RCC_APB1ENR_TIM4EN;
+
+   /*--------------------------------------------------
+    * Encoder timer: TI1 / TI2 inputs with filter,
+    * encoder mode 3, full 16-bit range. CC1 captures
+    * on rising A and pulses TRGO (MMS = 011).
+    *-------------------------------------------------*/
+    f = (uint32_t)cfg->filter;
+
+    tim->CR1 = 0U;
+    tim->SMCR = 0U;
+    tim->CCER = 0U;
+    tim->CCMR1 = (f << TIM_CCMR1_IC1F_Pos) | (1U << TIM_CCMR1_CC1S_Pos) |
+                 (f << TIM_CCMR1_IC2F_Pos) | (1U << TIM_CCMR1_CC2S_Pos);
+    tim->CCER = TIM_CCER_CC1E | (cfg->invert ? TIM_CCER_CC1P : 0U);
+    tim->ARR = 0xFFFFU;
+    tim->CR2 = 3U << TIM_CR2_MMS_Pos;
+    tim->SMCR = 3U << TIM_SMCR_SMS_Pos;
+
+   /*--------------------------------------------------
+    * Stamp timer: CC2 captures on TRC, the trigger
+    * selected by TS. No slave mode, the counter runs
+    * free.
+    *-------------------------------------------------*/
+    stamp->SMCR = (stamp->SMCR & ~(TIM_SMCR_TS | TIM_SMCR_SMS)) | (ts << TIM_SMCR_TS_Pos);
+    stamp->CCER &= ~(TIM_CCER_CC2E | TIM_CCER_CC2P | TIM_CCER_CC2NP);
+    stamp->CCMR1 = (stamp->CCMR1 & ~0xFF00U) | (3U << TIM_CCMR1_CC2S_Pos);
+    stamp->CCER |= TIM_CCER_CC2E;
+
+    if (!(stamp->CR1 & TIM_CR1_CEN))
+    {
+        stamp->PSC = 0U;
+        stamp->ARR = 0xFFFFFFFFU;
+        stamp->EGR = TIM_EGR_UG;
+        stamp->CR1 |= TIM_CR1_CEN;
+    }
+
+    e->tim = tim;
+    e->stamp = stamp;
+    e->stamp_hz = (float)(SystemCoreClock / (stamp->PSC + 1U));
+    e->stop_ticks = (uint32_t)((e->stamp_hz / 1000000.0f) * (float)cfg->stop_us);
+    e->have_edge = 0U;
+    e->edge_dt = 0U;
+    e->edge_dir = 0;
+    e->position = 0;
+    e->velocity = 0.0f;
+
+    tim->EGR = TIM_EGR_UG;
+    e->last_cnt = (uint16_t)tim->CNT;
+    tim->CR1 |= TIM_CR1_CEN;
+
+    return ENC_OK;
+}
+
+   /*--------------------------------------------------
+    * The edge time (stamp CCR2) is read before and
+    * after the edge count (CCR1) and CNT: if an edge
+    * came in between, both are read again, so count
+    * and time always belong to the same edge.
+    *-------------------------------------------------*/
+int32_t enc_update(enc_t *e)
+{
+    uint32_t t_edge;
+    uint32_t c_edge;
+    uint32_t now;
+    uint16_t cnt;
+    int32_t pos;
+    int32_t edge_pos;
+
+    do
+    {
+        t_edge = e->stamp->CCR2;
+        c_edge = e->tim->CCR1;
+        cnt = (uint16_t)e->tim->CNT;
+        now = e->stamp->CNT;
+    } while (t_edge != e->stamp->CCR2);
+
+    pos = e->position + (int16_t)(uint16_t)(cnt - e->last_cnt);
+    e->last_cnt = cnt;
+    e->position = pos;
+
+    edge_pos = pos + (int16_t)(uint16_t)((uint16_t)c_edge - cnt);
+
+    if (e->have_edge == 0U)
+    {
+        /* first call: CCR2 may be stale, only a reference */
+        e->have_edge = 1U;
+    }
+    else if (t_edge != e->edge_time)
+    {
+        int32_t dp = edge_pos - e->edge_pos;
+
+        if (e->have_edge == 2U)
+        {
+            e->edge_dt = t_edge - e->edge_time;
+            e->edge_dir = (dp > 0) ? 1 : ((dp < 0) ? -1 : 0);
+            e->velocity = ((float)dp * e->stamp_hz) / (float)e->edge_dt;
+        }
+        e->have_edge = 2U;                     /* reference is a real edge now */
+    }
+    else
+    {
+        uint32_t since = now - e->edge_time;
+
+        if (since > e->stop_ticks)
+        {
+            e->velocity = 0.0f;
+        }
+        else if ((e->edge_dt != 0U) && (since > e->edge_dt))
+        {
+            /* slower than the last interval: at most one A period by now */
+            e->velocity = ((float)(e->edge_dir * EDGE_COUNTS) * e->stamp_hz) / (float)since;
+        }
+    }
+
+    e->edge_time = t_edge;
+    e->edge_pos = edge_pos;
+
+    return pos;
+}
+
+void enc_set_position(enc_t *e, int32_t pos)
+{
+    int32_t shift = pos - e->position;
+
+    e->position = pos;
+    e->edge_pos += shift;
+}
@@ -0,0 +1,85 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Quadrature encoder on TIM3 / TIM4
+    *
+    * The timer counts A/B edges in hardware (encoder
+    * mode 3, SMS = 011, x4), with the input filter on
+    * both channels. enc_update() extends the 16-bit
+    * counter to a 32-bit position from the signed
+    * difference to the previous read, so it must run
+    * at least once per 32768 counts (a 1 kHz loop
+    * covers 32 M counts/s).
+    *
+    * Velocity, M/T method: channel 1 also captures on
+    * every rising A edge. The capture pulses TRGO
+    * (MMS = compare pulse), which a free-running stamp
+    * timer (TIM2 or TIM5) captures as a timestamp on
+    * TRC. So at each update the driver knows the
+    * position and the time of the last A edge, both
+    * latched by hardware at the same edge, and
+    *   v = counts between edges / time between edges
+    * is exact at high speed (many edges per update)
+    * and at low speed (one edge per many updates).
+    * Without a new edge the estimate decays as the
+    * time since the last edge grows, and drops to 0
+    * after stop_us.
+    *
+    * Each encoder needs its own stamp timer, because
+    * the stamp timer's trigger selects the encoder.
+    * If the stamp timer is not running it is started
+    * at full speed; a running one (e.g. the TIM5
+    * timebase) keeps its prescaler. Capture channel 2
+    * of the stamp timer is used.
+    *
+    * enc_update() is O(1) and meant for one periodic
+    * context (e.g. the motion loop ISR); the results
+    * can be read from anywhere.
+    *-------------------------------------------------*/
+
+#define ENC_OK           0
+#define ENC_ERR_CONFIG  -1
+
+typedef struct
+{
+    TIM_TypeDef *tim;                          /* TIM3 or TIM4, CH1 = A, CH2 = B */
+    TIM_TypeDef *stamp;                        /* TIM2 or TIM5 */
+    uint8_t      filter;                       /* ICxF, 0..15 */
+    uint8_t      invert;                       /* count the other direction */
+    uint32_t     stop_us;                      /* no edge for this long: v = 0 */
+} enc_cfg_t;
+
+typedef struct
+{
+    TIM_TypeDef      *tim;
+    TIM_TypeDef      *stamp;
+    float             stamp_hz;
+    uint32_t          stop_ticks;
+    uint16_t          last_cnt;
+    uint8_t           have_edge;               /* 0 none, 1 stale, 2 real edge */
+    int32_t           edge_pos;                /* position at the last A edge */
+    uint32_t          edge_time;               /* stamp ticks */
+    uint32_t          edge_dt;                 /* between the last two edges */
+    int32_t           edge_dir;
+    volatile int32_t  position;                /* counts */
+    volatile float    velocity;                /* counts / s */
+} enc_t;
+
+int     enc_init(enc_t *e, const enc_cfg_t *cfg);
+int32_t enc_update(enc_t *e);                  /* returns the position */
+void    enc_set_position(enc_t *e, int32_t pos);
+
+static inline int32_t enc_position(const enc_t *e)
+{
+    return e->position;
+}
+
+static inline float enc_velocity(const enc_t *e)
+{
+    return e->velocity;
+}
+
+#endif /* ENCODER_H */
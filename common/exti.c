@@ -0,0 +1,290 @@
+#include "exti.h"
+#include "spsc.h"
+#include "swtimer.h"
+
+   /* IMR bit of one line through the bit-band alias: atomic, no lock */
+#define IMR_BB(line)  GPIO_BB(&EXTI->IMR, (line))
+
+typedef struct
+{
+    uint64_t t;
+    uint8_t  line;
+    uint8_t  level;
+} exti_evt_t;
+
+SPSC_QUEUE_DEFINE(exti_q, exti_evt_t, EXTI_QUEUE_LEN)
+
+typedef enum
+{
+    LINE_FREE = 0,
+    LINE_IDLE,
+    LINE_SETTLING
+} line_state_t;
+
+typedef struct
+{
+    line_state_t  state;
+    GPIO_TypeDef *port;
+    exti_edge_t   edge;
+    uint32_t      debounce_us;
+    exti_fn_t     fn;
+    void         *ctx;
+    uint8_t       stable;                      /* last accepted level */
+    uint64_t      t_edge;                      /* first edge of the window */
+    uint64_t      deadline;
+    exti_stats_t  stats;
+} exti_line_t;
+
+static exti_q_t queue;
+static exti_line_t lines[EXTI_LINES];
+static uint32_t irq_prio = 0U;
+
+static IRQn_Type line_irq(uint32_t line)
+{
+    if (line <= 4U)
+    {
+        return (IRQn_Type)((uint32_t)EXTI0_IRQn + line);
+    }
+
+    return (line <= 9U) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+   /*--------------------------------------------------
+    * Common body of the EXTI vectors: group is the set
+    * of lines the vector serves
+    *-------------------------------------------------*/
+static void exti_dispatch(uint32_t group)
+{
+    uint32_t pending = EXTI->PR & EXTI->IMR & group;
+    uint64_t now;
+
+    if (pending == 0U)
+    {
+        return;
+    }
+
+    EXTI->PR = pending;                        /* rc_w1 */
+    now = timebase_now64();
+
+    while (pending != 0U)
+    {
+        uint32_t line = (uint32_t)__builtin_ctz(pending);
+        exti_line_t *l = &lines[line];
+        exti_evt_t e;
+
+        pending &= pending - 1U;
+
+        e.t = now;
+        e.line = (uint8_t)line;
+        e.level = (uint8_t)((l->port->IDR >> line) & 1U);
+        l->stats.irqs++;
+
+        /* mask only a queued edge: nothing would unmask a dropped one */
+        if (exti_q_push(&queue, &e) && (l->debounce_us != 0U))
+        {
+            *IMR_BB(line) = 0U;                /* quiet until the window ends */
+        }
+    }
+}
+
+void EXTI0_IRQHandler(void)     { exti_dispatch(1UL << 0); }
+void EXTI1_IRQHandler(void)     { exti_dispatch(1UL << 1); }
+void EXTI2_IRQHandler(void)     { exti_dispatch(1UL << 2); }
+void EXTI3_IRQHandler(void)     { exti_dispatch(1UL << 3); }
+void EXTI4_IRQHandler(void)     { exti_dispatch(1UL << 4); }
+void EXTI9_5_IRQHandler(void)   { exti_dispatch(0x03E0U); }
+void EXTI15_10_IRQHandler(void) { exti_dispatch(0xFC00U); }
+
+void exti_init(uint32_t prio)
+{
+    uint32_t i;
+
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+    EXTI->IMR &= ~0xFFFFU;
+    EXTI->RTSR &= ~0xFFFFU;
+    EXTI->FTSR &= ~0xFFFFU;
+    EXTI->PR = 0xFFFFU;
+
+    for (i = 0U; i < EXTI_LINES; i++)
+    {
+        lines[i].state = LINE_FREE;
+    }
+
+    queue.idx.head = 0U;
+    queue.idx.tail = 0U;
+    queue.idx.dropped = 0U;
+    queue.idx.high_water = 0U;
+
+    irq_prio = prio;
+}
+
+int exti_attach(const exti_cfg_t *cfg)
+{
+    uint32_t line = GPIO_PIN_NUM(cfg->pin);
+    uint32_t port = GPIO_PIN_PORT(cfg->pin);
+    uint32_t edge = (uint32_t)cfg->edge;
+    exti_line_t *l = &lines[line];
+    IRQn_Type irqn = line_irq(line);
+
+    if ((port >= GPIO_PORTS) || (edge < 1U) || (edge > 3U))
+    {
+        return EXTI_ERR_CONFIG;
+    }
+
+    if (l->state != LINE_FREE)
+    {
+        return EXTI_ERR_BUSY;
+    }
+
+    l->port = GPIO_PORT_OF(cfg->pin);
+    l->edge = cfg->edge;
+    l->debounce_us = cfg->debounce_us;
+    l->fn = cfg->fn;
+    l->ctx = cfg->ctx;
+    l->stable = (uint8_t)((l->port->IDR >> line) & 1U);
+    l->stats.irqs = 0U;
+    l->stats.reported = 0U;
+    l->stats.rejected = 0U;
+    l->state = LINE_IDLE;
+
+    SYSCFG->EXTICR[line / 4U] = (SYSCFG->EXTICR[line / 4U] & ~(0xFUL << (4U * (line % 4U)))) |
+                                (port << (4U * (line % 4U)));
+
+   /*--------------------------------------------------
+    * A debounced line has to see both edges: the
+    * level at the end of the window decides
+    *-------------------------------------------------*/
+    if ((edge & EXTI_EDGE_RISING) || (cfg->debounce_us != 0U))
+    {
+        EXTI->RTSR |= 1UL << line;
+    }
+    if ((edge & EXTI_EDGE_FALLING) || (cfg->debounce_us != 0U))
+    {
+        EXTI->FTSR |= 1UL << line;
+    }
+
+    EXTI->PR = 1UL << line;
+    *IMR_BB(line) = 1U;
+
+    NVIC_SetPriority(irqn, irq_prio);
+    NVIC_EnableIRQ(irqn);
+
+    return (int)line;
+}
+
+void exti_detach(uint32_t line)
+{
+    if (line >= EXTI_LINES)
+    {
+        return;
+    }
+
+    *IMR_BB(line) = 0U;
+    EXTI->RTSR &= ~(1UL << line);
+    EXTI->FTSR &= ~(1UL << line);
+    EXTI->PR = 1UL << line;
+
+    lines[line].state = LINE_FREE;             /* queued events for it are dropped */
+}
+
+static uint32_t wanted(const exti_line_t *l, uint32_t level)
+{
+    return level ? ((uint32_t)l->edge & EXTI_EDGE_RISING)
+                 : ((uint32_t)l->edge & EXTI_EDGE_FALLING);
+}
+
+static void report(exti_line_t *l, uint32_t line, uint32_t level, uint64_t t)
+{
+    if (wanted(l, level) && (l->fn != 0))
+    {
+        l->stats.reported++;
+        l->fn(line, level, t, l->ctx);
+    }
+}
+
+   /*--------------------------------------------------
+    * Queue first, then the debounce windows. A window
+    * ends by clearing PR before unmasking, and the
+    * level is read after: an edge after the read
+    * interrupts again.
+    *-------------------------------------------------*/
+uint32_t exti_process(void)
+{
+    exti_evt_t e;
+    uint64_t now;
+    uint32_t settling = 0U;
+    uint32_t i;
+
+    while (exti_q_pop(&queue, &e))
+    {
+        exti_line_t *l = &lines[e.line];
+
+        if (l->state == LINE_FREE)
+        {
+            continue;
+        }
+
+        if (l->debounce_us == 0U)
+        {
+            l->stable = e.level;
+            report(l, e.line, e.level, e.t);
+        }
+        else if (l->state == LINE_IDLE)
+        {
+            l->state = LINE_SETTLING;
+            l->t_edge = e.t;
+            l->deadline = e.t + l->debounce_us;
+        }
+        else
+        {
+            /* settling already, the line was masked */
+        }
+    }
+
+    now = timebase_now64();
+
+    for (i = 0U; i < EXTI_LINES; i++)
+    {
+        exti_line_t *l = &lines[i];
+        uint32_t level;
+
+        if (l->state != LINE_SETTLING)
+        {
+            continue;
+        }
+
+        if (now < l->deadline)
+        {
+            settling++;
+            continue;
+        }
+
+        EXTI->PR = 1UL << i;
+        *IMR_BB(i) = 1U;
+        level = (l->port->IDR >> i) & 1U;
+        l->state = LINE_IDLE;
+
+        if (level != l->stable)
+        {
+            l->stable = (uint8_t)level;
+            report(l, i, level, l->t_edge);
+        }
+        else
+        {
+            l->stats.rejected++;               /* glitch, back to where it was */
+        }
+    }
+
+    return settling;
+}
+
+const exti_stats_t *exti_stats(uint32_t line)
+{
+    return (line < EXTI_LINES) ? &lines[line].stats : 0;
+}
+
+uint32_t exti_dropped(void)
+{
+    return queue.idx.dropped;
+}
@@ -0,0 +1,89 @@
+#ifndef EXTI_H
+#define EXTI_H
+
+#include "stm32f4xx.h"
+#include "gpio.h"
+
+   /*--------------------------------------------------
+    * EXTI lines with timestamped edges and debounce
+    *
+    * exti_attach() routes a pin to its line (SYSCFG
+    * EXTICR: line n takes pin n of one port), selects
+    * the edges and enables the vector; lines 5..9 and
+    * 10..15 share EXTI9_5 / EXTI15_10, whose handlers
+    * serve every pending line of the group.
+    *
+    * The interrupt only clears PR, stamps the edge
+    * with timebase_now64() (TIM5, 1 us), reads the pin
+    * level and pushes { time, line, level } into a
+    * lock-free queue. All EXTI vectors run at the one
+    * priority given to exti_init(), so they never
+    * preempt each other and the queue has a single
+    * producer. Everything else happens in
+    * exti_process(), called from the main loop or a
+    * task: the line callbacks run there.
+    *
+    * Debounce: on a line with debounce_us the first
+    * edge masks the line (IMR, bit-band, no lock), so
+    * a bouncing contact costs one interrupt, not one
+    * per bounce. exti_process() samples the pin once
+    * debounce_us after that edge, unmasks the line and
+    * reports a change only if the level differs from
+    * the last accepted one, stamped with the first
+    * edge. An edge the full queue drops leaves the
+    * line unmasked, so the next edge starts the
+    * window instead. Lines without debounce report
+    * every edge; a burst faster than the task drains
+    * the queue drops events (exti_dropped()) but
+    * never holds off other interrupts for longer than
+    * one short handler per edge.
+    *
+    * timebase_init() must run before the first edge.
+    * Pin mode and pull-up / pull-down are left to the
+    * caller (gpio_config(), GPIO_MODE_INPUT).
+    *-------------------------------------------------*/
+
+#define EXTI_LINES       16U
+#define EXTI_QUEUE_LEN   32U                   /* power of 2 */
+
+#define EXTI_OK           0
+#define EXTI_ERR_CONFIG  -1                    /* bad pin / edge */
+#define EXTI_ERR_BUSY    -2                    /* line already attached */
+
+typedef enum
+{
+    EXTI_EDGE_RISING  = 1,
+    EXTI_EDGE_FALLING = 2,
+    EXTI_EDGE_BOTH    = 3
+} exti_edge_t;
+
+   /* level after the edge, t_us from timebase_now64() */
+typedef void (*exti_fn_t)(uint32_t line, uint32_t level, uint64_t t_us, void *ctx);
+
+typedef struct
+{
+    gpio_pin_t  pin;
+    exti_edge_t edge;
+    uint32_t    debounce_us;                   /* 0 = report raw edges */
+    exti_fn_t   fn;
+    void       *ctx;
+} exti_cfg_t;
+
+typedef struct
+{
+    uint32_t irqs;                             /* edges seen by the interrupt */
+    uint32_t reported;                         /* callbacks run */
+    uint32_t rejected;                         /* debounced away */
+} exti_stats_t;
+
+void exti_init(uint32_t prio);
+int  exti_attach(const exti_cfg_t *cfg);       /* returns the line or an error */
+void exti_detach(uint32_t line);
+
+   /* drain the queue, finish debounce windows; returns lines still settling */
+uint32_t exti_process(void);
+
+const exti_stats_t *exti_stats(uint32_t line);
+uint32_t exti_dropped(void);
+
+#endif /* EXTI_H */
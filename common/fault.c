@@ -0,0 +1,236 @@
+#include "fault.h"
+
+#define FAULT_STACK_WORDS  128U
+#define SCAN_WORDS         256U                /* stack words searched for return addresses */
+
+extern uint32_t _etext;
+extern uint32_t _estack;
+
+static fault_record_t record FAULT_NOINIT;
+static uint32_t fault_stack[FAULT_STACK_WORDS] __attribute__((aligned(8)));
+
+void fault_capture(uint32_t *frame, uint32_t exc_return);
+
+   /*--------------------------------------------------
+    * Entry: pick the stack that took the exception
+    * frame (EXC_RETURN bit 2), move to the private
+    * stack, so even a stack overflow can be recorded
+    *-------------------------------------------------*/
+#define FAULT_ENTRY(name)                                   \
+    __attribute__((naked)) void name(void)                  \
+    {                                                       \
+        __asm volatile                                      \
+        (                                                   \
+            "tst   lr, #4          \n"                      \
+            "ite   eq              \n"                      \
+            "mrseq r0, msp         \n"                      \
+            "mrsne r0, psp         \n"                      \
+            "mov   r1, lr          \n"                      \
+            "ldr   r2, =fault_stack_top \n"                 \
+            "ldr   r2, [r2]        \n"                      \
+            "msr   msp, r2         \n"                      \
+            "b     fault_capture   \n"                      \
+        );                                                  \
+    }
+
+uint32_t *const fault_stack_top = &fault_stack[FAULT_STACK_WORDS];
+
+FAULT_ENTRY(HardFault_Handler)
+FAULT_ENTRY(MemManage_Handler)
+FAULT_ENTRY(BusFault_Handler)
+FAULT_ENTRY(UsageFault_Handler)
+
+static uint32_t in_ram(uint32_t addr, uint32_t bytes)
+{
+    return (addr >= SRAM1_BASE) && (addr <= ((uint32_t)&_estack - bytes)) &&
+           ((addr & 3U) == 0U);
+}
+
+static uint32_t is_return_address(uint32_t v)
+{
+    /* Thumb bit set, inside the code in flash */
+    return ((v & 1U) != 0U) && (v >= FLASH_BASE) && (v < (uint32_t)&_etext);
+}
+
+void fault_capture(uint32_t *frame, uint32_t exc_return)
+{
+    uint32_t addr = (uint32_t)frame;
+    uint32_t frame_words = (exc_return & (1UL << 4)) ? 8U : 26U;   /* bit 4 = 0: FP state stacked */
+    uint32_t i;
+
+    record.magic = FAULT_MAGIC;
+    record.check = 0U;
+    record.count++;
+    record.vector = __get_IPSR() & 0x1FFU;
+    record.exc_return = exc_return;
+    record.cfsr = SCB->CFSR;
+    record.hfsr = SCB->HFSR;
+    record.mmfar = SCB->MMFAR;
+    record.bfar = SCB->BFAR;
+    record.n_bt = 0U;
+
+    if (in_ram(addr, frame_words * 4U))
+    {
+        record.r0 = frame[0];
+        record.r1 = frame[1];
+        record.r2 = frame[2];
+        record.r3 = frame[3];
+        record.r12 = frame[4];
+        record.lr = frame[5];
+        record.pc = frame[6];
+        record.xpsr = frame[7];
+        record.sp = addr + (frame_words * 4U) + (((frame[7] >> 9) & 1U) * 4U);   /* STKALIGN pad */
+
+       /*--------------------------------------------------
+        * Backtrace by scan: from the caller's SP up to
+        * the top of RAM, at most SCAN_WORDS words
+        *-------------------------------------------------*/
+        for (i = 0U; (i < SCAN_WORDS) && (record.n_bt < FAULT_BT_LEN); i++)
+        {
+            uint32_t a = record.sp + (i * 4U);
+            uint32_t v;
+
+            if (!in_ram(a, 4U))
+            {
+                break;
+            }
+
+            v = *(const uint32_t *)a;
+            if (is_return_address(v))
+            {
+                record.bt[record.n_bt++] = v;
+            }
+        }
+    }
+    else
+    {
+        record.r0 = record.r1 = record.r2 = record.r3 = 0U;
+        record.r12 = record.lr = record.pc = record.xpsr = 0U;
+        record.sp = addr;
+    }
+
+    record.check = ~FAULT_MAGIC;
+
+    __DSB();
+    NVIC_SystemReset();
+}
+
+   /* after power-on the record is random: start counting from 0 */
+static void record_check(void)
+{
+    if (record.magic != FAULT_MAGIC)
+    {
+        record.magic = FAULT_MAGIC;
+        record.count = 0U;
+        record.check = 0U;
+    }
+}
+
+void fault_init(void)
+{
+    record_check();
+
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk |
+                  SCB_SHCSR_USGFAULTENA_Msk;
+    SCB->CCR |= SCB_CCR_DIV_0_TRP_Msk;
+    __DSB();
+    __ISB();
+}
+
+uint32_t fault_take(fault_record_t *out)
+{
+    record_check();
+
+    if (record.check != ~FAULT_MAGIC)
+    {
+        return 0U;
+    }
+
+    *out = record;
+    record.check = 0U;                         /* reported once */
+
+    return 1U;
+}
+
+   /*--------------------------------------------------
+    * Report lines, all values in hex:
+    *   FAULT <name> count=N
+    *   FAULT pc=.. lr=.. sp=.. xpsr=.. exc=..
+    *   FAULT r0=.. r1=.. r2=.. r3=.. r12=..
+    *   FAULT cfsr=.. hfsr=.. mmfar=.. bfar=..
+    *   FAULT bt=.. .. ..
+    *-------------------------------------------------*/
+static void hex(fault_out_t out, const char *label, uint32_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[11];
+    int i;
+
+    buf[0] = '0';
+    buf[1] = 'x';
+    for (i = 0; i < 8; i++)
+    {
+        buf[2 + i] = digits[(v >> (28U - (4U * (uint32_t)i))) & 0xFU];
+    }
+    buf[10] = '\0';
+
+    out(label);
+    out(buf);
+}
+
+static const char *vector_name(uint32_t v)
+{
+    switch (v)
+    {
+        case 3U: return "HardFault";
+        case 4U: return "MemManage";
+        case 5U: return "BusFault";
+        case 6U: return "UsageFault";
+        default: return "unknown";
+    }
+}
+
+uint32_t fault_report(fault_out_t out)
+{
+    fault_record_t r;
+    uint32_t i;
+
+    if (!fault_take(&r))
+    {
+        return 0U;
+    }
+
+    out("FAULT ");
+    out(vector_name(r.vector));
+    hex(out, " count=", r.count);
+    out("\r\n");
+
+    hex(out, "FAULT pc=", r.pc);
+    hex(out, " lr=", r.lr);
+    hex(out, " sp=", r.sp);
+    hex(out, " xpsr=", r.xpsr);
+    hex(out, " exc=", r.exc_return);
+    out("\r\n");
+
+    hex(out, "FAULT r0=", r.r0);
+    hex(out, " r1=", r.r1);
+    hex(out, " r2=", r.r2);
+    hex(out, " r3=", r.r3);
+    hex(out, " r12=", r.r12);
+    out("\r\n");
+
+    hex(out, "FAULT cfsr=", r.cfsr);
+    hex(out, " hfsr=", r.hfsr);
+    hex(out, " mmfar=", r.mmfar);
+    hex(out, " bfar=", r.bfar);
+    out("\r\n");
+
+    out("FAULT bt=");
+    for (i = 0U; i < r.n_bt; i++)
+    {
+        hex(out, (i == 0U) ? "" : " ", r.bt[i]);
+    }
+    out("\r\n");
+
+    return 1U;
+}
@@ -0,0 +1,69 @@
+#ifndef FAULT_H
+#define FAULT_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Fault handlers with a crash record in retained
+    * RAM
+    *
+    * HardFault, MemManage, BusFault and UsageFault
+    * switch to a private stack, then save into a
+    * record in .noinit (not cleared by the startup
+    * code, kept across a reset):
+    *   - the stacked frame r0-r3, r12, lr, pc, xpsr
+    *     of the faulting context (MSP or PSP, from
+    *     EXC_RETURN) and its SP before the fault
+    *   - EXC_RETURN, CFSR, HFSR, MMFAR, BFAR
+    *   - a short backtrace: words above the frame on
+    *     the faulting stack that look like Thumb
+    *     return addresses into .text. This is a scan,
+    *     not an unwind, so stale entries may show up;
+    *     the first ones are usually right.
+    * and reset the chip. If the frame pointer is not
+    * in RAM (stack overflow) only the registers are
+    * saved.
+    *
+    * After the reset fault_report() prints the record
+    * once, as lines a host script turns into source
+    * lines:
+    *   common/tools/fault_decode.py app.elf < log
+    *
+    * fault_init() enables the separate MemManage /
+    * BusFault / UsageFault handlers (otherwise all of
+    * them escalate to HardFault) and traps integer
+    * division by zero.
+    *-------------------------------------------------*/
+
+#define FAULT_NOINIT     __attribute__((section(".noinit")))
+#define FAULT_BT_LEN     8U
+#define FAULT_MAGIC      0xFA17C0DEU
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t count;                            /* faults since power-on */
+    uint32_t vector;                           /* 3 HardFault .. 6 UsageFault */
+    uint32_t r0, r1, r2, r3, r12, lr, pc, xpsr;
+    uint32_t sp;                               /* faulting SP before stacking */
+    uint32_t exc_return;
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t n_bt;
+    uint32_t bt[FAULT_BT_LEN];
+    uint32_t check;                            /* ~magic when the record is complete */
+} fault_record_t;
+
+typedef void (*fault_out_t)(const char *s);
+
+void fault_init(void);
+
+   /* 1 and a copy if a record from before the last reset is there, then cleared */
+uint32_t fault_take(fault_record_t *out);
+
+   /* fault_take() and print it; returns 1 if there was one */
+uint32_t fault_report(fault_out_t out);
+
+#endif /* FAULT_H */
@@ -0,0 +1,153 @@
+#include "gpio.h"
+
+typedef struct
+{
+    uint32_t used;
+    uint32_t moder_m, moder_v;
+    uint32_t otyper_m, otyper_v;
+    uint32_t ospeedr_m, ospeedr_v;
+    uint32_t pupdr_m, pupdr_v;
+    uint32_t afr_m[2], afr_v[2];
+    uint32_t set, reset;
+} port_acc_t;
+
+   /* each set bit of a 16-bit mask spread to a 2-bit field */
+static uint32_t spread2(uint32_t pins)
+{
+    uint32_t out = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < 16U; i++)
+    {
+        if (pins & (1UL << i))
+        {
+            out |= 3UL << (2U * i);
+        }
+    }
+
+    return out;
+}
+
+   /* each set bit of an 8-bit mask spread to a 4-bit field */
+static uint32_t spread4(uint32_t pins)
+{
+    uint32_t out = 0U;
+    uint32_t i;
+
+    for (i = 0U; i < 8U; i++)
+    {
+        if (pins & (1UL << i))
+        {
+            out |= 0xFUL << (4U * i);
+        }
+    }
+
+    return out;
+}
+
+   /*--------------------------------------------------
+    * Collect masks and values per port first, then
+    * one masked write per register
+    *-------------------------------------------------*/
+void gpio_config(const gpio_cfg_t *cfg, uint32_t n)
+{
+    port_acc_t acc[GPIO_PORTS] = { 0 };
+    uint32_t i;
+
+    for (i = 0U; i < n; i++)
+    {
+        const gpio_cfg_t *c = &cfg[i];
+        port_acc_t *a;
+        uint32_t m2;
+        uint32_t k;
+
+        if (c->port >= GPIO_PORTS)
+        {
+            continue;
+        }
+
+        a = &acc[c->port];
+        m2 = spread2(c->pins);
+        a->used = 1U;
+
+        a->moder_m |= m2;
+        a->moder_v = (a->moder_v & ~m2) | (m2 & (0x55555555UL * (uint32_t)c->mode));
+
+        a->pupdr_m |= m2;
+        a->pupdr_v = (a->pupdr_v & ~m2) | (m2 & (0x55555555UL * (uint32_t)c->pull));
+
+        if ((c->mode == GPIO_MODE_OUTPUT) || (c->mode == GPIO_MODE_AF))
+        {
+            a->otyper_m |= c->pins;
+            a->otyper_v = (a->otyper_v & ~(uint32_t)c->pins) |
+                          (c->open_drain ? (uint32_t)c->pins : 0U);
+
+            a->ospeedr_m |= m2;
+            a->ospeedr_v = (a->ospeedr_v & ~m2) | (m2 & (0x55555555UL * (uint32_t)c->speed));
+        }
+
+        if (c->mode == GPIO_MODE_OUTPUT)
+        {
+            /* a later entry for the same pin wins */
+            if (c->level)
+            {
+                a->set |= c->pins;
+                a->reset &= ~(uint32_t)c->pins;
+            }
+            else
+            {
+                a->reset |= c->pins;
+                a->set &= ~(uint32_t)c->pins;
+            }
+        }
+
+        if (c->mode == GPIO_MODE_AF)
+        {
+            for (k = 0U; k < 2U; k++)
+            {
+                uint32_t m4 = spread4(((uint32_t)c->pins >> (8U * k)) & 0xFFU);
+
+                a->afr_m[k] |= m4;
+                a->afr_v[k] = (a->afr_v[k] & ~m4) | (m4 & (0x11111111UL * (uint32_t)(c->af & 0xFU)));
+            }
+        }
+    }
+
+    for (i = 0U; i < GPIO_PORTS; i++)
+    {
+        port_acc_t *a = &acc[i];
+        GPIO_TypeDef *g;
+
+        if (!a->used)
+        {
+            continue;
+        }
+
+        RCC->AHB1ENR |= 1UL << i;              /* GPIOxEN = bit x */
+        __DSB();
+        g = (GPIO_TypeDef *)(GPIOA_BASE + (i * 0x400UL));
+
+        if (a->set | a->reset)
+        {
+            g->BSRR = (a->reset << 16) | a->set;
+        }
+        if (a->otyper_m)
+        {
+            g->OTYPER = (g->OTYPER & ~a->otyper_m) | a->otyper_v;
+        }
+        if (a->ospeedr_m)
+        {
+            g->OSPEEDR = (g->OSPEEDR & ~a->ospeedr_m) | a->ospeedr_v;
+        }
+        g->PUPDR = (g->PUPDR & ~a->pupdr_m) | a->pupdr_v;
+        if (a->afr_m[0])
+        {
+            g->AFR[0] = (g->AFR[0] & ~a->afr_m[0]) | a->afr_v[0];
+        }
+        if (a->afr_m[1])
+        {
+            g->AFR[1] = (g->AFR[1] & ~a->afr_m[1]) | a->afr_v[1];
+        }
+        g->MODER = (g->MODER & ~a->moder_m) | a->moder_v;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * GPIO fast path and batch configuration
+    *
+    * A pin is a compile-time constant, port index in
+    * bits 7:4 and pin number in bits 3:0, e.g.
+    *   #define LED  GPIO_PA(5)
+    * With a constant pin every inline call below folds
+    * to one store to a fixed address:
+    *
+    *   gpio_high / gpio_low / gpio_write   BSRR
+    *   *GPIO_BB_OUT(LED) = v               bit-band ODR
+    *
+    * Both are atomic: no read-modify-write of ODR, so
+    * an ISR and main may drive pins of the same port
+    * without masking interrupts. gpio_toggle() reads
+    * ODR and writes BSRR, atomic for the other pins of
+    * the port; two contexts toggling the same pin
+    * still race, as with any toggle.
+    *
+    * gpio_config() takes a table of pin groups and
+    * writes each register of each port once
+    * (OTYPER, OSPEEDR, PUPDR, AFR, then MODER last so
+    * a pin switches to its final mode only after its
+    * alternate function and output level are set).
+    *-------------------------------------------------*/
+
+#define GPIO_PORT_A  0U
+#define GPIO_PORT_B  1U
+#define GPIO_PORT_C  2U
+#define GPIO_PORT_D  3U
+#define GPIO_PORT_E  4U
+#define GPIO_PORT_H  7U
+#define GPIO_PORTS   8U
+
+#define GPIO_PIN(port, n)  ((((uint32_t)(port)) << 4) | ((uint32_t)(n) & 0xFU))
+#define GPIO_PA(n)         GPIO_PIN(GPIO_PORT_A, n)
+#define GPIO_PB(n)         GPIO_PIN(GPIO_PORT_B, n)
+#define GPIO_PC(n)         GPIO_PIN(GPIO_PORT_C, n)
+#define GPIO_PD(n)         GPIO_PIN(GPIO_PORT_D, n)
+#define GPIO_PE(n)         GPIO_PIN(GPIO_PORT_E, n)
+#define GPIO_PH(n)         GPIO_PIN(GPIO_PORT_H, n)
+
+#define GPIO_PIN_PORT(p)   (((uint32_t)(p)) >> 4)
+#define GPIO_PIN_NUM(p)    (((uint32_t)(p)) & 0xFU)
+#define GPIO_PIN_MASK(p)   (1UL << GPIO_PIN_NUM(p))
+
+   /* ports are 0x400 apart from GPIOA, GPIOH included */
+#define GPIO_BASE_OF(p)    (GPIOA_BASE + (GPIO_PIN_PORT(p) * 0x400UL))
+#define GPIO_PORT_OF(p)    ((GPIO_TypeDef *)GPIO_BASE_OF(p))
+
+   /* bit-band alias of one register bit (RM0368 2.3.2) */
+#define GPIO_BB(addr, bit) \
+    ((volatile uint32_t *)(PERIPH_BB_BASE + (((uint32_t)(addr) - PERIPH_BASE) * 32U) + ((bit) * 4U)))
+#define GPIO_BB_OUT(p)     GPIO_BB(GPIO_BASE_OF(p) + 0x14U, GPIO_PIN_NUM(p))    /* ODR */
+#define GPIO_BB_IN(p)      GPIO_BB(GPIO_BASE_OF(p) + 0x10U, GPIO_PIN_NUM(p))    /* IDR */
+
+typedef uint32_t gpio_pin_t;
+
+typedef enum
+{
+    GPIO_MODE_INPUT = 0,
+    GPIO_MODE_OUTPUT,
+    GPIO_MODE_AF,
+    GPIO_MODE_ANALOG
+} gpio_mode_t;
+
+typedef enum
+{
+    GPIO_PULL_NONE = 0,
+    GPIO_PULL_UP,
+    GPIO_PULL_DOWN
+} gpio_pull_t;
+
+typedef enum
+{
+    GPIO_SPEED_LOW = 0,
+    GPIO_SPEED_MEDIUM,
+    GPIO_SPEED_FAST,
+    GPIO_SPEED_HIGH
+} gpio_speed_t;
+
+typedef struct
+{
+    uint8_t      port;                         /* GPIO_PORT_x */
+    uint16_t     pins;                         /* mask, all get the same settings */
+    gpio_mode_t  mode;
+    uint8_t      open_drain;
+    gpio_speed_t speed;
+    gpio_pull_t  pull;
+    uint8_t      af;                           /* GPIO_MODE_AF: 0..15 */
+    uint8_t      level;                        /* GPIO_MODE_OUTPUT: initial level */
+} gpio_cfg_t;
+
+void gpio_config(const gpio_cfg_t *cfg, uint32_t n);
+
+static inline void gpio_high(gpio_pin_t p)
+{
+    GPIO_PORT_OF(p)->BSRR = GPIO_PIN_MASK(p);
+}
+
+static inline void gpio_low(gpio_pin_t p)
+{
+    GPIO_PORT_OF(p)->BSRR = GPIO_PIN_MASK(p) << 16;
+}
+
+static inline void gpio_write(gpio_pin_t p, uint32_t v)
+{
+    GPIO_PORT_OF(p)->BSRR = GPIO_PIN_MASK(p) << (v ? 0U : 16U);
+}
+
+static inline uint32_t gpio_read(gpio_pin_t p)
+{
+    return (GPIO_PORT_OF(p)->IDR >> GPIO_PIN_NUM(p)) & 1U;
+}
+
+   /* reads ODR, then one BSRR store: other pins are safe, the same pin
+      written by an ISR in between is not */
+static inline void gpio_toggle(gpio_pin_t p)
+{
+    GPIO_TypeDef *g = GPIO_PORT_OF(p);
+    uint32_t m = GPIO_PIN_MASK(p);
+
+    g->BSRR = (g->ODR & m) ? (m << 16) : m;
+}
+
+   /* several pins of one port in one store: set wins over reset */
+static inline void gpio_port_write(uint32_t port, uint16_t set, uint16_t reset)
+{
+    ((GPIO_TypeDef *)(GPIOA_BASE + (port * 0x400UL)))->BSRR = ((uint32_t)reset << 16) | set;
+}
+
+#endif /* GPIO_H */
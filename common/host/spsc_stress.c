@@ -0,0 +1,528 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc.h"
+
+   /*--------------------------------------------------
+    * Host stress test for common/spsc
+    *
+    * Every queue flavour runs in two modes:
+    *
+    *   threads  producer and consumer on their own
+    *            threads (and cores): both sides really
+    *            run at the same time, which checks the
+    *            fences more harshly than one core does
+    *   preempt  the producer is a SIGUSR1 handler on
+    *            the consumer's thread, raised at random
+    *            times by a third thread. It interrupts
+    *            the consumer anywhere, even inside a
+    *            pop, and runs to completion, like an ISR
+    *            on the target. A pending signal is not
+    *            queued twice, like a pending IRQ.
+    *
+    * The producer works in random bursts, so the
+    * queue runs full and drops. The consumer checks
+    * payload integrity and order, and at the end
+    * received + dropped must equal produced.
+    *
+    *   ./spsc_stress [items per run]
+    *-------------------------------------------------*/
+
+#define ITEMS_DEFAULT  1000000U
+#define MSG_LEN        64U
+#define BYTES_LEN      256U
+#define BLOCK_WORDS    16U
+#define FRAME_MAX      16U                     /* payload bytes */
+#define FRAME_HDR      5U                      /* seq (4) + len (1) */
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t check;
+    uint16_t pad[3];                           /* wider than one store */
+} msg_t;
+
+SPSC_QUEUE_DEFINE(msg_q, msg_t, MSG_LEN)
+
+typedef enum
+{
+    MODE_THREADS = 0,
+    MODE_PREEMPT
+} test_mode_t;
+
+static uint32_t n_items = ITEMS_DEFAULT;
+static uint32_t failures = 0U;
+
+   /*--------------------------------------------------
+    * State shared by producer and consumer. Counters
+    * the producer writes are read by the main thread
+    * only after the join or after done is set.
+    *-------------------------------------------------*/
+static msg_q_t      mq;
+static spsc_bytes_t bq;
+static uint8_t      bq_buf[BYTES_LEN];
+static spsc_ptr_t   full_q;                    /* producer -> consumer */
+static spsc_ptr_t   free_q;                    /* consumer -> producer */
+static uint32_t     blocks[SPSC_PTR_LEN][BLOCK_WORDS];
+
+static volatile uint32_t produced;
+static volatile uint32_t lost;                 /* items not handed over */
+static volatile uint32_t done;
+static pthread_t consumer_thread;
+
+typedef void (*step_fn_t)(uint32_t *rng);
+
+static uint32_t xorshift(uint32_t *s)
+{
+    uint32_t x = *s;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+
+    return x;
+}
+
+static uint32_t msg_check(uint32_t seq)
+{
+    return (seq * 2654435761U) ^ 0xA5A5A5A5U;
+}
+
+static void fail(const char *what, uint32_t a, uint32_t b)
+{
+    if (failures < 10U)
+    {
+        printf("  FAIL %s (%u, %u)\n", what, a, b);
+    }
+    failures++;
+}
+
+static void spin(uint32_t n)
+{
+    volatile uint32_t i;
+
+    for (i = 0U; i < n; i++)
+    {
+        /* delay */
+    }
+}
+
+   /*--------------------------------------------------
+    * Typed messages: one burst of 1..8 pushes, a full
+    * queue drops (counted by the queue itself)
+    *-------------------------------------------------*/
+static void msg_produce(uint32_t *rng)
+{
+    uint32_t burst = 1U + (xorshift(rng) & 7U);
+
+    while ((burst-- > 0U) && (produced < n_items))
+    {
+        msg_t m;
+
+        m.seq = produced;
+        m.check = msg_check(m.seq);
+        m.pad[0] = (uint16_t)m.seq;
+        m.pad[1] = (uint16_t)(m.seq >> 16);
+        m.pad[2] = (uint16_t)~m.seq;
+
+        (void)msg_q_push(&mq, &m);
+        produced = produced + 1U;
+    }
+}
+
+static uint32_t msg_consume(uint32_t *last)
+{
+    msg_t m;
+
+    if (!msg_q_pop(&mq, &m))
+    {
+        return 0U;
+    }
+
+    if ((m.check != msg_check(m.seq)) || (m.pad[0] != (uint16_t)m.seq) ||
+        (m.pad[1] != (uint16_t)(m.seq >> 16)) || (m.pad[2] != (uint16_t)~m.seq))
+    {
+        fail("msg torn", m.seq, m.check);
+    }
+
+    if ((*last != 0xFFFFFFFFU) && (m.seq <= *last))
+    {
+        fail("msg order", *last, m.seq);
+    }
+    *last = m.seq;
+
+    return 1U;
+}
+
+   /*--------------------------------------------------
+    * Byte stream: frames of seq, len, payload. A frame
+    * goes in whole or is dropped, so the consumer can
+    * always resynchronize; the partial write path is
+    * checked in threads mode, where the producer
+    * retries the rest of a frame that did not fit.
+    *-------------------------------------------------*/
+static uint32_t frame_build(uint8_t *f, uint32_t seq, uint32_t len)
+{
+    uint32_t i;
+
+    memcpy(f, &seq, 4U);
+    f[4] = (uint8_t)len;
+    for (i = 0U; i < len; i++)
+    {
+        f[FRAME_HDR + i] = (uint8_t)(seq + i);
+    }
+
+    return FRAME_HDR + len;
+}
+
+static void bytes_produce_whole(uint32_t *rng)
+{
+    uint32_t burst = 1U + (xorshift(rng) & 3U);
+
+    while ((burst-- > 0U) && (produced < n_items))
+    {
+        uint8_t f[FRAME_HDR + FRAME_MAX];
+        uint32_t n = frame_build(f, produced, xorshift(rng) % (FRAME_MAX + 1U));
+
+        if ((bq.size - spsc_bytes_count(&bq)) >= n)
+        {
+            if (spsc_bytes_write(&bq, f, n) != n)
+            {
+                fail("bytes short write", n, 0U);
+            }
+        }
+        else
+        {
+            lost = lost + 1U;
+        }
+        produced = produced + 1U;
+    }
+}
+
+static void bytes_produce_retry(uint32_t *rng)
+{
+    uint8_t f[FRAME_HDR + FRAME_MAX];
+    uint32_t n = frame_build(f, produced, xorshift(rng) % (FRAME_MAX + 1U));
+    uint32_t off = 0U;
+
+    while (off < n)
+    {
+        off += spsc_bytes_write(&bq, &f[off], n - off);  /* rest counts as dropped */
+        if (off < n)
+        {
+            lost = lost + (n - off);
+            sched_yield();
+        }
+    }
+    produced = produced + 1U;
+}
+
+static uint32_t bytes_consume(uint32_t *last)
+{
+    uint8_t f[FRAME_HDR + FRAME_MAX];
+    uint32_t seq;
+    uint32_t len;
+    uint32_t got;
+    uint32_t i;
+
+    if (spsc_bytes_count(&bq) < FRAME_HDR)
+    {
+        return 0U;
+    }
+
+    /* partial frames may be visible in threads mode: wait for the rest */
+    got = spsc_bytes_read(&bq, f, FRAME_HDR);
+    memcpy(&seq, f, 4U);
+    len = f[4];
+
+    if (len > FRAME_MAX)
+    {
+        fail("bytes frame len", seq, len);
+        return 1U;
+    }
+
+    while (got < (FRAME_HDR + len))
+    {
+        got += spsc_bytes_read(&bq, &f[got], (FRAME_HDR + len) - got);
+    }
+
+    for (i = 0U; i < len; i++)
+    {
+        if (f[FRAME_HDR + i] != (uint8_t)(seq + i))
+        {
+            fail("bytes payload", seq, i);
+            break;
+        }
+    }
+
+    if ((*last != 0xFFFFFFFFU) && (seq <= *last))
+    {
+        fail("bytes order", *last, seq);
+    }
+    *last = seq;
+
+    return 1U;
+}
+
+   /*--------------------------------------------------
+    * Pointer handoff: a pool of blocks circulates
+    * through free_q and full_q. The producer fills a
+    * free block and hands it over; no free block
+    * counts as lost.
+    *-------------------------------------------------*/
+static void ptr_produce(uint32_t *rng)
+{
+    uint32_t burst = 1U + (xorshift(rng) & 7U);
+
+    while ((burst-- > 0U) && (produced < n_items))
+    {
+        void *p;
+
+        if (spsc_ptr_pop(&free_q, &p))
+        {
+            uint32_t *b = p;
+            uint32_t i;
+
+            b[0] = produced;
+            for (i = 1U; i < BLOCK_WORDS; i++)
+            {
+                b[i] = produced ^ (i * 0x9E3779B9U);
+            }
+
+            if (!spsc_ptr_push(&full_q, &p))
+            {
+                fail("ptr full_q full", produced, 0U);
+            }
+        }
+        else
+        {
+            lost = lost + 1U;
+        }
+        produced = produced + 1U;
+    }
+}
+
+static uint32_t ptr_consume(uint32_t *last)
+{
+    void *p;
+    uint32_t *b;
+    uint32_t i;
+
+    if (!spsc_ptr_pop(&full_q, &p))
+    {
+        return 0U;
+    }
+
+    b = p;
+    for (i = 1U; i < BLOCK_WORDS; i++)
+    {
+        if (b[i] != (b[0] ^ (i * 0x9E3779B9U)))
+        {
+            fail("ptr block torn", b[0], i);
+            break;
+        }
+    }
+
+    if ((*last != 0xFFFFFFFFU) && (b[0] <= *last))
+    {
+        fail("ptr order", *last, b[0]);
+    }
+    *last = b[0];
+
+    if (!spsc_ptr_push(&free_q, &p))
+    {
+        fail("ptr free_q full", b[0], 0U);
+    }
+
+    return 1U;
+}
+
+   /*--------------------------------------------------
+    * Drivers. The sched_yield() calls keep both sides
+    * moving on a single core host; with more cores
+    * they cost little.
+    *-------------------------------------------------*/
+static step_fn_t produce_step;
+static uint32_t (*consume_step)(uint32_t *last);
+static uint32_t signal_rng = 0x12345678U;
+
+static void *producer_main(void *arg)
+{
+    uint32_t rng = 0x9E3779B9U;
+
+    (void)arg;
+
+    while (produced < n_items)
+    {
+        produce_step(&rng);
+
+        if ((xorshift(&rng) & 3U) == 0U)
+        {
+            sched_yield();
+        }
+        else
+        {
+            spin(xorshift(&rng) & 255U);       /* idle between bursts */
+        }
+    }
+    SPSC_DMB();                                /* last push before done */
+    done = 1U;
+
+    return 0;
+}
+
+static void on_sigusr1(int sig)
+{
+    (void)sig;
+
+    if (produced < n_items)
+    {
+        produce_step(&signal_rng);
+    }
+}
+
+static void *interrupter_main(void *arg)
+{
+    uint32_t rng = 0xC0FFEE11U;
+
+    (void)arg;
+
+    while (produced < n_items)
+    {
+        pthread_kill(consumer_thread, SIGUSR1);
+        sched_yield();
+        spin(xorshift(&rng) & 255U);
+    }
+    done = 1U;
+
+    return 0;
+}
+
+   /*--------------------------------------------------
+    * One run. queue_drops: the queue counts its own
+    * drops (typed push); otherwise the producer
+    * counted what it could not hand over in lost.
+    * The consumer now and then stalls, like a main
+    * loop busy printing, so the queue fills up.
+    *-------------------------------------------------*/
+static void run(const char *name, test_mode_t mode, step_fn_t produce,
+                uint32_t (*consume)(uint32_t *), const spsc_idx_t *idx,
+                uint32_t queue_drops)
+{
+    uint32_t rng = 0x2545F491U;
+    uint32_t last = 0xFFFFFFFFU;
+    uint32_t received = 0U;
+    uint32_t dropped;
+    pthread_t t;
+
+    produce_step = produce;
+    consume_step = consume;
+    produced = 0U;
+    lost = 0U;
+    done = 0U;
+    consumer_thread = pthread_self();
+
+    pthread_create(&t, 0, (mode == MODE_THREADS) ? producer_main : interrupter_main, 0);
+
+    for (;;)
+    {
+        uint32_t fin = done;
+
+        SPSC_DMB();
+        if (consume_step(&last))
+        {
+            received++;
+            if ((xorshift(&rng) & 1023U) == 0U)
+            {
+                spin(1U << 21);                /* busy main loop, a few ms */
+            }
+        }
+        else if (fin)
+        {
+            break;                             /* empty after the producer finished */
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    pthread_join(t, 0);
+
+    dropped = queue_drops ? idx->dropped : lost;
+
+    printf("%-6s %-8s produced=%u received=%u dropped=%u high_water=%u\n",
+           name, (mode == MODE_THREADS) ? "threads" : "preempt",
+           produced, received, dropped, idx->high_water);
+
+    if (produce == bytes_produce_retry)
+    {
+        /* nothing lost, dropped counts bytes that had to be retried */
+        if ((received != produced) || (idx->dropped != lost))
+        {
+            fail("bytes accounting", received, idx->dropped);
+        }
+    }
+    else if ((received + dropped) != produced)
+    {
+        fail("accounting", received, dropped);
+    }
+}
+
+static void reset_queues(void)
+{
+    uint32_t i;
+
+    memset(&mq, 0, sizeof(mq));
+    spsc_bytes_init(&bq, bq_buf, sizeof(bq_buf));
+    memset(&full_q, 0, sizeof(full_q));
+    memset(&free_q, 0, sizeof(free_q));
+
+    for (i = 0U; i < SPSC_PTR_LEN; i++)
+    {
+        void *p = blocks[i];
+
+        (void)spsc_ptr_push(&free_q, &p);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct sigaction sa;
+    test_mode_t mode;
+
+    if (argc > 1)
+    {
+        n_items = (uint32_t)strtoul(argv[1], 0, 0);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigusr1;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, 0);
+
+    for (mode = MODE_THREADS; mode <= MODE_PREEMPT; mode++)
+    {
+        reset_queues();
+        run("msg", mode, msg_produce, msg_consume, &mq.idx, 1U);
+
+        reset_queues();
+        run("bytes", mode,
+            (mode == MODE_THREADS) ? bytes_produce_retry : bytes_produce_whole,
+            bytes_consume, &bq.idx, 0U);
+
+        reset_queues();
+        run("ptr", mode, ptr_produce, ptr_consume, &full_q.idx, 0U);
+    }
+
+    printf(failures ? "FAILED (%u)\n" : "ok\n", failures);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "twheel.h"
+
+   /*--------------------------------------------------
+    * Host benchmark for common/twheel
+    *
+    * For each timer count:
+    *   arm      N timers, random delays over all four
+    *            levels (1 .. 2^20 ticks)
+    *   cancel   every second one
+    *   drain    the rest, driven like TWHEEL/: jump to
+    *            now + twheel_next(), advance, dispatch
+    *   churn    every callback re-arms its timer with
+    *            1 .. 5000 ticks, exact and coalesced to
+    *            16 ticks: fires and wake-ups per run
+    *
+    * ns per operation should stay flat as N grows
+    * (O(1) arm / cancel / expiry); drain also pays
+    * for the empty 64-tick boundaries it wakes at.
+    * Every callback checks that it runs on its expiry
+    * tick; a late or early one is a failure, as is a
+    * timer that never fires.
+    *
+    *   ./twheel_bench [timers ...]
+    *-------------------------------------------------*/
+
+#define DRAIN_SPAN   (1U << 20)
+#define CHURN_SPAN   5000U
+#define CHURN_TICKS  200000U
+#define GRANULE      16U
+
+typedef struct
+{
+    twheel_timer_t t;
+    uint32_t       fires;
+} bench_timer_t;
+
+static twheel_t wheel;
+static uint32_t rng = 1U;
+static uint32_t failures = 0U;
+static uint32_t rearm_granule = 0U;            /* churn: 0 = no re-arm */
+
+static uint32_t rand_u32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+
+    return rng;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+static void fail(const char *what, uint32_t a, uint32_t b)
+{
+    if (failures < 10U)
+    {
+        printf("  FAIL %s (%u, %u)\n", what, a, b);
+    }
+    failures++;
+}
+
+static void bench_fn(twheel_timer_t *t, void *ctx)
+{
+    bench_timer_t *b = (bench_timer_t *)t;
+
+    (void)ctx;
+
+    if (t->expires != wheel.now)
+    {
+        fail((int32_t)(wheel.now - t->expires) > 0 ? "late" : "early",
+             t->expires, wheel.now);
+    }
+    b->fires++;
+
+    if (rearm_granule != 0U)
+    {
+        twheel_arm_coalesced(&wheel, t, 1U + (rand_u32() % CHURN_SPAN), rearm_granule);
+    }
+}
+
+   /*--------------------------------------------------
+    * Tickless driver: sleep until twheel_next(), run
+    * what expired. Returns the wake-ups.
+    *-------------------------------------------------*/
+static uint32_t drive(uint32_t until)
+{
+    uint32_t wakeups = 0U;
+
+    while ((int32_t)(until - wheel.now) > 0)
+    {
+        uint32_t next = twheel_next(&wheel);
+        uint32_t target;
+
+        if (next == TWHEEL_IDLE)
+        {
+            break;
+        }
+
+        target = wheel.now + next;
+        if ((int32_t)(target - until) > 0)
+        {
+            target = until;
+        }
+
+        (void)twheel_advance(&wheel, target);
+        (void)twheel_dispatch(&wheel);
+        wakeups++;
+    }
+
+    return wakeups;
+}
+
+   /*--------------------------------------------------
+    * twheel_next() must stop at a 64-tick boundary
+    * while a higher level may cascade earlier timers
+    *-------------------------------------------------*/
+static void check_next(void)
+{
+    bench_timer_t a = { 0 };
+    bench_timer_t b = { 0 };
+
+    twheel_init(&wheel, 0U);
+    twheel_timer_init(&a.t, bench_fn, 0);
+    twheel_timer_init(&b.t, bench_fn, 0);
+
+    twheel_arm(&wheel, &a.t, 65U);             /* level 1 */
+    (void)twheel_advance(&wheel, 10U);
+    twheel_arm(&wheel, &b.t, 60U);             /* level 0, due at 70 */
+
+    (void)drive(100U);
+
+    if ((a.fires != 1U) || (b.fires != 1U))
+    {
+        fail("next: fires", a.fires, b.fires);
+    }
+}
+
+static void bench(uint32_t n)
+{
+    bench_timer_t *timers = calloc(n, sizeof(*timers));
+    uint32_t wakeups[2];
+    uint32_t fires[2];
+    uint32_t armed;
+    uint32_t fired;
+    uint32_t g;
+    uint32_t i;
+    double t0;
+    double t_arm;
+    double t_cancel;
+    double t_drain;
+
+    if (timers == 0)
+    {
+        printf("out of memory\n");
+        exit(1);
+    }
+
+    twheel_init(&wheel, 0U);
+    rearm_granule = 0U;
+
+    for (i = 0U; i < n; i++)
+    {
+        twheel_timer_init(&timers[i].t, bench_fn, 0);
+    }
+
+    t0 = now_ns();
+    for (i = 0U; i < n; i++)
+    {
+        twheel_arm(&wheel, &timers[i].t, 1U + (rand_u32() % DRAIN_SPAN));
+    }
+    t_arm = now_ns() - t0;
+
+    t0 = now_ns();
+    for (i = 0U; i < n; i += 2U)
+    {
+        twheel_cancel(&wheel, &timers[i].t);
+    }
+    t_cancel = now_ns() - t0;
+
+    armed = wheel.armed;
+
+    t0 = now_ns();
+    (void)drive(DRAIN_SPAN + 1U);
+    t_drain = now_ns() - t0;
+
+    fired = 0U;
+    for (i = 0U; i < n; i++)
+    {
+        fired += timers[i].fires;
+        if (timers[i].fires != (i & 1U))
+        {
+            fail("drain: fires", i, timers[i].fires);
+        }
+    }
+
+    printf("%8u timers  arm %.1f ns  cancel %.1f ns  drain %.1f ns/fire  (%u fired)\n",
+           n, t_arm / (double)n, t_cancel / (double)((n + 1U) / 2U),
+           t_drain / (double)(fired ? fired : 1U), fired);
+
+    if (fired != armed)
+    {
+        fail("drain: fired != armed", fired, armed);
+    }
+
+    for (g = 0U; g < 2U; g++)
+    {
+        twheel_init(&wheel, 0U);
+        rearm_granule = (g == 0U) ? 1U : GRANULE;
+        fires[g] = 0U;
+
+        for (i = 0U; i < n; i++)
+        {
+            twheel_timer_init(&timers[i].t, bench_fn, 0);
+            timers[i].fires = 0U;
+            twheel_arm_coalesced(&wheel, &timers[i].t, 1U + (rand_u32() % CHURN_SPAN),
+                                 rearm_granule);
+        }
+
+        t0 = now_ns();
+        wakeups[g] = drive(CHURN_TICKS);
+        t0 = now_ns() - t0;
+
+        for (i = 0U; i < n; i++)
+        {
+            fires[g] += timers[i].fires;
+        }
+
+        printf("%8u timers  churn %-9s fires=%u wakeups=%u  %.1f ns/fire\n",
+               n, (g == 0U) ? "exact" : "coalesced", fires[g], wakeups[g],
+               t0 / (double)fires[g]);
+    }
+
+    free(timers);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t sizes[] = { 10000U, 100000U };
+    int i;
+
+    check_next();
+
+    if (argc > 1)
+    {
+        for (i = 1; i < argc; i++)
+        {
+            bench((uint32_t)strtoul(argv[i], 0, 0));
+        }
+    }
+    else
+    {
+        for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+        {
+            bench(sizes[i]);
+        }
+    }
+
+    printf(failures ? "FAILED (%u)\n" : "ok\n", failures);
+
+    return failures ? 1 : 0;
+}
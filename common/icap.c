@@ -0,0 +1,383 @@
+#include "icap.h"
+
+#define DBA_CCR1  (0x34U / 4U)                 /* DCR base: CCR1, word offset */
+
+   /*--------------------------------------------------
+    * DMA request of a capture channel (RM0368 tables
+    * 27/28). TIM4 CH4 has no DMA request.
+    *-------------------------------------------------*/
+static int dma_req(TIM_TypeDef *tim, uint32_t ch, dma_request_t *req)
+{
+    static const dma_request_t tim1[4] =
+        { DMA_REQ_TIM1_CH1, DMA_REQ_TIM1_CH2, DMA_REQ_TIM1_CH3, DMA_REQ_TIM1_CH4 };
+    static const dma_request_t tim2[4] =
+        { DMA_REQ_TIM2_CH1, DMA_REQ_TIM2_CH2, DMA_REQ_TIM2_CH3, DMA_REQ_TIM2_CH4 };
+    static const dma_request_t tim3[4] =
+        { DMA_REQ_TIM3_CH1, DMA_REQ_TIM3_CH2, DMA_REQ_TIM3_CH3, DMA_REQ_TIM3_CH4 };
+    static const dma_request_t tim5[4] =
+        { DMA_REQ_TIM5_CH1, DMA_REQ_TIM5_CH2, DMA_REQ_TIM5_CH3, DMA_REQ_TIM5_CH4 };
+    static const dma_request_t tim4[3] =
+        { DMA_REQ_TIM4_CH1, DMA_REQ_TIM4_CH2, DMA_REQ_TIM4_CH3 };
+
+    if      (tim == TIM1) { *req = tim1[ch - 1U]; }
+    else if (tim == TIM2) { *req = tim2[ch - 1U]; }
+    else if (tim == TIM3) { *req = tim3[ch - 1U]; }
+    else if (tim == TIM5) { *req = tim5[ch - 1U]; }
+    else if ((tim == TIM4) && (ch <= 3U)) { *req = tim4[ch - 1U]; }
+    else
+    {
+        return ICAP_ERR_CONFIG;
+    }
+
+    return ICAP_OK;
+}
+
+static int tim_clock(TIM_TypeDef *tim)
+{
+    if      (tim == TIM1) { RCC->APB2ENR |= RCC_APB2ENR_TIM1EN; }
+    else if (tim == TIM2) { RCC->APB1ENR |= RCC_APB1ENR_TIM2EN; }
+    else if (tim == TIM3) { RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; }
+    else if (tim == TIM4) { RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; }
+    else if (tim == TIM5) { RCC->APB1ENR |= RCC_APB1ENR_TIM5EN; }
+    else
+    {
+        return ICAP_ERR_CONFIG;
+    }
+
+    return ICAP_OK;
+}
+
+   /*--------------------------------------------------
+    * Input channel ch: CCxS = sel (1 = own TIx,
+    * 2 = TI of the other channel of the pair), ICxF,
+    * ICxPSC and the edge in CCxP / CCxNP
+    *-------------------------------------------------*/
+static void ic_channel(TIM_TypeDef *tim, uint32_t ch, uint32_t sel,
+                       uint32_t filter, uint32_t psc, icap_edge_t edge)
+{
+    volatile uint32_t *ccmr = (ch <= 2U) ? &tim->CCMR1 : &tim->CCMR2;
+    uint32_t shift = ((ch - 1U) & 1U) * 8U;
+    uint32_t pol = 0U;
+
+    if (edge == ICAP_EDGE_FALLING)
+    {
+        pol = TIM_CCER_CC1P;
+    }
+    else if (edge == ICAP_EDGE_BOTH)
+    {
+        pol = TIM_CCER_CC1P | TIM_CCER_CC1NP;
+    }
+
+    *ccmr = (*ccmr & ~(0xFFUL << shift)) | (((filter << 4U) | (psc << 2U) | sel) << shift);
+
+    tim->CCER = (tim->CCER & ~(0xFUL << (4U * (ch - 1U)))) |
+                ((pol | TIM_CCER_CC1E) << (4U * (ch - 1U)));
+}
+
+static void icap_dma_evt(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    icap_t *ic = (icap_t *)ctx;
+
+    (void)s;
+
+    if (events & DMA_EVT_HT)
+    {
+        ic->halves++;
+    }
+    if (events & DMA_EVT_TC)
+    {
+        ic->halves++;
+    }
+}
+
+int icap_init(icap_t *ic, const icap_cfg_t *cfg)
+{
+    TIM_TypeDef *tim = cfg->tim;
+    uint32_t ch = cfg->channel;
+    dma_request_t req;
+
+   /*--------------------------------------------------
+    * Check the configuration
+    *-------------------------------------------------*/
+    if ((ch < 1U) || (ch > 4U) || (cfg->buf == 0) || (cfg->len < 2U) ||
+        (cfg->filter > 15U) || (cfg->ic_prescaler > 3U) || (cfg->hist_step == 0U))
+    {
+        return ICAP_ERR_CONFIG;
+    }
+
+    if ((cfg->mode == ICAP_MODE_PWM) &&
+        ((ch > 2U) || (cfg->edge == ICAP_EDGE_BOTH) || (cfg->len & 1U)))
+    {
+        return ICAP_ERR_CONFIG;
+    }
+
+    if ((dma_req(tim, ch, &req) != ICAP_OK) || (tim_clock(tim) != ICAP_OK))
+    {
+        return ICAP_ERR_CONFIG;
+    }
+
+    ic->dma = dma_alloc(req);
+    if (ic->dma == 0)
+    {
+        return ICAP_ERR_DMA;
+    }
+
+    ic->cfg = *cfg;
+    ic->clk_hz = SystemCoreClock / ((uint32_t)cfg->psc + 1U);
+    ic->mask = ((tim == TIM2) || (tim == TIM5)) ? 0xFFFFFFFFU : 0xFFFFU;
+    ic->swapped = 0U;
+    ic->overruns = 0U;
+
+   /*--------------------------------------------------
+    * Time base: free running over the full counter
+    *-------------------------------------------------*/
+    tim->CR1 = 0U;
+    tim->SMCR = 0U;
+    tim->DIER = 0U;
+    tim->CCER = 0U;
+    tim->PSC = cfg->psc;
+    tim->ARR = ic->mask;
+
+   /*--------------------------------------------------
+    * Channels
+    *-------------------------------------------------*/
+    if (cfg->mode == ICAP_MODE_PWM)
+    {
+        uint32_t other = (ch == 1U) ? 2U : 1U;
+        icap_edge_t back = (cfg->edge == ICAP_EDGE_RISING) ? ICAP_EDGE_FALLING : ICAP_EDGE_RISING;
+
+        ic_channel(tim, ch, 1U, cfg->filter, 0U, cfg->edge);
+        ic_channel(tim, other, 2U, cfg->filter, 0U, back);
+
+        /* reset mode, trigger TI1FP1 (101) or TI2FP2 (110) */
+        tim->SMCR = (((ch == 1U) ? 5U : 6U) << TIM_SMCR_TS_Pos) | (4U << TIM_SMCR_SMS_Pos);
+
+        /* each request: 2 transfers from DMAR, CCR1 then CCR2 */
+        tim->DCR = (1U << TIM_DCR_DBL_Pos) | (DBA_CCR1 << TIM_DCR_DBA_Pos);
+
+        ic->swapped = (ch == 2U) ? 1U : 0U;
+    }
+    else
+    {
+        ic_channel(tim, ch, 1U, cfg->filter, cfg->ic_prescaler, cfg->edge);
+    }
+
+   /*--------------------------------------------------
+    * DMA ring: CCRx (or DMAR) to buf, circular
+    *-------------------------------------------------*/
+    {
+        dma_desc_t desc =
+        {
+            .dir      = DMA_DIR_P2M,
+            .psize    = DMA_WIDTH_32,
+            .msize    = DMA_WIDTH_32,
+            .minc     = 1U,
+            .circular = 1U,
+            .prio     = DMA_PRIO_HIGH,
+            .periph   = (cfg->mode == ICAP_MODE_PWM) ? (uint32_t)&tim->DMAR
+                                                     : (uint32_t)(&tim->CCR1 + (ch - 1U)),
+            .mem0     = (uint32_t)cfg->buf,
+            .count    = cfg->len,
+            .events   = DMA_EVT_HT | DMA_EVT_TC,
+            .callback = icap_dma_evt,
+            .ctx      = ic,
+        };
+
+        if (dma_config(ic->dma, &desc) != DMA_OK)
+        {
+            dma_free(ic->dma);
+            ic->dma = 0;
+            return ICAP_ERR_CONFIG;
+        }
+    }
+
+    return ICAP_OK;
+}
+
+void icap_start(icap_t *ic)
+{
+    TIM_TypeDef *tim = ic->cfg.tim;
+
+    ic->tail = 0U;
+    ic->have_last = 0U;
+    ic->halves = 0U;
+    ic->halves_seen = 0U;
+
+    dma_start(ic->dma);
+
+    tim->EGR = TIM_EGR_UG;                     /* load PSC, CNT = 0 */
+    tim->SR = 0U;
+    tim->DIER = TIM_DIER_CC1DE << (ic->cfg.channel - 1U);
+    tim->CR1 |= TIM_CR1_CEN;
+}
+
+void icap_stop(icap_t *ic)
+{
+    TIM_TypeDef *tim = ic->cfg.tim;
+
+    tim->CR1 &= ~TIM_CR1_CEN;
+    tim->DIER = 0U;
+    dma_stop(ic->dma);
+}
+
+void icap_stats_reset(icap_stats_t *st)
+{
+    uint32_t i;
+
+    st->count = 0U;
+    st->period_min = 0xFFFFFFFFU;
+    st->period_max = 0U;
+    st->period_sum = 0U;
+    st->high_sum = 0U;
+
+    for (i = 0U; i < ICAP_HIST_BINS; i++)
+    {
+        st->hist[i] = 0U;
+    }
+}
+
+static void stats_add(const icap_cfg_t *cfg, icap_stats_t *st, uint32_t period, uint32_t high)
+{
+    uint32_t bin = 0U;
+
+    if (period > cfg->hist_min)
+    {
+        bin = (period - cfg->hist_min) / cfg->hist_step;
+        if (bin >= ICAP_HIST_BINS)
+        {
+            bin = ICAP_HIST_BINS - 1U;
+        }
+    }
+
+    st->count++;
+    st->period_sum += period;
+    st->high_sum += high;
+    st->hist[bin]++;
+
+    if (period < st->period_min)
+    {
+        st->period_min = period;
+    }
+    if (period > st->period_max)
+    {
+        st->period_max = period;
+    }
+}
+
+   /*--------------------------------------------------
+    * Fold every capture between tail and the DMA write
+    * position into st. If a full ring or more has been
+    * written since the last call, the unread captures
+    * are gone: count an overrun and restart at the
+    * write position.
+    *
+    * Three or more half events: always a full ring.
+    * Exactly two: the DMA moved more than half a ring;
+    * it either stopped short of tail (more than half a
+    * ring unread) or went past it and left at most
+    * half a ring between tail and head.
+    *-------------------------------------------------*/
+uint32_t icap_batch(icap_t *ic, icap_stats_t *st)
+{
+    const icap_cfg_t *cfg = &ic->cfg;
+    uint32_t len = cfg->len;
+    uint32_t head;
+    uint32_t halves;
+    uint32_t unread;
+    uint32_t n = 0U;
+
+    /* a half event between the two reads would skew the test below */
+    do
+    {
+        halves = ic->halves;
+        head = len - dma_remaining(ic->dma);
+    } while (halves != ic->halves);
+
+    if (head >= len)
+    {
+        head = 0U;
+    }
+
+    if (cfg->mode == ICAP_MODE_PWM)
+    {
+        head &= ~1U;                           /* pair still being written */
+    }
+
+    unread = (head >= ic->tail) ? (head - ic->tail) : (head + len - ic->tail);
+
+    if (((halves - ic->halves_seen) > 2U) ||
+        (((halves - ic->halves_seen) == 2U) && (unread <= (len / 2U))))
+    {
+        ic->overruns++;
+        ic->tail = head;
+        ic->have_last = 0U;
+    }
+    ic->halves_seen = halves;
+
+    while (ic->tail != head)
+    {
+        if (cfg->mode == ICAP_MODE_PWM)
+        {
+            uint32_t a = cfg->buf[ic->tail];
+            uint32_t b = cfg->buf[ic->tail + 1U];
+
+            ic->tail += 2U;
+
+            /* the first pair measures from icap_start(), not an edge */
+            if (ic->have_last)
+            {
+                stats_add(cfg, st, ic->swapped ? b : a, ic->swapped ? a : b);
+                n++;
+            }
+            ic->have_last = 1U;
+        }
+        else
+        {
+            uint32_t v = cfg->buf[ic->tail];
+
+            ic->tail++;
+
+            if (ic->have_last)
+            {
+                stats_add(cfg, st, (v - ic->last) & ic->mask, 0U);
+                n++;
+            }
+            ic->last = v;
+            ic->have_last = 1U;
+        }
+
+        if (ic->tail >= len)
+        {
+            ic->tail = 0U;
+        }
+    }
+
+    return n;
+}
+
+uint32_t icap_freq_hz(const icap_t *ic, const icap_stats_t *st)
+{
+    uint64_t edges = (uint64_t)st->count << ic->cfg.ic_prescaler;
+
+    if (st->period_sum == 0U)
+    {
+        return 0U;
+    }
+
+    if (ic->cfg.mode == ICAP_MODE_PWM)
+    {
+        edges = st->count;                     /* no IC prescaler in PWM mode */
+    }
+
+    return (uint32_t)((edges * ic->clk_hz) / st->period_sum);
+}
+
+uint32_t icap_duty_permille(const icap_stats_t *st)
+{
+    if (st->period_sum == 0U)
+    {
+        return 0U;
+    }
+
+    return (uint32_t)((st->high_sum * 1000U) / st->period_sum);
+}
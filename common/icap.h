@@ -0,0 +1,107 @@
+#ifndef ICAP_H
+#define ICAP_H
+
+#include "stm32f4xx.h"
+#include "dma.h"
+
+   /*--------------------------------------------------
+    * Timer input capture into DMA ring buffers
+    *
+    * Every captured edge is moved to RAM by DMA, the
+    * CPU takes no interrupt per edge. The ring is
+    * circular; icap_batch() walks whatever arrived
+    * since the last call and folds it into statistics
+    * (count, min / max / sum of the period, high time,
+    * period histogram). Only the half / full ring DMA
+    * events interrupt, to detect a consumer that fell
+    * a full ring or more behind.
+    *
+    * ICAP_MODE_PERIOD: one channel captures the free
+    * running counter, the period is the difference of
+    * two captures. The IC prescaler (1/2/4/8) captures
+    * every n-th edge only, for input rates the DMA
+    * could not follow edge by edge.
+    *
+    * ICAP_MODE_PWM: PWM input. The pin feeds both
+    * channels of a pair (CH1/CH2), one capturing the
+    * rising, the other the falling edge, and the slave
+    * controller resets the counter on every rising
+    * edge. At each rising edge a DMA burst (DCR/DMAR)
+    * copies CCR1 and CCR2 as one pair, so period and
+    * high time stay together without a second stream.
+    *
+    * TIM1..TIM5, channel 1..4 (1..2 for PWM mode). The
+    * driver does not touch GPIO: set the pin to the
+    * timer's alternate function before icap_start().
+    *-------------------------------------------------*/
+
+#define ICAP_HIST_BINS     16U
+
+#define ICAP_OK             0
+#define ICAP_ERR_CONFIG    -1                  /* timer / channel / buffer not usable */
+#define ICAP_ERR_DMA       -2                  /* no free DMA stream for the request */
+
+typedef enum
+{
+    ICAP_MODE_PERIOD = 0,
+    ICAP_MODE_PWM
+} icap_mode_t;
+
+typedef enum
+{
+    ICAP_EDGE_RISING = 0,
+    ICAP_EDGE_FALLING,
+    ICAP_EDGE_BOTH                             /* PERIOD mode only */
+} icap_edge_t;
+
+typedef struct
+{
+    TIM_TypeDef *tim;
+    uint8_t      channel;                      /* input pin: TIx, 1..4 */
+    icap_mode_t  mode;
+    icap_edge_t  edge;                         /* edge that starts a period */
+    uint8_t      filter;                       /* ICxF, 0..15 */
+    uint8_t      ic_prescaler;                 /* ICxPSC: 0..3 = every 1/2/4/8 edges */
+    uint16_t     psc;                          /* timer clock = SystemCoreClock / (psc + 1) */
+    uint32_t    *buf;                          /* DMA ring */
+    uint16_t     len;                          /* words, even in PWM mode */
+    uint32_t     hist_min;                     /* period of bin 0, ticks */
+    uint32_t     hist_step;                    /* ticks per bin */
+} icap_cfg_t;
+
+typedef struct
+{
+    uint32_t count;                            /* periods */
+    uint32_t period_min;                       /* ticks */
+    uint32_t period_max;
+    uint64_t period_sum;
+    uint64_t high_sum;                         /* PWM mode only */
+    uint32_t hist[ICAP_HIST_BINS];             /* first / last bin also count outliers */
+} icap_stats_t;
+
+typedef struct
+{
+    icap_cfg_t        cfg;
+    dma_stream_t     *dma;
+    uint32_t          clk_hz;                  /* timer tick rate */
+    uint32_t          mask;                    /* counter width */
+    uint32_t          tail;                    /* next word to read */
+    uint32_t          last;                    /* PERIOD: previous capture */
+    uint8_t           have_last;
+    uint8_t           swapped;                 /* PWM on TI2: CCR2 is the period */
+    volatile uint32_t halves;                  /* HT + TC events */
+    uint32_t          halves_seen;
+    uint32_t          overruns;
+} icap_t;
+
+int  icap_init(icap_t *ic, const icap_cfg_t *cfg);
+void icap_start(icap_t *ic);
+void icap_stop(icap_t *ic);
+
+void     icap_stats_reset(icap_stats_t *st);
+uint32_t icap_batch(icap_t *ic, icap_stats_t *st);   /* returns periods added */
+
+uint32_t icap_freq_hz(const icap_t *ic, const icap_stats_t *st);   /* mean */
+uint32_t icap_duty_permille(const icap_stats_t *st);               /* PWM mode */
+
+#endif /* ICAP_H */
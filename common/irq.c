@@ -0,0 +1,278 @@
+#include "irq.h"
+
+#define IRQ_VECTORS   (16U + (uint32_t)SPI4_IRQn + 1U)
+#define NO_SLOT       0xFFU
+
+typedef void (*vector_t)(void);
+
+typedef struct
+{
+    vector_t    handler;                       /* original */
+    uint32_t    budget;
+    irq_stats_t stats;
+} irq_slot_t;
+
+   /* VTOR wants the table aligned to its size rounded up to 2^n: 404 -> 512 */
+static vector_t ram_vectors[IRQ_VECTORS] __attribute__((aligned(512)));
+
+static const vector_t *orig_vectors = 0;   /* table VTOR pointed at before */
+static uint8_t slot_of[IRQ_VECTORS];
+static irq_slot_t slots[IRQ_MEASURED_MAX];
+static uint32_t n_slots = 0U;
+
+static volatile uint32_t nested = 0U;          /* cycles of finished inner handlers */
+static volatile uint32_t overruns = 0U;
+static const irq_stats_t *volatile last_over = 0;
+
+   /*--------------------------------------------------
+    * Installed in place of every measured handler.
+    * nested grows by the full time of each handler
+    * that returns; what grew while this one ran
+    * belongs to the handlers that preempted it.
+    *-------------------------------------------------*/
+static void irq_measure(void)
+{
+    irq_slot_t *s = &slots[slot_of[__get_IPSR() & 0x1FFU]];
+    uint32_t saved = nested;
+    uint32_t t0 = DWT->CYCCNT;
+    uint32_t elapsed;
+    uint32_t self;
+
+    s->handler();
+
+    elapsed = DWT->CYCCNT - t0;
+    self = elapsed - (nested - saved);
+    nested = saved + elapsed;
+
+    s->stats.count++;
+    s->stats.total_cycles += self;
+    if (self > s->stats.max_cycles)
+    {
+        s->stats.max_cycles = self;
+    }
+    if (self > s->budget)
+    {
+        s->stats.over++;
+        overruns++;
+        last_over = &s->stats;
+    }
+}
+
+static int find(const irq_table_t *t, IRQn_Type irqn)
+{
+    uint32_t i;
+
+    for (i = 0U; i < t->n_irqs; i++)
+    {
+        if (t->irqs[i].irqn == irqn)
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+static int validate(const irq_table_t *t, uint32_t *bad)
+{
+    uint32_t sub_bits;
+    uint32_t budgets = 0U;
+    uint32_t i;
+
+    if (t->preempt_bits > __NVIC_PRIO_BITS)
+    {
+        *bad = 0U;
+        return IRQ_ERR_RANGE;
+    }
+    sub_bits = __NVIC_PRIO_BITS - t->preempt_bits;
+
+    for (i = 0U; i < t->n_irqs; i++)
+    {
+        const irq_cfg_t *c = &t->irqs[i];
+
+        *bad = i;
+
+        if (((int32_t)c->irqn < (int32_t)SVCall_IRQn) || ((int32_t)c->irqn > (int32_t)SPI4_IRQn) ||
+            ((uint32_t)c->preempt >= (1UL << t->preempt_bits)) ||
+            ((uint32_t)c->sub >= (1UL << sub_bits)))
+        {
+            return IRQ_ERR_RANGE;
+        }
+
+        if (find(t, c->irqn) != (int)i)
+        {
+            return IRQ_ERR_DUP;
+        }
+
+        if (c->budget_cycles != 0U)
+        {
+            /* only plain C handlers: device IRQs and SysTick */
+            if (((int32_t)c->irqn < 0) && (c->irqn != SysTick_IRQn))
+            {
+                return IRQ_ERR_RANGE;
+            }
+            if (++budgets > IRQ_MEASURED_MAX)
+            {
+                return IRQ_ERR_FULL;
+            }
+        }
+    }
+
+    for (i = 0U; i < t->n_rules; i++)
+    {
+        int hi = find(t, t->rules[i].hi);
+        int lo = find(t, t->rules[i].lo);
+
+        *bad = i;
+
+        if ((hi < 0) || (lo < 0) || (t->irqs[hi].preempt >= t->irqs[lo].preempt))
+        {
+            return IRQ_ERR_ORDER;
+        }
+    }
+
+    return IRQ_OK;
+}
+
+   /*--------------------------------------------------
+    * Copy the active vector table to RAM once and
+    * point VTOR at it
+    *-------------------------------------------------*/
+static void vectors_to_ram(void)
+{
+    uint32_t i;
+
+    if (orig_vectors != 0)
+    {
+        return;
+    }
+
+    orig_vectors = (const vector_t *)SCB->VTOR;
+
+    for (i = 0U; i < IRQ_VECTORS; i++)
+    {
+        ram_vectors[i] = orig_vectors[i];
+    }
+
+    __DSB();
+    SCB->VTOR = (uint32_t)ram_vectors;
+    __DSB();
+    __ISB();
+}
+
+int irq_setup(const irq_table_t *t, uint32_t *bad)
+{
+    uint32_t group = 7U - t->preempt_bits;     /* PRIGROUP, PM0214 4.4.5 */
+    uint32_t where = 0U;
+    uint32_t primask;
+    uint32_t i;
+    int err;
+
+    err = validate(t, &where);
+    if (err != IRQ_OK)
+    {
+        if (bad != 0)
+        {
+            *bad = where;
+        }
+        return err;
+    }
+
+    NVIC_SetPriorityGrouping(group);
+
+    for (i = 0U; i < t->n_irqs; i++)
+    {
+        const irq_cfg_t *c = &t->irqs[i];
+
+        NVIC_SetPriority(c->irqn, NVIC_EncodePriority(group, c->preempt, c->sub));
+    }
+
+   /*--------------------------------------------------
+    * Budgets: swap in the wrapper with IRQs masked,
+    * so no half-installed entry is ever taken
+    *-------------------------------------------------*/
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (i = 0U; i < IRQ_VECTORS; i++)
+    {
+        slot_of[i] = NO_SLOT;
+        if ((orig_vectors != 0) && (ram_vectors[i] == irq_measure))
+        {
+            ram_vectors[i] = orig_vectors[i];  /* from an earlier table */
+        }
+    }
+    n_slots = 0U;
+
+    for (i = 0U; i < t->n_irqs; i++)
+    {
+        const irq_cfg_t *c = &t->irqs[i];
+        uint32_t vec = (uint32_t)((int32_t)c->irqn + 16);
+        irq_slot_t *s;
+
+        if (c->budget_cycles == 0U)
+        {
+            continue;
+        }
+
+        if (n_slots == 0U)
+        {
+            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+            vectors_to_ram();
+        }
+
+        s = &slots[n_slots];
+        s->handler = orig_vectors[vec];
+        s->budget = c->budget_cycles;
+        s->stats.cfg = c;
+        slot_of[vec] = (uint8_t)n_slots;
+        ram_vectors[vec] = irq_measure;
+        n_slots++;
+    }
+
+    irq_stats_reset();
+
+    __DSB();
+    __set_PRIMASK(primask);
+
+    return IRQ_OK;
+}
+
+const irq_stats_t *irq_stats(IRQn_Type irqn)
+{
+    int32_t vec = (int32_t)irqn + 16;
+
+    if ((vec < 0) || ((uint32_t)vec >= IRQ_VECTORS) || (slot_of[vec] == NO_SLOT) || (n_slots == 0U))
+    {
+        return 0;
+    }
+
+    return &slots[slot_of[vec]].stats;
+}
+
+uint32_t irq_overruns(void)
+{
+    return overruns;
+}
+
+const irq_stats_t *irq_last_overrun(void)
+{
+    return last_over;
+}
+
+void irq_stats_reset(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < n_slots; i++)
+    {
+        slots[i].stats.count = 0U;
+        slots[i].stats.max_cycles = 0U;
+        slots[i].stats.total_cycles = 0U;
+        slots[i].stats.over = 0U;
+    }
+
+    overruns = 0U;
+    last_over = 0;
+}
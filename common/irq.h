@@ -0,0 +1,88 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Central interrupt priority table and per-IRQ
+    * time-in-handler budgets
+    *
+    * One table per project names every interrupt it
+    * uses with a preemption priority, a sub-priority
+    * and optionally a cycle budget. irq_setup() checks
+    * the whole table before touching the NVIC:
+    *   - preempt / sub fit the chosen PRIGROUP split
+    *     of the 4 priority bits
+    *   - no IRQ is listed twice
+    *   - every rule "hi must preempt lo" holds, i.e.
+    *     hi has a numerically lower preempt priority
+    *     (equal preempt priorities never preempt each
+    *     other, the sub-priority only orders pending
+    *     ones)
+    * then sets PRIGROUP and all priorities. Enabling
+    * an IRQ stays with its driver; irq_setup() should
+    * run first, so nothing fires at priority 0.
+    *
+    * Budgets: IRQs with budget_cycles get a wrapper
+    * in a copy of the vector table in RAM (VTOR). The
+    * wrapper reads DWT CYCCNT around the original
+    * handler and takes off the time spent in handlers
+    * that preempted it, so each IRQ is charged only
+    * its own cycles (plus about 20 for the wrapper).
+    * A run over budget is counted and remembered. The
+    * handlers stay plain C functions; handlers that
+    * work on the exception frame themselves (PendSV,
+    * SVC, faults) cannot be measured this way and
+    * are rejected.
+    *-------------------------------------------------*/
+
+#define IRQ_MEASURED_MAX  16U
+
+#define IRQ_OK            0
+#define IRQ_ERR_RANGE    -1                    /* priority / IRQ number out of range */
+#define IRQ_ERR_DUP      -2                    /* IRQ listed twice */
+#define IRQ_ERR_ORDER    -3                    /* a rule does not hold */
+#define IRQ_ERR_FULL     -4                    /* more than IRQ_MEASURED_MAX budgets */
+
+typedef struct
+{
+    IRQn_Type   irqn;
+    uint8_t     preempt;
+    uint8_t     sub;
+    uint32_t    budget_cycles;                 /* 0 = not measured */
+    const char *name;
+} irq_cfg_t;
+
+typedef struct
+{
+    IRQn_Type hi;                              /* must be able to preempt */
+    IRQn_Type lo;
+} irq_rule_t;
+
+typedef struct
+{
+    uint32_t          preempt_bits;            /* 0..4, the rest is sub-priority */
+    const irq_cfg_t  *irqs;
+    uint32_t          n_irqs;
+    const irq_rule_t *rules;
+    uint32_t          n_rules;
+} irq_table_t;
+
+typedef struct
+{
+    const irq_cfg_t *cfg;
+    uint32_t         count;
+    uint32_t         max_cycles;
+    uint32_t         total_cycles;             /* wraps */
+    uint32_t         over;                     /* runs over budget */
+} irq_stats_t;
+
+   /* bad (may be 0): index of the failing entry in irqs or rules */
+int irq_setup(const irq_table_t *t, uint32_t *bad);
+
+const irq_stats_t *irq_stats(IRQn_Type irqn);  /* 0 if not measured */
+uint32_t           irq_overruns(void);         /* all IRQs */
+const irq_stats_t *irq_last_overrun(void);     /* 0 if none yet */
+void               irq_stats_reset(void);
+
+#endif /* IRQ_H */
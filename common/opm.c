@@ -0,0 +1,194 @@
+#include "opm.h"
+
+   /*--------------------------------------------------
+    * Clock enable and capabilities per timer
+    *-------------------------------------------------*/
+static int tim_setup(opm_t *o, TIM_TypeDef *tim, uint32_t *mask,
+                     uint32_t *channels, uint32_t *slave)
+{
+    o->advanced = 0U;
+    *mask = 0xFFFFU;
+    *channels = 4U;
+    *slave = 1U;
+
+    if (tim == TIM1)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+        o->advanced = 1U;
+    }
+    else if ((tim == TIM2) || (tim == TIM5))
+    {
+        RCC->APB1ENR |= (tim == TIM2) ? RCC_APB1ENR_TIM2EN : RCC_APB1ENR_TIM5EN;
+        *mask = 0xFFFFFFFFU;
+    }
+    else if (tim == TIM3) { RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; }
+    else if (tim == TIM4) { RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; }
+    else if (tim == TIM9)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_TIM9EN;
+        *channels = 2U;
+    }
+    else if ((tim == TIM10) || (tim == TIM11))
+    {
+        RCC->APB2ENR |= (tim == TIM10) ? RCC_APB2ENR_TIM10EN : RCC_APB2ENR_TIM11EN;
+        *channels = 1U;
+        *slave = 0U;                           /* no slave controller */
+    }
+    else
+    {
+        return OPM_ERR_CONFIG;
+    }
+
+    return OPM_OK;
+}
+
+static uint32_t ns_to_ticks(const opm_t *o, uint32_t ns)
+{
+    return (uint32_t)((((uint64_t)ns * o->tick_hz) + 500000000U) / 1000000000U);
+}
+
+int opm_init(opm_t *o, const opm_cfg_t *cfg)
+{
+    TIM_TypeDef *tim = cfg->tim;
+    uint32_t ch = cfg->channel;
+    uint32_t mask;
+    uint32_t channels;
+    uint32_t slave;
+    uint32_t shift;
+    uint64_t full;
+    uint32_t psc;
+    volatile uint32_t *ccmr;
+
+    if (tim_setup(o, tim, &mask, &channels, &slave) != OPM_OK)
+    {
+        return OPM_ERR_CONFIG;
+    }
+
+    if ((ch < 1U) || (ch > channels))
+    {
+        return OPM_ERR_CONFIG;
+    }
+
+    if ((cfg->trigger != OPM_TRIG_SOFTWARE) &&
+        (!slave || ((uint32_t)cfg->trigger == ch) || ((uint32_t)cfg->trigger > channels)))
+    {
+        return OPM_ERR_CONFIG;
+    }
+
+   /*--------------------------------------------------
+    * Prescaler: smallest that fits max_ns in the
+    * counter
+    *-------------------------------------------------*/
+    full = (((uint64_t)cfg->max_ns * SystemCoreClock) + 999999999U) / 1000000000U;
+    psc = (uint32_t)(full / ((uint64_t)mask + 1U));
+    if (psc > 0xFFFFU)
+    {
+        return OPM_ERR_RANGE;
+    }
+
+    o->tim = tim;
+    o->channel = (uint8_t)ch;
+    o->tick_hz = SystemCoreClock / (psc + 1U);
+    o->max_ticks = mask;
+
+    tim->CR1 = 0U;
+    tim->SMCR = 0U;
+    tim->DIER = 0U;
+    tim->PSC = psc;
+    tim->ARR = mask;
+
+   /*--------------------------------------------------
+    * Output: PWM mode 2 with preload, so values set
+    * during a pulse apply to the next one
+    *-------------------------------------------------*/
+    ccmr = (ch <= 2U) ? &tim->CCMR1 : &tim->CCMR2;
+    shift = ((ch - 1U) & 1U) * 8U;
+    *ccmr = (*ccmr & ~(0xFFUL << shift)) |
+            (((7U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE) << shift);
+    (&tim->CCR1)[ch - 1U] = mask;              /* idle until opm_set() */
+
+    tim->CCER = (tim->CCER & ~(0xFUL << (4U * (ch - 1U)))) |
+                ((TIM_CCER_CC1E | (cfg->active_low ? TIM_CCER_CC1P : 0U)) << (4U * (ch - 1U)));
+
+   /*--------------------------------------------------
+    * Trigger input: TIx as IC, trigger mode on TIxFPx
+    *-------------------------------------------------*/
+    if (cfg->trigger != OPM_TRIG_SOFTWARE)
+    {
+        uint32_t ti = (uint32_t)cfg->trigger;
+        uint32_t ts = (ti == 1U) ? 5U : 6U;    /* TI1FP1 / TI2FP2 */
+
+        shift = (ti - 1U) * 8U;
+        tim->CCMR1 = (tim->CCMR1 & ~(0xFFUL << shift)) | (1U << shift);
+        tim->CCER = (tim->CCER & ~(0xFUL << (4U * (ti - 1U)))) |
+                    ((cfg->trig_falling ? TIM_CCER_CC1P : 0U) << (4U * (ti - 1U)));
+
+        tim->SMCR = (ts << TIM_SMCR_TS_Pos);
+        tim->SMCR |= (6U << TIM_SMCR_SMS_Pos);
+    }
+
+    tim->CR1 = TIM_CR1_OPM | TIM_CR1_ARPE;
+    tim->EGR = TIM_EGR_UG;
+    tim->SR = 0U;
+
+    if (o->advanced)
+    {
+        tim->BDTR |= TIM_BDTR_MOE;
+    }
+
+    return OPM_OK;
+}
+
+   /*--------------------------------------------------
+    * delay is at least one tick: with CCR = 0 the
+    * stopped counter (CNT = 0) would hold the output
+    * active
+    *-------------------------------------------------*/
+int opm_set(opm_t *o, uint32_t delay_ns, uint32_t width_ns)
+{
+    TIM_TypeDef *tim = o->tim;
+    uint32_t d = ns_to_ticks(o, delay_ns);
+    uint32_t w = ns_to_ticks(o, width_ns);
+
+    if (d == 0U)
+    {
+        d = 1U;
+    }
+    if (w == 0U)
+    {
+        w = 1U;
+    }
+
+    if ((w > o->max_ticks) || (d > (o->max_ticks - w)))
+    {
+        return OPM_ERR_RANGE;
+    }
+
+    (&tim->CCR1)[o->channel - 1U] = d;
+    tim->ARR = d + w - 1U;
+
+    if (!opm_busy(o))
+    {
+        tim->EGR = TIM_EGR_UG;                 /* load now, CNT stays 0 */
+        tim->SR = 0U;
+    }
+
+    return OPM_OK;
+}
+
+int opm_fire(opm_t *o)
+{
+    if (o->tim->SMCR & TIM_SMCR_SMS)
+    {
+        return OPM_ERR_CONFIG;                 /* started by the input */
+    }
+
+    if (opm_busy(o))
+    {
+        return OPM_ERR_BUSY;
+    }
+
+    o->tim->CR1 |= TIM_CR1_CEN;
+
+    return OPM_OK;
+}
@@ -0,0 +1,77 @@
+#ifndef OPM_H
+#define OPM_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Delayed pulses in timer one-pulse mode
+    *
+    * The counter runs once from 0 to ARR and stops
+    * (CR1.OPM). The output channel is in PWM mode 2,
+    * inactive below CCR and active from CCR on, so a
+    * start gives, to the timer tick:
+    *
+    *   start --- delay ---|‾‾‾ width ‾‾‾|
+    *             CCR = delay, ARR = delay + width - 1
+    *
+    * Start sources:
+    *   OPM_TRIG_SOFTWARE  opm_fire() sets CEN
+    *   OPM_TRIG_TI1/TI2   an edge on the channel 1 / 2
+    *                      input starts it in hardware
+    *                      (trigger mode): the delay is
+    *                      counted from the edge, with a
+    *                      fixed resync latency of a few
+    *                      ticks and no CPU jitter
+    * With an input trigger the output must be on the
+    * other channel of the pair (e.g. TI1 in, CH2 out),
+    * and every later edge fires again by itself.
+    *
+    * Times are in ns. The prescaler is picked from
+    * max_ns: at 16 MHz without prescaler one tick is
+    * 62.5 ns, and a 16-bit timer reaches 4 ms.
+    *
+    * Pins are not touched: set them to the timer's
+    * alternate function before opm_init().
+    *-------------------------------------------------*/
+
+#define OPM_OK           0
+#define OPM_ERR_CONFIG  -1                     /* timer / channel / trigger not usable */
+#define OPM_ERR_RANGE   -2                     /* delay + width beyond max_ns */
+#define OPM_ERR_BUSY    -3                     /* a pulse is running */
+
+typedef enum
+{
+    OPM_TRIG_SOFTWARE = 0,
+    OPM_TRIG_TI1,
+    OPM_TRIG_TI2
+} opm_trig_t;
+
+typedef struct
+{
+    TIM_TypeDef *tim;
+    uint8_t      channel;                      /* output, 1..4 */
+    uint8_t      active_low;
+    opm_trig_t   trigger;
+    uint8_t      trig_falling;                 /* input edge, TI1 / TI2 */
+    uint32_t     max_ns;                       /* longest delay + width needed */
+} opm_cfg_t;
+
+typedef struct
+{
+    TIM_TypeDef *tim;
+    uint8_t      channel;
+    uint8_t      advanced;                     /* TIM1: MOE */
+    uint32_t     tick_hz;
+    uint32_t     max_ticks;
+} opm_t;
+
+int  opm_init(opm_t *o, const opm_cfg_t *cfg);
+int  opm_set(opm_t *o, uint32_t delay_ns, uint32_t width_ns);
+int  opm_fire(opm_t *o);                       /* OPM_TRIG_SOFTWARE */
+
+static inline uint32_t opm_busy(const opm_t *o)
+{
+    return (o->tim->CR1 & TIM_CR1_CEN) ? 1U : 0U;
+}
+
+#endif /* OPM_H */
@@ -0,0 +1,649 @@
+#include "stm32f4xx.h"
+#include "os.h"
+
+#define OS_TICK_CYCLES  (OS_CPU_HZ / OS_TICK_HZ)
+#define OS_MAX_SLEEP    ((SysTick_LOAD_RELOAD_Msk + 1U) / OS_TICK_CYCLES)
+#define OS_IDLE_PRIO    (OS_MAX_THREADS - 1U)
+#define OS_STACK_FILL   0xDEADBEEFU
+
+#define BIT(p)          (1U << (p))
+
+os_thread_t *os_cur = 0;                       /* PendSV_Handler reads / writes it */
+
+static os_thread_t *threads[OS_MAX_THREADS];
+static uint32_t ready = 0U;                    /* bit per priority */
+static volatile uint32_t tick = 0U;
+static uint32_t idle_sleeps = 0U;
+
+static os_thread_t idle_thread;
+static uint32_t idle_stack[OS_IDLE_STACK] __attribute__((aligned(8)));
+static uint32_t boot_stack[32] __attribute__((aligned(8)));
+
+os_thread_t *os_pick_next(void);
+
+static uint32_t highest(uint32_t map)
+{
+    return __CLZ(__RBIT(map));                 /* lowest set bit */
+}
+
+static void os_pend_switch(void)
+{
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+static void os_copy(uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+    while (n--)
+    {
+        *dst++ = *src++;
+    }
+}
+
+   /*--------------------------------------------------
+    * Wake t with result (IRQs masked)
+    *-------------------------------------------------*/
+static void os_make_ready(os_thread_t *t, int result)
+{
+    t->result = (int8_t)result;
+    t->timed = 0U;
+
+    if (t->waiters != 0)
+    {
+        *t->waiters &= ~BIT(t->prio);
+        t->waiters = 0;
+    }
+
+    ready |= BIT(t->prio);
+
+    if ((os_cur != 0) && (t->prio < os_cur->prio))
+    {
+        os_pend_switch();
+    }
+}
+
+   /*--------------------------------------------------
+    * Block the running thread (IRQs masked, primask =
+    * state to restore). The switch happens as soon as
+    * PRIMASK is restored, the call returns once the
+    * thread is woken again.
+    *-------------------------------------------------*/
+static int os_block(uint32_t *waiters, uint32_t timeout, uint32_t primask)
+{
+    os_thread_t *t = os_cur;
+
+    t->result = OS_TIMEOUT;
+    t->waiters = waiters;
+    if (waiters != 0)
+    {
+        *waiters |= BIT(t->prio);
+    }
+
+    t->timed = (timeout != OS_WAIT_FOREVER) ? 1U : 0U;
+    t->wake = tick + timeout;
+
+    ready &= ~BIT(t->prio);
+    os_pend_switch();
+
+    __set_PRIMASK(primask);
+
+    return t->result;
+}
+
+static void os_thread_exit(void)
+{
+    __disable_irq();
+    ready &= ~BIT(os_cur->prio);
+    os_cur->timed = 0U;
+    os_pend_switch();
+    __enable_irq();
+
+    while (1)
+    {
+        /* never scheduled again */
+    }
+}
+
+   /*--------------------------------------------------
+    * Tick (IRQs masked): expire timeouts
+    *-------------------------------------------------*/
+static void os_tick_advance(uint32_t n)
+{
+    uint32_t i;
+
+    tick += n;
+
+    for (i = 0U; i < OS_MAX_THREADS; i++)
+    {
+        os_thread_t *t = threads[i];
+
+        if ((t != 0) && t->timed && ((int32_t)(tick - t->wake) >= 0))
+        {
+            os_make_ready(t, OS_TIMEOUT);
+        }
+    }
+}
+
+void SysTick_Handler(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    os_tick_advance(1U);
+    __set_PRIMASK(primask);
+}
+
+   /*--------------------------------------------------
+    * Ticks until the first timeout, OS_MAX_SLEEP if
+    * none (SysTick's 24-bit reload is the limit)
+    *-------------------------------------------------*/
+static uint32_t os_next_timeout(void)
+{
+    uint32_t best = OS_MAX_SLEEP;
+    uint32_t i;
+
+    for (i = 0U; i < OS_MAX_THREADS; i++)
+    {
+        os_thread_t *t = threads[i];
+
+        if ((t != 0) && t->timed)
+        {
+            int32_t d = (int32_t)(t->wake - tick);
+
+            if (d <= 0)
+            {
+                return 0U;
+            }
+            if ((uint32_t)d < best)
+            {
+                best = (uint32_t)d;
+            }
+        }
+    }
+
+    return best;
+}
+
+   /*--------------------------------------------------
+    * Tickless sleep (IRQs masked)
+    *
+    * SysTick is stopped and reloaded to fire at the
+    * next timeout: the rest of the current tick plus
+    * n - 1 full ticks. After WFI the ticks that really
+    * passed are added and SysTick is restarted on the
+    * old tick grid (first reload = remainder of the
+    * current tick, then LOAD back to one tick). A few
+    * cycles per sleep are lost in the stop / restart.
+    *-------------------------------------------------*/
+static void os_idle_sleep(void)
+{
+    uint32_t n = os_next_timeout();
+    uint32_t remaining;
+    uint32_t load;
+    uint32_t ctrl;
+
+    if ((n < 2U) || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+        __WFI();                               /* next tick is due anyway */
+        return;
+    }
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    remaining = SysTick->VAL;
+    if (remaining == 0U)
+    {
+        remaining = OS_TICK_CYCLES;
+    }
+
+    load = remaining + ((n - 1U) * OS_TICK_CYCLES);
+    if (load > (SysTick_LOAD_RELOAD_Msk + 1U))
+    {
+        load = remaining + ((OS_MAX_SLEEP - 1U) * OS_TICK_CYCLES);
+        n = OS_MAX_SLEEP;
+    }
+
+    SysTick->LOAD = load - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    idle_sleeps++;
+    __DSB();
+    __WFI();
+
+    ctrl = SysTick->CTRL;                      /* read clears COUNTFLAG */
+    SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+    if (ctrl & SysTick_CTRL_COUNTFLAG_Msk)
+    {
+        /* slept until the timeout: count it here, not in the handler */
+        SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+        os_tick_advance(n);
+
+        SysTick->LOAD = OS_TICK_CYCLES - 1U;
+        SysTick->VAL = 0U;
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    }
+    else
+    {
+        /* woken early by another interrupt */
+        uint32_t elapsed = (load - 1U) - SysTick->VAL;
+        uint32_t ticks = 0U;
+        uint32_t residual;
+
+        if (elapsed < remaining)
+        {
+            residual = remaining - elapsed;
+        }
+        else
+        {
+            ticks = 1U + ((elapsed - remaining) / OS_TICK_CYCLES);
+            residual = OS_TICK_CYCLES - ((elapsed - remaining) % OS_TICK_CYCLES);
+        }
+
+        if (residual < 16U)
+        {
+            ticks++;
+            residual += OS_TICK_CYCLES;
+        }
+
+        if (ticks != 0U)
+        {
+            os_tick_advance(ticks);
+        }
+
+        SysTick->LOAD = residual - 1U;
+        SysTick->VAL = 0U;
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        SysTick->LOAD = OS_TICK_CYCLES - 1U;   /* used from the next reload */
+    }
+}
+
+static void os_idle(void *arg)
+{
+    (void)arg;
+
+    while (1)
+    {
+        __disable_irq();
+        if ((ready & ~BIT(OS_IDLE_PRIO)) == 0U)
+        {
+            os_idle_sleep();
+        }
+        __enable_irq();
+    }
+}
+
+   /*--------------------------------------------------
+    * Called from PendSV with IRQs masked
+    *-------------------------------------------------*/
+os_thread_t *os_pick_next(void)
+{
+    os_cur = threads[highest(ready)];
+    os_cur->switches++;
+
+    return os_cur;
+}
+
+   /*--------------------------------------------------
+    * Context switch
+    *
+    * Saves r4-r11 and EXC_RETURN on the old thread's
+    * stack, plus s16-s31 if its frame is an FP frame
+    * (EXC_RETURN bit 4 clear). The hardware already
+    * stacked (or reserved lazily) r0-r3, r12, lr, pc,
+    * xpsr and s0-s15, FPSCR. os_cur == 0 is the first
+    * switch from os_start(), nothing to save.
+    *-------------------------------------------------*/
+__attribute__((naked)) void PendSV_Handler(void)
+{
+    __asm volatile (
+        "   cpsid    i                  \n"
+        "   ldr      r3, =os_cur        \n"
+        "   ldr      r2, [r3]           \n"
+        "   cbz      r2, 1f             \n"
+        "   mrs      r0, psp            \n"
+        "   tst      lr, #0x10          \n"
+        "   it       eq                 \n"
+        "   vstmdbeq r0!, {s16-s31}     \n"
+        "   stmdb    r0!, {r4-r11, lr}  \n"
+        "   str      r0, [r2]           \n"
+        "1: bl       os_pick_next       \n"
+        "   ldr      r0, [r0]           \n"
+        "   ldmia    r0!, {r4-r11, lr}  \n"
+        "   tst      lr, #0x10          \n"
+        "   it       eq                 \n"
+        "   vldmiaeq r0!, {s16-s31}     \n"
+        "   msr      psp, r0            \n"
+        "   cpsie    i                  \n"
+        "   bx       lr                 \n"
+    );
+}
+
+void os_init(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < OS_MAX_THREADS; i++)
+    {
+        threads[i] = 0;
+    }
+
+    ready = 0U;
+    tick = 0U;
+    os_cur = 0;
+
+    (void)os_thread_create(&idle_thread, "idle", os_idle, 0, OS_IDLE_PRIO,
+                           idle_stack, OS_IDLE_STACK);
+}
+
+   /*--------------------------------------------------
+    * Initial stack: what PendSV pops for a thread
+    * that was switched out right before fn(arg)
+    *-------------------------------------------------*/
+int os_thread_create(os_thread_t *t, const char *name, os_thread_fn_t fn, void *arg,
+                     uint32_t prio, uint32_t *stack, uint32_t stack_words)
+{
+    uint32_t *sp;
+    uint32_t primask;
+    uint32_t i;
+
+    if ((prio >= OS_MAX_THREADS) || (threads[prio] != 0) || (stack_words < 32U))
+    {
+        return OS_ERR;
+    }
+
+    for (i = 0U; i < stack_words; i++)
+    {
+        stack[i] = OS_STACK_FILL;
+    }
+
+    sp = (uint32_t *)((uint32_t)&stack[stack_words] & ~7U);
+
+    *--sp = 0x01000000U;                       /* xPSR, Thumb */
+    *--sp = (uint32_t)fn & ~1U;                /* PC */
+    *--sp = (uint32_t)os_thread_exit;          /* LR */
+    *--sp = 0U;                                /* R12 */
+    *--sp = 0U;                                /* R3 */
+    *--sp = 0U;                                /* R2 */
+    *--sp = 0U;                                /* R1 */
+    *--sp = (uint32_t)arg;                     /* R0 */
+    *--sp = 0xFFFFFFFDU;                       /* EXC_RETURN: thread, PSP, no FP */
+    for (i = 0U; i < 8U; i++)
+    {
+        *--sp = 0U;                            /* R11 .. R4 */
+    }
+
+    t->sp = sp;
+    t->prio = prio;
+    t->wake = 0U;
+    t->timed = 0U;
+    t->result = OS_OK;
+    t->waiters = 0;
+    t->name = name;
+    t->stack = stack;
+    t->switches = 0U;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    threads[prio] = t;
+    os_make_ready(t, OS_OK);
+    __set_PRIMASK(primask);
+
+    return OS_OK;
+}
+
+   /*--------------------------------------------------
+    * Start the tick and switch to the highest ready
+    * thread. main's stack is left behind for good,
+    * interrupts keep using MSP.
+    *-------------------------------------------------*/
+void os_start(void)
+{
+    NVIC_SetPriority(PendSV_IRQn, (1U << __NVIC_PRIO_BITS) - 1U);
+    NVIC_SetPriority(SysTick_IRQn, (1U << __NVIC_PRIO_BITS) - 1U);
+
+    __disable_irq();
+
+    SysTick->LOAD = OS_TICK_CYCLES - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                    SysTick_CTRL_ENABLE_Msk;
+
+    __set_PSP((uint32_t)&boot_stack[32]);
+    __set_CONTROL(0x02U);                      /* thread mode on PSP, no FP context */
+    __ISB();
+
+    os_cur = 0;
+    os_pend_switch();
+    __enable_irq();
+
+    while (1)
+    {
+        /* not reached */
+    }
+}
+
+uint32_t os_ticks(void)
+{
+    return tick;
+}
+
+void os_sleep(uint32_t ticks)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    if (ticks == 0U)
+    {
+        return;
+    }
+
+    __disable_irq();
+    (void)os_block(0, ticks, primask);
+}
+
+void os_sleep_until(uint32_t *last, uint32_t period)
+{
+    uint32_t primask = __get_PRIMASK();
+    int32_t d;
+
+    __disable_irq();
+
+    *last += period;
+    d = (int32_t)(*last - tick);
+
+    if (d <= 0)
+    {
+        /* already late: no sleep, the next period catches up */
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    (void)os_block(0, (uint32_t)d, primask);
+}
+
+void os_sem_init(os_sem_t *s, uint32_t initial)
+{
+    s->count = initial;
+    s->waiters = 0U;
+}
+
+int os_sem_wait(os_sem_t *s, uint32_t timeout)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (s->count != 0U)
+    {
+        s->count--;
+        __set_PRIMASK(primask);
+        return OS_OK;
+    }
+
+    if ((timeout == 0U) || (__get_IPSR() != 0U))
+    {
+        __set_PRIMASK(primask);
+        return OS_TIMEOUT;
+    }
+
+    return os_block(&s->waiters, timeout, primask);
+}
+
+   /* a waiting thread gets the count directly */
+void os_sem_post(os_sem_t *s)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (s->waiters != 0U)
+    {
+        os_make_ready(threads[highest(s->waiters)], OS_OK);
+    }
+    else
+    {
+        s->count++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void os_queue_init(os_queue_t *q, void *buf, uint32_t item_size, uint32_t len)
+{
+    q->buf = (uint8_t *)buf;
+    q->item_size = item_size;
+    q->len = len;
+    q->count = 0U;
+    q->head = 0U;
+    q->tail = 0U;
+    q->recv_waiters = 0U;
+    q->send_waiters = 0U;
+    q->dropped = 0U;
+}
+
+   /*--------------------------------------------------
+    * Send / receive: try, otherwise block on the
+    * other side's wake-up and retry until the
+    * deadline. Woken threads retry, so a higher
+    * priority thread may take the slot first.
+    *-------------------------------------------------*/
+int os_queue_send(os_queue_t *q, const void *item, uint32_t timeout)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t deadline = tick + timeout;
+
+    if (__get_IPSR() != 0U)
+    {
+        timeout = 0U;
+    }
+
+    while (1)
+    {
+        uint32_t wait = OS_WAIT_FOREVER;
+
+        __disable_irq();
+
+        if (q->count < q->len)
+        {
+            os_copy(&q->buf[q->head * q->item_size], (const uint8_t *)item, q->item_size);
+            q->head = (q->head + 1U == q->len) ? 0U : q->head + 1U;
+            q->count++;
+
+            if (q->recv_waiters != 0U)
+            {
+                os_make_ready(threads[highest(q->recv_waiters)], OS_OK);
+            }
+
+            __set_PRIMASK(primask);
+            return OS_OK;
+        }
+
+        if (timeout != OS_WAIT_FOREVER)
+        {
+            wait = deadline - tick;
+        }
+
+        /* OS_WAIT_FOREVER is -1 as int32_t: no deadline to test */
+        if ((timeout == 0U) || ((timeout != OS_WAIT_FOREVER) && ((int32_t)wait <= 0)))
+        {
+            q->dropped++;
+            __set_PRIMASK(primask);
+            return OS_TIMEOUT;
+        }
+
+        if (os_block(&q->send_waiters, wait, primask) == OS_TIMEOUT)
+        {
+            __disable_irq();
+            q->dropped++;
+            __set_PRIMASK(primask);
+            return OS_TIMEOUT;
+        }
+    }
+}
+
+int os_queue_recv(os_queue_t *q, void *item, uint32_t timeout)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t deadline = tick + timeout;
+
+    if (__get_IPSR() != 0U)
+    {
+        timeout = 0U;
+    }
+
+    while (1)
+    {
+        uint32_t wait = OS_WAIT_FOREVER;
+
+        __disable_irq();
+
+        if (q->count != 0U)
+        {
+            os_copy((uint8_t *)item, &q->buf[q->tail * q->item_size], q->item_size);
+            q->tail = (q->tail + 1U == q->len) ? 0U : q->tail + 1U;
+            q->count--;
+
+            if (q->send_waiters != 0U)
+            {
+                os_make_ready(threads[highest(q->send_waiters)], OS_OK);
+            }
+
+            __set_PRIMASK(primask);
+            return OS_OK;
+        }
+
+        if (timeout != OS_WAIT_FOREVER)
+        {
+            wait = deadline - tick;
+        }
+
+        /* OS_WAIT_FOREVER is -1 as int32_t: no deadline to test */
+        if ((timeout == 0U) || ((timeout != OS_WAIT_FOREVER) && ((int32_t)wait <= 0)))
+        {
+            __set_PRIMASK(primask);
+            return OS_TIMEOUT;
+        }
+
+        if (os_block(&q->recv_waiters, wait, primask) == OS_TIMEOUT)
+        {
+            return OS_TIMEOUT;
+        }
+    }
+}
+
+uint32_t os_stack_free(const os_thread_t *t)
+{
+    uint32_t n = 0U;
+
+    while (t->stack[n] == OS_STACK_FILL)
+    {
+        n++;
+    }
+
+    return n;
+}
+
+uint32_t os_idle_sleeps(void)
+{
+    return idle_sleeps;
+}
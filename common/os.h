@@ -0,0 +1,96 @@
+#ifndef OS_H
+#define OS_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * Small preemptive kernel for Cortex-M4F
+    *
+    * - fixed-priority threads, one per priority level,
+    *   0 = highest; the idle thread takes the lowest
+    *   level OS_MAX_THREADS - 1
+    * - PendSV does the context switch, SysTick the
+    *   tick; both at the lowest NVIC priority so they
+    *   never delay a peripheral ISR
+    * - lazy FPU stacking: s16-s31 are saved only for
+    *   threads that have an FP context (EXC_RETURN
+    *   bit 4 clear), the hardware handles s0-s15
+    * - tickless idle: with nothing ready, SysTick is
+    *   reprogrammed to fire at the next timeout and
+    *   the core sleeps in WFI until then
+    * - counting semaphores and fixed-size message
+    *   queues with timeouts; post / send from ISRs
+    *   never block
+    *
+    * Kernel data is protected with PRIMASK for a few
+    * cycles, so ISRs at any priority may call
+    * os_sem_post() / os_queue_send(..., 0). Blocking
+    * calls are for threads running with IRQs enabled.
+    *-------------------------------------------------*/
+
+#define OS_MAX_THREADS   8U                    /* priorities 0..7, 7 = idle */
+#define OS_TICK_HZ       1000U
+#define OS_CPU_HZ        16000000U             /* SysTick clock, HSI */
+#define OS_IDLE_STACK    128U                  /* words */
+
+#define OS_WAIT_FOREVER  0xFFFFFFFFU
+
+#define OS_OK            0
+#define OS_TIMEOUT      -1
+#define OS_ERR          -2
+
+typedef void (*os_thread_fn_t)(void *arg);
+
+typedef struct os_thread
+{
+    uint32_t         *sp;                      /* must stay first: PendSV uses it */
+    uint32_t          prio;
+    uint32_t          wake;                    /* tick of timeout */
+    uint8_t           timed;                   /* wake counts */
+    volatile int8_t   result;                  /* OS_OK / OS_TIMEOUT after a block */
+    uint32_t         *waiters;                 /* bitmap the thread is queued on */
+    const char       *name;
+    uint32_t         *stack;                   /* lowest word, for os_stack_free() */
+    uint32_t          switches;                /* times switched in */
+} os_thread_t;
+
+typedef struct
+{
+    volatile uint32_t count;
+    uint32_t          waiters;                 /* bit per priority */
+} os_sem_t;
+
+typedef struct
+{
+    uint8_t          *buf;
+    uint32_t          item_size;
+    uint32_t          len;                     /* items */
+    volatile uint32_t count;
+    uint32_t          head;
+    uint32_t          tail;
+    uint32_t          recv_waiters;
+    uint32_t          send_waiters;
+    uint32_t          dropped;                 /* sends that failed */
+} os_queue_t;
+
+void os_init(void);
+int  os_thread_create(os_thread_t *t, const char *name, os_thread_fn_t fn, void *arg,
+                      uint32_t prio, uint32_t *stack, uint32_t stack_words);
+void os_start(void);                           /* does not return */
+
+uint32_t os_ticks(void);
+void     os_sleep(uint32_t ticks);
+void     os_sleep_until(uint32_t *last, uint32_t period);   /* drift-free period */
+
+void os_sem_init(os_sem_t *s, uint32_t initial);
+int  os_sem_wait(os_sem_t *s, uint32_t timeout);
+void os_sem_post(os_sem_t *s);                 /* thread or ISR */
+
+void os_queue_init(os_queue_t *q, void *buf, uint32_t item_size, uint32_t len);
+int  os_queue_send(os_queue_t *q, const void *item, uint32_t timeout);  /* ISR: 0 */
+int  os_queue_recv(os_queue_t *q, void *item, uint32_t timeout);
+
+uint32_t os_stack_free(const os_thread_t *t);  /* words never touched */
+uint32_t os_idle_sleeps(void);                 /* tickless sleeps taken */
+
+#endif /* OS_H */
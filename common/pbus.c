@@ -0,0 +1,267 @@
+#include "pbus.h"
+
+static void pbus_dma_done(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    pbus_t *b = (pbus_t *)ctx;
+
+    (void)s;
+
+    if (events & (DMA_EVT_TC | DMA_EVT_TE))
+    {
+        TIM1->DIER &= ~TIM_DIER_UDE;
+        TIM1->CR1 &= ~TIM_CR1_CEN;
+        b->busy = 0U;
+
+        if (b->cb != 0)
+        {
+            b->cb(b, b->ctx);
+        }
+    }
+}
+
+int pbus_init(pbus_t *b, const pbus_cfg_t *cfg)
+{
+    RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+
+    b->port = cfg->port;
+    b->target = cfg->target;
+    b->busy = 0U;
+    b->cb = 0;
+    b->ctx = 0;
+
+    b->dma = dma_alloc(DMA_REQ_TIM1_UP);
+    if (b->dma == 0)
+    {
+        return PBUS_ERR_DMA;
+    }
+
+    return pbus_rate(b, cfg->rate_hz);
+}
+
+   /*--------------------------------------------------
+    * TIM1 only paces the DMA: no channels, no TRGO,
+    * update every 1 / rate
+    *-------------------------------------------------*/
+int pbus_rate(pbus_t *b, uint32_t rate_hz)
+{
+    uint32_t ticks;
+    uint32_t psc;
+    uint32_t arr;
+
+    if (b->busy)
+    {
+        return PBUS_ERR_BUSY;
+    }
+
+    if (rate_hz == 0U)
+    {
+        return PBUS_ERR_CONFIG;
+    }
+
+    ticks = SystemCoreClock / rate_hz;
+    if (ticks < PBUS_MIN_TICKS)
+    {
+        return PBUS_ERR_CONFIG;
+    }
+
+    psc = (ticks - 1U) / 0x10000U;
+    arr = (ticks / (psc + 1U)) - 1U;
+
+    TIM1->CR1 = TIM_CR1_ARPE;
+    TIM1->CR2 = 0U;
+    TIM1->DIER = 0U;
+    TIM1->PSC = psc;
+    TIM1->ARR = arr;
+    TIM1->EGR = TIM_EGR_UG;
+    TIM1->SR = 0U;
+
+    b->rate_hz = SystemCoreClock / ((psc + 1U) * (arr + 1U));
+
+    return PBUS_OK;
+}
+
+   /*--------------------------------------------------
+    * The first word goes out one period after the
+    * start, then one per period
+    *-------------------------------------------------*/
+int pbus_start(pbus_t *b, const void *words, uint16_t count,
+               uint32_t circular, pbus_cb_t cb, void *ctx)
+{
+    dma_width_t width = (b->target == PBUS_BSRR) ? DMA_WIDTH_32 : DMA_WIDTH_16;
+
+    if (count == 0U)
+    {
+        return PBUS_ERR_CONFIG;
+    }
+
+    if (b->busy)
+    {
+        return PBUS_ERR_BUSY;
+    }
+
+    b->cb = cb;
+    b->ctx = ctx;
+
+    {
+        dma_desc_t desc =
+        {
+            .dir      = DMA_DIR_M2P,
+            .psize    = width,
+            .msize    = width,
+            .minc     = 1U,
+            .circular = circular ? 1U : 0U,
+            .prio     = DMA_PRIO_VERY_HIGH,
+            .periph   = (b->target == PBUS_BSRR) ? (uint32_t)&b->port->BSRR
+                                                 : (uint32_t)&b->port->ODR,
+            .mem0     = (uint32_t)words,
+            .count    = count,
+            .events   = circular ? DMA_EVT_TE : (DMA_EVT_TC | DMA_EVT_TE),
+            .callback = pbus_dma_done,
+            .ctx      = b,
+        };
+
+        if (dma_config(b->dma, &desc) != DMA_OK)
+        {
+            return PBUS_ERR_CONFIG;
+        }
+    }
+
+    b->busy = 1U;
+
+    TIM1->CNT = 0U;
+    TIM1->SR = 0U;
+    dma_start(b->dma);
+    TIM1->DIER |= TIM_DIER_UDE;
+    TIM1->CR1 |= TIM_CR1_CEN;
+
+    return PBUS_OK;
+}
+
+void pbus_stop(pbus_t *b)
+{
+    TIM1->DIER &= ~TIM_DIER_UDE;
+    TIM1->CR1 &= ~TIM_CR1_CEN;
+
+    if (b->dma != 0)
+    {
+        dma_stop(b->dma);
+    }
+
+    b->busy = 0U;
+}
+
+   /*--------------------------------------------------
+    * Builder
+    *-------------------------------------------------*/
+static inline uint32_t bus_word(const pbus_build_t *pb)
+{
+    uint32_t hi = (uint32_t)(pb->level & pb->pins);
+    uint32_t lo = (uint32_t)(~pb->level & pb->pins);
+
+    return hi | (lo << 16);
+}
+
+static inline void emit_one(pbus_build_t *pb)
+{
+    pb->buf[pb->len++] = bus_word(pb);
+}
+
+void pbus_build_init(pbus_build_t *pb, uint32_t *buf, uint16_t cap,
+                     uint16_t pins, uint16_t level)
+{
+    pb->buf = buf;
+    pb->cap = cap;
+    pb->len = 0U;
+    pb->pins = pins;
+    pb->level = (uint16_t)(level & pins);
+}
+
+int pbus_emit(pbus_build_t *pb, uint32_t slots)
+{
+    if (slots > (uint32_t)(pb->cap - pb->len))
+    {
+        return PBUS_ERR_FULL;
+    }
+
+    while (slots > 0U)
+    {
+        emit_one(pb);
+        slots--;
+    }
+
+    return PBUS_OK;
+}
+
+   /* two slots per byte: data + strobe low, strobe high (latch) */
+int pbus_build_strobed(pbus_build_t *pb, uint32_t data_lsb, uint16_t strobe,
+                       const uint8_t *bytes, uint32_t n)
+{
+    uint16_t dmask;
+    uint32_t i;
+
+    if (data_lsb > 8U)
+    {
+        return PBUS_ERR_CONFIG;
+    }
+
+    if ((2U * n) > (uint32_t)(pb->cap - pb->len))
+    {
+        return PBUS_ERR_FULL;
+    }
+
+    dmask = (uint16_t)(0xFFU << data_lsb);
+
+    for (i = 0U; i < n; i++)
+    {
+        pbus_put(pb, dmask, (uint16_t)((uint32_t)bytes[i] << data_lsb));
+        pbus_put(pb, strobe, 0U);
+        emit_one(pb);
+
+        pbus_put(pb, strobe, strobe);
+        emit_one(pb);
+    }
+
+    return PBUS_OK;
+}
+
+   /*--------------------------------------------------
+    * Two slots per bit: data + clock low, clock high
+    * (shifts on the rising edge). Then latch high and
+    * low, with the clock low.
+    *-------------------------------------------------*/
+int pbus_build_shift(pbus_build_t *pb, uint16_t data, uint16_t clock, uint16_t latch,
+                     const uint8_t *bytes, uint32_t n, uint32_t msb_first)
+{
+    uint32_t i;
+    uint32_t k;
+
+    if (((16U * n) + 2U) > (uint32_t)(pb->cap - pb->len))
+    {
+        return PBUS_ERR_FULL;
+    }
+
+    for (i = 0U; i < n; i++)
+    {
+        for (k = 0U; k < 8U; k++)
+        {
+            uint32_t bit = msb_first ? ((bytes[i] >> (7U - k)) & 1U)
+                                     : ((bytes[i] >> k) & 1U);
+
+            pbus_put(pb, data, bit ? data : 0U);
+            pbus_put(pb, clock, 0U);
+            emit_one(pb);
+
+            pbus_put(pb, clock, clock);
+            emit_one(pb);
+        }
+    }
+
+    pbus_put(pb, clock, 0U);
+    pbus_put(pb, latch, latch);
+    emit_one(pb);
+
+    pbus_put(pb, latch, 0U);
+    emit_one(pb);
+
+    return PBUS_OK;
+}
@@ -0,0 +1,144 @@
+#ifndef PBUS_H
+#define PBUS_H
+
+#include "stm32f4xx.h"
+#include "dma.h"
+
+   /*--------------------------------------------------
+    * Parallel GPIO bus driven by DMA
+    *
+    * Every TIM1 update event requests one DMA2
+    * transfer from a pattern buffer into GPIOx->BSRR
+    * (or ODR), so all pins of the bus change in the
+    * same AHB write, one word per timer period, with
+    * no CPU work: 8080 style display writes, shift
+    * register chains, any multi-pin waveform.
+    *
+    * Why TIM1: GPIO sits on AHB1, which only the DMA2
+    * peripheral port reaches, and on the F401 TIM1 is
+    * the only timer whose requests go to DMA2 (UP on
+    * stream 5 channel 6). TIM1 belongs to the bus
+    * while it is in use.
+    *
+    * Targets:
+    *   PBUS_BSRR  32-bit words, set bits 15:0, reset
+    *              bits 31:16. Only the pins named in
+    *              a word move, so the rest of the
+    *              port stays free for other code.
+    *              The builder below writes these.
+    *   PBUS_ODR   16-bit words written to the whole
+    *              port, half the memory.
+    *
+    * Timing: the period is exact to the timer clock.
+    * Each word lands a fixed DMA latency after its
+    * update, give or take a few cycles when the CPU
+    * or another DMA2 stream holds the bus matrix. At
+    * 16 MHz the bus runs up to 2 MHz (8 ticks per
+    * word); faster rates overrun the stream.
+    *
+    * The bus pins must be outputs (gpio_config())
+    * before starting.
+    *-------------------------------------------------*/
+
+#define PBUS_OK           0
+#define PBUS_ERR_CONFIG  -1                    /* rate or argument out of range */
+#define PBUS_ERR_DMA     -2                    /* DMA2 stream 5 taken */
+#define PBUS_ERR_BUSY    -3                    /* a pattern is still running */
+#define PBUS_ERR_FULL    -4                    /* builder out of space */
+
+#define PBUS_MIN_TICKS   8U
+
+typedef enum
+{
+    PBUS_BSRR = 0,
+    PBUS_ODR
+} pbus_target_t;
+
+typedef struct pbus pbus_t;
+
+typedef void (*pbus_cb_t)(pbus_t *b, void *ctx);
+
+typedef struct
+{
+    GPIO_TypeDef  *port;
+    pbus_target_t  target;
+    uint32_t       rate_hz;                    /* words per second */
+} pbus_cfg_t;
+
+struct pbus
+{
+    GPIO_TypeDef     *port;
+    pbus_target_t     target;
+    uint32_t          rate_hz;                 /* as set, after rounding */
+    dma_stream_t     *dma;
+    volatile uint8_t  busy;
+    pbus_cb_t         cb;
+    void             *ctx;
+};
+
+int  pbus_init(pbus_t *b, const pbus_cfg_t *cfg);
+int  pbus_rate(pbus_t *b, uint32_t rate_hz);   /* while idle */
+
+   /* words: uint32_t for PBUS_BSRR, uint16_t for PBUS_ODR */
+int  pbus_start(pbus_t *b, const void *words, uint16_t count,
+                uint32_t circular, pbus_cb_t cb, void *ctx);
+void pbus_stop(pbus_t *b);
+
+static inline uint32_t pbus_busy(const pbus_t *b)
+{
+    return b->busy;
+}
+
+   /*--------------------------------------------------
+    * Pattern builder (PBUS_BSRR words)
+    *
+    * The builder keeps the level of every bus pin and
+    * writes one word per time slot that drives all of
+    * them: each word fully states the bus, so a
+    * pattern can be started, repeated or cut anywhere.
+    * pbus_put() changes pins without using a slot,
+    * pbus_emit() spends slots. On top of that:
+    *
+    *   pbus_build_strobed()  a byte per write on 8
+    *                         data pins, strobe low
+    *                         then high (8080 WR)
+    *   pbus_build_shift()    bits on a data pin with
+    *                         a clock per bit and a
+    *                         latch pulse at the end
+    *                         (74HC595 chains)
+    *
+    * Builder calls return PBUS_ERR_FULL once the
+    * buffer is full and leave len where it was.
+    *-------------------------------------------------*/
+typedef struct
+{
+    uint32_t *buf;
+    uint16_t  cap;                             /* words */
+    uint16_t  len;
+    uint16_t  pins;                            /* bus pins */
+    uint16_t  level;                           /* current level of the bus pins */
+} pbus_build_t;
+
+void pbus_build_init(pbus_build_t *pb, uint32_t *buf, uint16_t cap,
+                     uint16_t pins, uint16_t level);
+
+static inline void pbus_build_reset(pbus_build_t *pb)
+{
+    pb->len = 0U;
+}
+
+static inline void pbus_put(pbus_build_t *pb, uint16_t mask, uint16_t value)
+{
+    pb->level = (uint16_t)((pb->level & ~mask) | (value & mask));
+}
+
+int pbus_emit(pbus_build_t *pb, uint32_t slots);
+
+   /* data pins data_lsb .. data_lsb + 7 */
+int pbus_build_strobed(pbus_build_t *pb, uint32_t data_lsb, uint16_t strobe,
+                       const uint8_t *bytes, uint32_t n);
+
+int pbus_build_shift(pbus_build_t *pb, uint16_t data, uint16_t clock, uint16_t latch,
+                     const uint8_t *bytes, uint32_t n, uint32_t msb_first);
+
+#endif /* PBUS_H */
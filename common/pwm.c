@@ -0,0 +1,363 @@
+#include "pwm.h"
+
+#define DBA_CCR1  (0x34U / 4U)                 /* DCR base: CCR1, word offset */
+
+   /*--------------------------------------------------
+    * Clock enable, channel count and update DMA
+    * request per timer
+    *-------------------------------------------------*/
+static int tim_setup(pwm_t *p, TIM_TypeDef *tim)
+{
+    p->advanced = 0U;
+    p->wide = 0U;
+    p->channels = 4U;
+
+    if (tim == TIM1)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
+        p->advanced = 1U;
+    }
+    else if ((tim == TIM2) || (tim == TIM5))
+    {
+        RCC->APB1ENR |= (tim == TIM2) ? RCC_APB1ENR_TIM2EN : RCC_APB1ENR_TIM5EN;
+        p->wide = 1U;
+    }
+    else if (tim == TIM3) { RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; }
+    else if (tim == TIM4) { RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; }
+    else if (tim == TIM9)
+    {
+        RCC->APB2ENR |= RCC_APB2ENR_TIM9EN;
+        p->channels = 2U;
+    }
+    else if ((tim == TIM10) || (tim == TIM11))
+    {
+        RCC->APB2ENR |= (tim == TIM10) ? RCC_APB2ENR_TIM10EN : RCC_APB2ENR_TIM11EN;
+        p->channels = 1U;
+    }
+    else
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    return PWM_OK;
+}
+
+static int up_request(TIM_TypeDef *tim, dma_request_t *req)
+{
+    if      (tim == TIM1) { *req = DMA_REQ_TIM1_UP; }
+    else if (tim == TIM2) { *req = DMA_REQ_TIM2_UP; }
+    else if (tim == TIM3) { *req = DMA_REQ_TIM3_UP; }
+    else if (tim == TIM4) { *req = DMA_REQ_TIM4_UP; }
+    else if (tim == TIM5) { *req = DMA_REQ_TIM5_UP; }
+    else
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    return PWM_OK;
+}
+
+   /*--------------------------------------------------
+    * Dead-time in DTG encoding (RM0368 17.4.18), with
+    * CKD = 0 one step is one timer clock. Rounds up to
+    * the next encodable value; longer than 1008 steps
+    * saturates at 0xFF.
+    *
+    *   0xxxxxxx    DTG[6:0]            0 .. 127
+    *   10xxxxxx   (64 + DTG[5:0]) *  2  128 .. 254
+    *   110xxxxx   (32 + DTG[4:0]) *  8  256 .. 504
+    *   111xxxxx   (32 + DTG[4:0]) * 16  512 .. 1008
+    *-------------------------------------------------*/
+static uint32_t dtg_encode(uint32_t ns)
+{
+    uint32_t t = ((ns * (SystemCoreClock / 1000000U)) + 999U) / 1000U;
+
+    if (t <= 127U)
+    {
+        return t;
+    }
+    if (t <= (2U * (64U + 63U)))
+    {
+        return 0x80U | (((t + 1U) / 2U) - 64U);
+    }
+    if (t <= (8U * (32U + 31U)))
+    {
+        return 0xC0U | (((t + 7U) / 8U) - 32U);
+    }
+    if (t <= (16U * (32U + 31U)))
+    {
+        return 0xE0U | (((t + 15U) / 16U) - 32U);
+    }
+
+    return 0xFFU;
+}
+
+int pwm_init(pwm_t *p, const pwm_cfg_t *cfg)
+{
+    TIM_TypeDef *tim = cfg->tim;
+    uint32_t ticks;
+    uint32_t max;
+    uint32_t psc;
+
+    if ((cfg->freq_hz == 0U) || (tim_setup(p, tim) != PWM_OK))
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    /* TIM9..11 count up only */
+    if ((cfg->align == PWM_ALIGN_CENTER) && (p->channels < 4U))
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    p->tim = tim;
+    p->dma = 0;
+    p->wave_busy = 0U;
+
+   /*--------------------------------------------------
+    * Timer ticks per PWM period; center aligned counts
+    * up and down, so ARR is half of it
+    *-------------------------------------------------*/
+    ticks = SystemCoreClock / cfg->freq_hz;
+    if (cfg->align == PWM_ALIGN_CENTER)
+    {
+        ticks /= 2U;
+    }
+
+    max = 0x10000U;                            /* ARR + 1 */
+    if (p->wide)
+    {
+        max = 0xFFFFFFFFU;
+    }
+    else if (cfg->align == PWM_ALIGN_CENTER)
+    {
+        max = 0xFFFFU;                         /* ARR itself */
+    }
+    psc = (ticks > 0U) ? ((ticks - 1U) / max) : 0U;
+    if (psc > 0xFFFFU)
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    p->period = ticks / (psc + 1U);
+    if (p->period < 2U)
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    tim->CR1 = 0U;
+    tim->DIER = 0U;
+    tim->PSC = psc;
+
+    if (cfg->align == PWM_ALIGN_EDGE)
+    {
+        tim->ARR = p->period - 1U;
+    }
+    else
+    {
+        tim->ARR = p->period;                  /* 0 .. ARR .. 0, CCR = ARR is 100 % */
+        tim->CR1 = TIM_CR1_CMS_0;              /* center aligned mode 1 */
+    }
+
+    tim->CR1 |= TIM_CR1_ARPE;
+
+    if (p->advanced)
+    {
+        tim->BDTR = (dtg_encode(cfg->deadtime_ns) & 0xFFU) << TIM_BDTR_DTG_Pos;
+
+        /* center aligned: overflow and underflow, one update per period */
+        tim->RCR = (cfg->align == PWM_ALIGN_CENTER) ? 1U : 0U;
+    }
+
+    return PWM_OK;
+}
+
+   /*--------------------------------------------------
+    * PWM mode 1 (active while CNT < CCR), preload on.
+    * complementary: also drive CHxN (TIM1 CH1..3),
+    * with the dead-time from pwm_init()
+    *-------------------------------------------------*/
+int pwm_channel(pwm_t *p, uint32_t ch, uint32_t active_low, uint32_t complementary)
+{
+    TIM_TypeDef *tim = p->tim;
+    volatile uint32_t *ccmr;
+    uint32_t shift;
+    uint32_t ccer;
+
+    if ((ch < 1U) || (ch > p->channels))
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    if (complementary && (!p->advanced || (ch > 3U)))
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    ccmr = (ch <= 2U) ? &tim->CCMR1 : &tim->CCMR2;
+    shift = ((ch - 1U) & 1U) * 8U;
+
+    *ccmr = (*ccmr & ~(0xFFUL << shift)) |
+            (((6U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE) << shift);
+
+    pwm_set(p, ch, 0U);
+
+    ccer = TIM_CCER_CC1E;
+    if (active_low)
+    {
+        ccer |= TIM_CCER_CC1P;
+    }
+    if (complementary)
+    {
+        ccer |= TIM_CCER_CC1NE;
+        if (active_low)
+        {
+            ccer |= TIM_CCER_CC1NP;
+        }
+    }
+
+    tim->CCER = (tim->CCER & ~(0xFUL << (4U * (ch - 1U)))) | (ccer << (4U * (ch - 1U)));
+
+    return PWM_OK;
+}
+
+void pwm_start(pwm_t *p)
+{
+    TIM_TypeDef *tim = p->tim;
+
+    tim->EGR = TIM_EGR_UG;                     /* load PSC, ARR, CCRs */
+    tim->SR = 0U;
+
+    if (p->advanced)
+    {
+        tim->BDTR |= TIM_BDTR_MOE;             /* TIM1 outputs need MOE */
+    }
+
+    tim->CR1 |= TIM_CR1_CEN;
+}
+
+void pwm_stop(pwm_t *p)
+{
+    if (p->wave_busy)
+    {
+        pwm_wave_stop(p);
+    }
+
+    if (p->advanced)
+    {
+        p->tim->BDTR &= ~TIM_BDTR_MOE;
+    }
+
+    p->tim->CR1 &= ~TIM_CR1_CEN;
+}
+
+static void wave_dma_done(dma_stream_t *s, uint32_t events, void *ctx)
+{
+    pwm_t *p = (pwm_t *)ctx;
+
+    (void)s;
+
+    if (events & (DMA_EVT_TC | DMA_EVT_TE))
+    {
+        p->tim->DIER &= ~TIM_DIER_UDE;
+        p->wave_busy = 0U;
+
+        if (p->wave_cb != 0)
+        {
+            p->wave_cb(p, p->wave_ctx);
+        }
+    }
+}
+
+   /*--------------------------------------------------
+    * Each update event: DMA burst of n_ch transfers to
+    * DMAR, which the timer forwards to CCR[first_ch]
+    * onwards. The CCRs are preloaded, so the values
+    * written at one update are used for the next
+    * period in full.
+    *-------------------------------------------------*/
+int pwm_wave_start(pwm_t *p, uint32_t first_ch, uint32_t n_ch,
+                   const void *buf, dma_width_t width, uint16_t count,
+                   uint32_t circular, pwm_wave_cb_t cb, void *ctx)
+{
+    TIM_TypeDef *tim = p->tim;
+    dma_request_t req;
+
+    if ((first_ch < 1U) || (n_ch < 1U) || ((first_ch + n_ch - 1U) > p->channels) ||
+        (count == 0U) || (width == DMA_WIDTH_8) || (p->wide && (width != DMA_WIDTH_32)))
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    /* no repetition counter: center aligned would update twice a period */
+    if (((tim->CR1 & TIM_CR1_CMS) != 0U) && !p->advanced)
+    {
+        return PWM_ERR_CONFIG;
+    }
+
+    if (p->wave_busy)
+    {
+        return PWM_ERR_BUSY;
+    }
+
+    if (p->dma == 0)
+    {
+        if (up_request(tim, &req) != PWM_OK)
+        {
+            return PWM_ERR_CONFIG;
+        }
+
+        p->dma = dma_alloc(req);
+        if (p->dma == 0)
+        {
+            return PWM_ERR_DMA;
+        }
+    }
+
+    p->wave_cb = cb;
+    p->wave_ctx = ctx;
+
+    {
+        dma_desc_t desc =
+        {
+            .dir      = DMA_DIR_M2P,
+            .psize    = width,
+            .msize    = width,
+            .minc     = 1U,
+            .circular = circular ? 1U : 0U,
+            .prio     = DMA_PRIO_HIGH,
+            .periph   = (uint32_t)&tim->DMAR,
+            .mem0     = (uint32_t)buf,
+            .count    = count,
+            .events   = circular ? DMA_EVT_TE : (DMA_EVT_TC | DMA_EVT_TE),
+            .callback = wave_dma_done,
+            .ctx      = p,
+        };
+
+        if (dma_config(p->dma, &desc) != DMA_OK)
+        {
+            return PWM_ERR_CONFIG;
+        }
+    }
+
+    tim->DCR = ((n_ch - 1U) << TIM_DCR_DBL_Pos) |
+               ((DBA_CCR1 + first_ch - 1U) << TIM_DCR_DBA_Pos);
+
+    p->wave_busy = 1U;
+    dma_start(p->dma);
+    tim->DIER |= TIM_DIER_UDE;
+
+    return PWM_OK;
+}
+
+void pwm_wave_stop(pwm_t *p)
+{
+    p->tim->DIER &= ~TIM_DIER_UDE;
+
+    if (p->dma != 0)
+    {
+        dma_stop(p->dma);
+    }
+
+    p->wave_busy = 0U;
+}
@@ -0,0 +1,104 @@
+#ifndef PWM_H
+#define PWM_H
+
+#include "stm32f4xx.h"
+#include "dma.h"
+
+   /*--------------------------------------------------
+    * PWM outputs on TIM1..TIM5, TIM9..TIM11
+    *
+    * pwm_init() sets the frequency (PSC / ARR picked
+    * from SystemCoreClock), edge or center alignment
+    * and, on TIM1, the dead-time inserted between a
+    * channel and its complementary output (CHxN).
+    * pwm_channel() turns a channel into PWM mode 1
+    * with CCR preload, so pwm_set() takes effect at
+    * the next update and never glitches a period.
+    *
+    * Waveform mode: pwm_wave_start() lets DMA write
+    * the CCRs. The update event requests a DCR/DMAR
+    * burst of n consecutive CCRs per period, so every
+    * period gets new duty values from the buffer with
+    * no CPU work: arbitrary waveforms, or bit streams
+    * such as WS2812 LED data (one CCR value per bit).
+    * One-shot waves end with a callback from the DMA
+    * interrupt; circular waves repeat until stopped.
+    * TIM9..TIM11 have no DMA request on the F401.
+    * Center aligned, the counter overflows and
+    * underflows once each per period: TIM1 skips
+    * every second update with its repetition counter,
+    * TIM2..TIM5 have none and take waves edge aligned
+    * only.
+    *
+    * Pins are not touched: set them to the timer's
+    * alternate function before starting.
+    *-------------------------------------------------*/
+
+#define PWM_OK           0
+#define PWM_ERR_CONFIG  -1                     /* timer / channel / mode not supported */
+#define PWM_ERR_DMA     -2                     /* no free DMA stream */
+#define PWM_ERR_BUSY    -3                     /* a wave is still running */
+
+typedef enum
+{
+    PWM_ALIGN_EDGE = 0,                        /* up counting */
+    PWM_ALIGN_CENTER                           /* up / down, not on TIM9..11 */
+} pwm_align_t;
+
+typedef struct pwm pwm_t;
+
+typedef void (*pwm_wave_cb_t)(pwm_t *p, void *ctx);
+
+typedef struct
+{
+    TIM_TypeDef *tim;
+    uint32_t     freq_hz;
+    pwm_align_t  align;
+    uint32_t     deadtime_ns;                  /* TIM1 complementary outputs */
+} pwm_cfg_t;
+
+struct pwm
+{
+    TIM_TypeDef      *tim;
+    uint32_t          period;                  /* CCR value for 100 % */
+    uint8_t           channels;                /* channels this timer has */
+    uint8_t           advanced;                /* TIM1: BDTR, CHxN */
+    uint8_t           wide;                    /* 32-bit CCRs (TIM2, TIM5) */
+    dma_stream_t     *dma;                     /* waveform mode */
+    volatile uint8_t  wave_busy;
+    pwm_wave_cb_t     wave_cb;
+    void             *wave_ctx;
+};
+
+int  pwm_init(pwm_t *p, const pwm_cfg_t *cfg);
+int  pwm_channel(pwm_t *p, uint32_t ch, uint32_t active_low, uint32_t complementary);
+void pwm_start(pwm_t *p);
+void pwm_stop(pwm_t *p);
+
+static inline void pwm_set(pwm_t *p, uint32_t ch, uint32_t ccr)
+{
+    (&p->tim->CCR1)[ch - 1U] = ccr;
+}
+
+static inline void pwm_set_permille(pwm_t *p, uint32_t ch, uint32_t permille)
+{
+    pwm_set(p, ch, (p->period * permille) / 1000U);
+}
+
+   /*--------------------------------------------------
+    * buf holds n_ch CCR values per period, channels
+    * first_ch .. first_ch + n_ch - 1; count is the
+    * total number of values. width: DMA_WIDTH_16
+    * (16-bit timers only) or DMA_WIDTH_32.
+    *-------------------------------------------------*/
+int  pwm_wave_start(pwm_t *p, uint32_t first_ch, uint32_t n_ch,
+                    const void *buf, dma_width_t width, uint16_t count,
+                    uint32_t circular, pwm_wave_cb_t cb, void *ctx);
+void pwm_wave_stop(pwm_t *p);
+
+static inline uint32_t pwm_wave_busy(const pwm_t *p)
+{
+    return p->wave_busy;
+}
+
+#endif /* PWM_H */
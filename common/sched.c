@@ -0,0 +1,177 @@
+#include "stm32f4xx.h"
+#include "sched.h"
+
+typedef struct
+{
+    sched_fn_t fn;
+    void      *ctx;
+    uint32_t   prio;
+} sched_task_t;
+
+typedef struct
+{
+    uint8_t  task;
+    uint32_t arg;
+} sched_event_t;
+
+typedef struct
+{
+    sched_event_t     ev[SCHED_QUEUE_LEN];
+    volatile uint32_t head;                    /* written by sched_post */
+    volatile uint32_t tail;                    /* written by sched_run */
+} sched_queue_t;
+
+static sched_task_t  tasks[SCHED_MAX_TASKS];
+static sched_stats_t stats[SCHED_MAX_TASKS];
+static uint32_t      task_count = 0U;
+static sched_queue_t queues[SCHED_PRIO_LEVELS];
+static uint32_t      sleeps = 0U;
+
+void sched_init(void)
+{
+    uint32_t i;
+
+    task_count = 0U;
+    sleeps = 0U;
+
+    for (i = 0U; i < SCHED_PRIO_LEVELS; i++)
+    {
+        queues[i].head = 0U;
+        queues[i].tail = 0U;
+    }
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+int sched_task_add(sched_fn_t fn, uint32_t prio, void *ctx)
+{
+    sched_task_t *t;
+
+    if ((task_count >= SCHED_MAX_TASKS) || (prio >= SCHED_PRIO_LEVELS) || (fn == 0))
+    {
+        return SCHED_ERR_TASK;
+    }
+
+    t = &tasks[task_count];
+    t->fn = fn;
+    t->ctx = ctx;
+    t->prio = prio;
+
+    stats[task_count].runs = 0U;
+    stats[task_count].cycles = 0U;
+    stats[task_count].max_cycles = 0U;
+    stats[task_count].dropped = 0U;
+
+    return (int)task_count++;
+}
+
+   /*--------------------------------------------------
+    * Post from any context. Posts from ISRs of
+    * different priorities can nest, so the slot is
+    * claimed with IRQs masked (a few cycles).
+    *-------------------------------------------------*/
+int sched_post(int task, uint32_t arg)
+{
+    sched_queue_t *q;
+    uint32_t primask;
+
+    if ((task < 0) || ((uint32_t)task >= task_count))
+    {
+        return SCHED_ERR_TASK;
+    }
+
+    q = &queues[tasks[task].prio];
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((q->head - q->tail) >= SCHED_QUEUE_LEN)
+    {
+        stats[task].dropped++;
+        __set_PRIMASK(primask);
+        return SCHED_ERR_FULL;
+    }
+
+    q->ev[q->head & (SCHED_QUEUE_LEN - 1U)].task = (uint8_t)task;
+    q->ev[q->head & (SCHED_QUEUE_LEN - 1U)].arg = arg;
+    q->head++;
+
+    __set_PRIMASK(primask);
+
+    return SCHED_OK;
+}
+
+static sched_queue_t *sched_pick(void)
+{
+    uint32_t i;
+
+    for (i = 0U; i < SCHED_PRIO_LEVELS; i++)
+    {
+        if (queues[i].head != queues[i].tail)
+        {
+            return &queues[i];
+        }
+    }
+
+    return 0;
+}
+
+void sched_run(void)
+{
+    while (1)
+    {
+        sched_queue_t *q = sched_pick();
+
+        if (q != 0)
+        {
+            sched_event_t ev = q->ev[q->tail & (SCHED_QUEUE_LEN - 1U)];
+            sched_stats_t *st = &stats[ev.task];
+            uint32_t t0;
+            uint32_t dt;
+
+            q->tail++;
+
+            t0 = DWT->CYCCNT;
+            tasks[ev.task].fn(ev.arg, tasks[ev.task].ctx);
+            dt = DWT->CYCCNT - t0;
+
+            st->runs++;
+            st->cycles += dt;
+            if (dt > st->max_cycles)
+            {
+                st->max_cycles = dt;
+            }
+        }
+        else
+        {
+           /*--------------------------------------------------
+            * Sleep only if still nothing to do with IRQs
+            * masked: a pending IRQ wakes WFI even then and
+            * runs right after __enable_irq()
+            *-------------------------------------------------*/
+            __disable_irq();
+            if (sched_pick() == 0)
+            {
+                sleeps++;
+                __WFI();
+            }
+            __enable_irq();
+        }
+    }
+}
+
+const sched_stats_t *sched_stats(int task)
+{
+    if ((task < 0) || ((uint32_t)task >= task_count))
+    {
+        return 0;
+    }
+
+    return &stats[task];
+}
+
+uint32_t sched_sleeps(void)
+{
+    return sleeps;
+}
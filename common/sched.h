@@ -0,0 +1,56 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * Run-to-completion event scheduler
+    *
+    * ISRs (or tasks) post events with sched_post(),
+    * each event is queued on its task's priority level
+    * and runs the task function once with the posted
+    * argument. Two posts before the loop gets there
+    * are two events, nothing is lost the way a
+    * volatile flag set twice is.
+    *
+    * sched_run() never returns: it runs the oldest
+    * event of the highest non-empty level (0 first),
+    * and sleeps with __WFI() when all queues are empty.
+    * The empty check and the WFI are done with IRQs
+    * masked, so an event posted in between still wakes
+    * the core.
+    *
+    * Tasks must not block. Longer work is split up by
+    * posting to itself or to a lower level task.
+    * Run time per task is measured with DWT CYCCNT.
+    *-------------------------------------------------*/
+
+#define SCHED_MAX_TASKS    8U
+#define SCHED_PRIO_LEVELS  3U                  /* 0 = highest */
+#define SCHED_QUEUE_LEN    16U                 /* events per level, power of 2 */
+
+#define SCHED_OK           0
+#define SCHED_ERR_FULL    -1                   /* queue full, event dropped */
+#define SCHED_ERR_TASK    -2                   /* no such task / no slot left */
+
+typedef void (*sched_fn_t)(uint32_t arg, void *ctx);
+
+typedef struct
+{
+    uint32_t runs;
+    uint32_t cycles;                           /* total, wraps */
+    uint32_t max_cycles;
+    uint32_t dropped;                          /* posts lost to a full queue */
+} sched_stats_t;
+
+void sched_init(void);                         /* also starts DWT CYCCNT */
+int  sched_task_add(sched_fn_t fn, uint32_t prio, void *ctx);   /* task id or error */
+
+int  sched_post(int task, uint32_t arg);       /* main or ISR */
+
+void sched_run(void);                          /* does not return */
+
+const sched_stats_t *sched_stats(int task);
+uint32_t sched_sleeps(void);                   /* times the loop went to WFI */
+
+#endif /* SCHED_H */
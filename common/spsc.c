@@ -0,0 +1,65 @@
+#include "spsc.h"
+
+void spsc_bytes_init(spsc_bytes_t *q, uint8_t *buf, uint32_t size)
+{
+    q->idx.head = 0U;
+    q->idx.tail = 0U;
+    q->idx.high_water = 0U;
+    q->idx.dropped = 0U;
+    q->buf = buf;
+    q->size = size;
+}
+
+uint32_t spsc_bytes_write(spsc_bytes_t *q, const uint8_t *data, uint32_t n)
+{
+    uint32_t head = q->idx.head;
+    uint32_t space = q->size - (head - q->idx.tail);
+    uint32_t i;
+
+    if (n > space)
+    {
+        q->idx.dropped += n - space;
+        n = space;
+    }
+
+    for (i = 0U; i < n; i++)
+    {
+        q->buf[(head + i) & (q->size - 1U)] = data[i];
+    }
+
+    if (n != 0U)
+    {
+        spsc_idx_publish(&q->idx, head + n);
+    }
+
+    return n;
+}
+
+uint32_t spsc_bytes_read(spsc_bytes_t *q, uint8_t *out, uint32_t max)
+{
+    uint32_t tail = q->idx.tail;
+    uint32_t avail = q->idx.head - tail;
+    uint32_t i;
+
+    if (max > avail)
+    {
+        max = avail;
+    }
+
+    if (max == 0U)
+    {
+        return 0U;
+    }
+
+    SPSC_DMB();                                /* head before data */
+
+    for (i = 0U; i < max; i++)
+    {
+        out[i] = q->buf[(tail + i) & (q->size - 1U)];
+    }
+
+    SPSC_DMB();                                /* data before tail */
+    q->idx.tail = tail + max;
+
+    return max;
+}
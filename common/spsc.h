@@ -0,0 +1,157 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * Lock-free single-producer / single-consumer
+    * queues for ISR -> task (or task -> ISR) handoff
+    *
+    * head is written only by the producer, tail only
+    * by the consumer, so neither side needs LDREX /
+    * STREX or masked IRQs. The producer fills the slot
+    * before publishing head, the consumer reads the
+    * slot before releasing it through tail; SPSC_DMB()
+    * keeps that order for the compiler and the core.
+    *
+    * A full queue drops the new item and counts it in
+    * dropped. high_water is the highest fill level
+    * seen, both are written only by the producer.
+    *
+    * Three flavours:
+    *   SPSC_QUEUE_DEFINE()  typed fixed-size messages
+    *   spsc_bytes_t         byte stream, partial writes
+    *   spsc_ptr_t           pointer handoff (buffers)
+    *
+    * Lengths must be powers of 2. Several producers
+    * (e.g. ISRs of different priorities) need one queue
+    * each, or the scheduler's sched_post().
+    *
+    * common/host/spsc_stress.c runs all three on a PC,
+    * with threads and with a signal handler that
+    * preempts the consumer like an ISR.
+    *-------------------------------------------------*/
+
+#if defined(__arm__)
+#define SPSC_DMB()  __asm volatile ("dmb" ::: "memory")
+#else
+#define SPSC_DMB()  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+typedef struct
+{
+    volatile uint32_t head;                    /* producer */
+    volatile uint32_t tail;                    /* consumer */
+    volatile uint32_t high_water;              /* producer */
+    volatile uint32_t dropped;                 /* producer */
+} spsc_idx_t;
+
+static inline uint32_t spsc_idx_count(const spsc_idx_t *i)
+{
+    return i->head - i->tail;
+}
+
+   /* producer side after a successful push */
+static inline void spsc_idx_publish(spsc_idx_t *i, uint32_t head)
+{
+    uint32_t fill;
+
+    SPSC_DMB();                                /* slot written before head */
+    i->head = head;
+
+    fill = head - i->tail;
+    if (fill > i->high_water)
+    {
+        i->high_water = fill;
+    }
+}
+
+   /*--------------------------------------------------
+    * Typed message queue
+    *
+    *   SPSC_QUEUE_DEFINE(evt_q, awd_event_t, 16)
+    *   static evt_q_t q;
+    *   evt_q_push(&q, &e);  /  evt_q_pop(&q, &e);
+    *
+    * push / pop return 1 on success, 0 if full / empty.
+    *-------------------------------------------------*/
+#define SPSC_QUEUE_DEFINE(name, type, len)                                  \
+    typedef struct                                                          \
+    {                                                                       \
+        spsc_idx_t idx;                                                     \
+        type       buf[len];                                                \
+    } name##_t;                                                             \
+                                                                            \
+    _Static_assert(((len) & ((len) - 1U)) == 0U, #name ": len not 2^n");    \
+                                                                            \
+    static inline uint32_t name##_push(name##_t *q, type const *v)          \
+    {                                                                       \
+        uint32_t head = q->idx.head;                                        \
+                                                                            \
+        if ((head - q->idx.tail) >= (len))                                  \
+        {                                                                   \
+            q->idx.dropped++;                                               \
+            return 0U;                                                      \
+        }                                                                   \
+        q->buf[head & ((len) - 1U)] = *v;                                   \
+        spsc_idx_publish(&q->idx, head + 1U);                               \
+        return 1U;                                                          \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_pop(name##_t *q, type *v)                 \
+    {                                                                       \
+        uint32_t tail = q->idx.tail;                                        \
+                                                                            \
+        if (q->idx.head == tail)                                            \
+        {                                                                   \
+            return 0U;                                                      \
+        }                                                                   \
+        SPSC_DMB();                             /* head before slot */      \
+        *v = q->buf[tail & ((len) - 1U)];                                   \
+        SPSC_DMB();                             /* slot before tail */      \
+        q->idx.tail = tail + 1U;                                            \
+        return 1U;                                                          \
+    }                                                                       \
+                                                                            \
+    static inline uint32_t name##_count(const name##_t *q)                  \
+    {                                                                       \
+        return spsc_idx_count(&q->idx);                                     \
+    }
+
+   /*--------------------------------------------------
+    * Pointer handoff, e.g. filled DMA blocks from an
+    * ISR to the task that consumes and frees them
+    *-------------------------------------------------*/
+#define SPSC_PTR_LEN  16U
+
+SPSC_QUEUE_DEFINE(spsc_ptr, void *, SPSC_PTR_LEN)
+
+   /*--------------------------------------------------
+    * Byte stream over a caller-provided buffer
+    *
+    * spsc_bytes_write() stores as much as fits and
+    * counts the rest in dropped, spsc_bytes_read()
+    * returns up to max bytes.
+    *-------------------------------------------------*/
+typedef struct
+{
+    spsc_idx_t idx;
+    uint8_t   *buf;
+    uint32_t   size;                           /* power of 2 */
+} spsc_bytes_t;
+
+void     spsc_bytes_init(spsc_bytes_t *q, uint8_t *buf, uint32_t size);
+uint32_t spsc_bytes_write(spsc_bytes_t *q, const uint8_t *data, uint32_t n);
+uint32_t spsc_bytes_read(spsc_bytes_t *q, uint8_t *out, uint32_t max);
+
+static inline uint32_t spsc_bytes_put(spsc_bytes_t *q, uint8_t b)
+{
+    return spsc_bytes_write(q, &b, 1U);
+}
+
+static inline uint32_t spsc_bytes_count(const spsc_bytes_t *q)
+{
+    return spsc_idx_count(&q->idx);
+}
+
+#endif /* SPSC_H */
@@ -0,0 +1,275 @@
+#include "swtimer.h"
+
+static swtimer_t *heap[SWTIMER_MAX];
+static uint32_t heap_len = 0U;
+static volatile uint32_t tb_high = 0U;        /* TIM5 wraps */
+
+   /* a before b, wrap-safe */
+static int earlier(const swtimer_t *a, const swtimer_t *b)
+{
+    return (int32_t)(a->deadline - b->deadline) < 0;
+}
+
+static void heap_set(uint32_t i, swtimer_t *t)
+{
+    heap[i] = t;
+    t->slot = (int32_t)i;
+}
+
+static void sift_up(uint32_t i)
+{
+    swtimer_t *t = heap[i];
+
+    while (i > 0U)
+    {
+        uint32_t parent = (i - 1U) / 2U;
+
+        if (!earlier(t, heap[parent]))
+        {
+            break;
+        }
+        heap_set(i, heap[parent]);
+        i = parent;
+    }
+
+    heap_set(i, t);
+}
+
+static void sift_down(uint32_t i)
+{
+    swtimer_t *t = heap[i];
+
+    while (1)
+    {
+        uint32_t child = (2U * i) + 1U;
+
+        if (child >= heap_len)
+        {
+            break;
+        }
+        if (((child + 1U) < heap_len) && earlier(heap[child + 1U], heap[child]))
+        {
+            child++;
+        }
+        if (!earlier(heap[child], t))
+        {
+            break;
+        }
+        heap_set(i, heap[child]);
+        i = child;
+    }
+
+    heap_set(i, t);
+}
+
+static void heap_remove(uint32_t i)
+{
+    swtimer_t *t = heap[i];
+
+    heap_len--;
+
+    if (i != heap_len)
+    {
+        heap_set(i, heap[heap_len]);
+
+        if ((i > 0U) && earlier(heap[i], heap[(i - 1U) / 2U]))
+        {
+            sift_up(i);
+        }
+        else
+        {
+            sift_down(i);
+        }
+    }
+
+    t->slot = -1;
+}
+
+   /*--------------------------------------------------
+    * Point CC1 at the earliest deadline (IRQs masked).
+    * If it has already passed, CC1G raises the flag by
+    * software so it is not missed by a full wrap.
+    *-------------------------------------------------*/
+static void arm_compare(void)
+{
+    if (heap_len == 0U)
+    {
+        TIM5->DIER &= ~TIM_DIER_CC1IE;
+        return;
+    }
+
+    TIM5->CCR1 = heap[0]->deadline;
+    TIM5->SR = ~TIM_SR_CC1IF;
+    TIM5->DIER |= TIM_DIER_CC1IE;
+
+    if ((int32_t)(heap[0]->deadline - TIM5->CNT) <= 0)
+    {
+        TIM5->EGR = TIM_EGR_CC1G;
+    }
+}
+
+void timebase_init(void)
+{
+    RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+
+    TIM5->CR1 = 0U;
+    TIM5->PSC = (SystemCoreClock / TIMEBASE_HZ) - 1U;
+    TIM5->ARR = 0xFFFFFFFFU;
+    TIM5->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M);   /* output compare, frozen */
+    TIM5->DIER = 0U;
+    TIM5->EGR = TIM_EGR_UG;                    /* load PSC */
+    TIM5->SR = 0U;
+    TIM5->CNT = 0U;
+    TIM5->DIER = TIM_DIER_UIE;                 /* count wraps */
+
+    heap_len = 0U;
+    tb_high = 0U;
+
+    NVIC_EnableIRQ(TIM5_IRQn);
+
+    TIM5->CR1 |= TIM_CR1_CEN;
+}
+
+   /*--------------------------------------------------
+    * Read high, CNT, UIF until high is stable. A set
+    * UIF with a small CNT is a wrap whose interrupt is
+    * still pending; with a large CNT the wrap came
+    * after CNT was read and does not count yet.
+    *-------------------------------------------------*/
+uint64_t timebase_now64(void)
+{
+    uint32_t high;
+    uint32_t low;
+    uint32_t wrap;
+
+    do
+    {
+        high = tb_high;
+        low = TIM5->CNT;
+        wrap = TIM5->SR & TIM_SR_UIF;
+    } while (high != tb_high);
+
+    if ((wrap != 0U) && (low < 0x80000000U))
+    {
+        high++;
+    }
+
+    return ((uint64_t)high << 32) | low;
+}
+
+void swtimer_init(swtimer_t *t, swtimer_fn_t fn, void *ctx)
+{
+    t->deadline = 0U;
+    t->period = 0U;
+    t->fn = fn;
+    t->ctx = ctx;
+    t->slot = -1;
+}
+
+int swtimer_start_at(swtimer_t *t, uint32_t deadline, uint32_t period_us)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (t->slot >= 0)
+    {
+        heap_remove((uint32_t)t->slot);
+    }
+    else if (heap_len >= SWTIMER_MAX)
+    {
+        __set_PRIMASK(primask);
+        return -1;
+    }
+
+    t->deadline = deadline;
+    t->period = period_us;
+
+    heap[heap_len] = t;
+    heap_len++;
+    sift_up(heap_len - 1U);
+
+    if (heap[0] == t)
+    {
+        arm_compare();
+    }
+
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+int swtimer_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us)
+{
+    return swtimer_start_at(t, timebase_now() + delay_us, period_us);
+}
+
+void swtimer_stop(swtimer_t *t)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    if (t->slot >= 0)
+    {
+        uint32_t was_first = (t->slot == 0) ? 1U : 0U;
+
+        heap_remove((uint32_t)t->slot);
+
+        if (was_first)
+        {
+            arm_compare();
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+   /*--------------------------------------------------
+    * TIM5 update: count the wrap. CC1: run every timer
+    * that is due, then arm the compare for the next one
+    *-------------------------------------------------*/
+void TIM5_IRQHandler(void)
+{
+    if (TIM5->SR & TIM_SR_UIF)
+    {
+        /* one step for a higher priority timebase_now64() */
+        __disable_irq();
+        TIM5->SR = ~TIM_SR_UIF;
+        __DSB();                               /* flag really clear */
+        tb_high++;
+        __enable_irq();
+    }
+
+    if (!(TIM5->SR & TIM_SR_CC1IF))
+    {
+        return;
+    }
+
+    TIM5->SR = ~TIM_SR_CC1IF;
+
+    __disable_irq();
+
+    while ((heap_len != 0U) && ((int32_t)(heap[0]->deadline - TIM5->CNT) <= 0))
+    {
+        swtimer_t *t = heap[0];
+
+        heap_remove(0U);
+
+        if (t->period != 0U)
+        {
+            t->deadline += t->period;
+            heap[heap_len] = t;
+            heap_len++;
+            sift_up(heap_len - 1U);
+        }
+
+        __enable_irq();
+        t->fn(t, t->ctx);                      /* may start / stop timers */
+        __disable_irq();
+    }
+
+    arm_compare();
+
+    __enable_irq();
+}
@@ -0,0 +1,70 @@
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Tickless timebase and software timers on TIM5
+    *
+    * TIM5 (32-bit) free-runs at 1 MHz: timebase_now()
+    * is the time in microseconds, wrapping after about
+    * 71 minutes. timebase_now64() extends it with a
+    * count of TIM5 updates to 64 bits, which does not
+    * wrap in practice. There is no periodic tick: compare
+    * channel 1 is set to the earliest pending deadline
+    * and TIM5 interrupts only when a timer expires (and
+    * once per 71 minute wrap), so an idle system takes
+    * almost no interrupts.
+    *
+    * timebase_now64() takes no lock and can be called
+    * from threads and from any ISR, also with IRQs
+    * masked: if the wrap has happened but its update
+    * interrupt has not run yet, the pending UIF flag
+    * is counted instead.
+    *
+    * Pending timers are kept in a binary min-heap on
+    * the deadline (O(log n) start / stop / expire).
+    * Deadlines are compared as signed differences, so
+    * a delay or period must stay below 2^31 us.
+    *
+    * Callbacks run in the TIM5 interrupt. A periodic
+    * timer is re-armed at deadline + period before its
+    * callback runs, so it does not drift.
+    *-------------------------------------------------*/
+
+#define TIMEBASE_HZ   1000000U
+#define SWTIMER_MAX   16U
+
+typedef struct swtimer swtimer_t;
+
+typedef void (*swtimer_fn_t)(swtimer_t *t, void *ctx);
+
+struct swtimer
+{
+    uint32_t     deadline;                     /* timebase_now() units */
+    uint32_t     period;                       /* 0 = one-shot */
+    swtimer_fn_t fn;
+    void        *ctx;
+    int32_t      slot;                         /* heap index, -1 = not pending */
+};
+
+void     timebase_init(void);                  /* TIM5 running, timers empty */
+
+static inline uint32_t timebase_now(void)
+{
+    return TIM5->CNT;
+}
+
+uint64_t timebase_now64(void);                 /* us since timebase_init() */
+
+void swtimer_init(swtimer_t *t, swtimer_fn_t fn, void *ctx);
+int  swtimer_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us);  /* 0 / -1 full */
+int  swtimer_start_at(swtimer_t *t, uint32_t deadline, uint32_t period_us);
+void swtimer_stop(swtimer_t *t);
+
+static inline uint32_t swtimer_pending(const swtimer_t *t)
+{
+    return (t->slot >= 0) ? 1U : 0U;
+}
+
+#endif /* SWTIMER_H */
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Symbolize the crash record printed by fault_report() (common/fault.c).
+
+Reads a USART log, picks up the FAULT lines and prints the fault type,
+the CFSR / HFSR bits that are set and pc, lr and the backtrace as
+function + source line, through arm-none-eabi-addr2line on the .elf the
+board was flashed with.
+
+Return addresses (lr, backtrace) point after the call, so 1 is taken
+off (plus the Thumb bit) to land on the calling instruction.
+
+usage: python3 common/tools/fault_decode.py build/app.elf [log.txt]
+       (the log is read from stdin without a file)
+"""
+import re
+import subprocess
+import sys
+
+ADDR2LINE = "arm-none-eabi-addr2line"
+
+FLASH_START = 0x08000000
+FLASH_END = 0x08080000
+
+CFSR_BITS = [
+    (0, "IACCVIOL: instruction fetch from a no-execute / protected region"),
+    (1, "DACCVIOL: data access violation (address in MMFAR)"),
+    (3, "MUNSTKERR: MemManage on exception return unstacking"),
+    (4, "MSTKERR: MemManage on exception entry stacking"),
+    (5, "MLSPERR: MemManage during lazy FP state save"),
+    (7, "MMARVALID: MMFAR holds the faulting address"),
+    (8, "IBUSERR: bus error on instruction fetch"),
+    (9, "PRECISERR: precise data bus error (address in BFAR)"),
+    (10, "IMPRECISERR: imprecise data bus error, pc is after the access"),
+    (11, "UNSTKERR: bus error on exception return unstacking"),
+    (12, "STKERR: bus error on exception entry stacking (stack overflow?)"),
+    (13, "LSPERR: bus error during lazy FP state save"),
+    (15, "BFARVALID: BFAR holds the faulting address"),
+    (16, "UNDEFINSTR: undefined instruction"),
+    (17, "INVSTATE: invalid EPSR state (call through an even address?)"),
+    (18, "INVPC: invalid EXC_RETURN / integrity check on return"),
+    (19, "NOCP: coprocessor access (FPU off?)"),
+    (24, "UNALIGNED: unaligned access trap"),
+    (25, "DIVBYZERO: integer division by zero"),
+]
+
+HFSR_BITS = [
+    (1, "VECTTBL: bus fault on vector table read"),
+    (30, "FORCED: escalated from a configurable fault (see CFSR)"),
+    (31, "DEBUGEVT: debug event"),
+]
+
+FIELD = re.compile(r"(\w+)=(0x[0-9a-fA-F]+)")
+
+
+def parse(lines):
+    """Fields of the last complete record in the log."""
+    rec = None
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("FAULT"):
+            continue
+        words = line.split()
+        if len(words) >= 2 and "=" not in words[1]:
+            rec = {"type": words[1], "bt": []}
+        if rec is None:
+            continue
+        if line.startswith("FAULT bt="):
+            rec["bt"] = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", line)]
+            continue
+        for name, value in FIELD.findall(line):
+            rec[name] = int(value, 16)
+    return rec
+
+
+def symbolize(elf, addrs):
+    if not addrs:
+        return []
+    args = [ADDR2LINE, "-e", elf, "-f", "-p", "-C", "-a"] + ["0x%08x" % a for a in addrs]
+    out = subprocess.run(args, check=True, capture_output=True, text=True).stdout
+    return [l for l in out.splitlines() if l.startswith("0x")]
+
+
+def in_flash(a):
+    return FLASH_START <= a < FLASH_END
+
+
+def bits(value, table):
+    return [text for bit, text in table if value & (1 << bit)]
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+
+    elf = sys.argv[1]
+    src = open(sys.argv[2]) if len(sys.argv) > 2 else sys.stdin
+    rec = parse(src)
+    if rec is None:
+        sys.exit("no FAULT record in the log")
+
+    print("%s (fault #%d)" % (rec["type"], rec.get("count", 0)))
+    for text in bits(rec.get("cfsr", 0), CFSR_BITS) + bits(rec.get("hfsr", 0), HFSR_BITS):
+        print("  " + text)
+    if rec.get("cfsr", 0) & (1 << 7):
+        print("  MMFAR = 0x%08x" % rec["mmfar"])
+    if rec.get("cfsr", 0) & (1 << 15):
+        print("  BFAR  = 0x%08x" % rec["bfar"])
+    print("  sp = 0x%08x  exc_return = 0x%08x" % (rec.get("sp", 0), rec.get("exc", 0)))
+
+    sites = []
+    if in_flash(rec.get("pc", 0)):
+        sites.append(("pc", rec["pc"]))
+    if in_flash(rec.get("lr", 0)):
+        sites.append(("lr", (rec["lr"] & ~1) - 1))
+    for i, a in enumerate(rec["bt"]):
+        sites.append(("#%d" % i, (a & ~1) - 1))
+
+    print("")
+    for (label, _), line in zip(sites, symbolize(elf, [a for _, a in sites])):
+        print("%-3s %s" % (label, line))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,192 @@
+#include "tsync.h"
+
+#define LAG_TICKS  16U                         /* hi counts a wrap a few clocks late */
+
+   /*--------------------------------------------------
+    * ITR0..3 master of each slave, F401 (no TIM8):
+    * 0 = nothing on that input
+    *-------------------------------------------------*/
+typedef struct
+{
+    uint32_t slave;
+    uint32_t itr[4];
+} itr_map_t;
+
+static const itr_map_t itr_map[] =
+{
+    { TIM1_BASE, { TIM5_BASE, TIM2_BASE, TIM3_BASE, TIM4_BASE } },
+    { TIM2_BASE, { TIM1_BASE, 0U,        TIM3_BASE, TIM4_BASE } },
+    { TIM3_BASE, { TIM1_BASE, TIM2_BASE, TIM5_BASE, TIM4_BASE } },
+    { TIM4_BASE, { TIM1_BASE, TIM2_BASE, TIM3_BASE, 0U        } },
+    { TIM5_BASE, { TIM2_BASE, TIM3_BASE, TIM4_BASE, 0U        } },
+    { TIM9_BASE, { TIM2_BASE, TIM3_BASE, 0U,        0U        } },   /* ITR2/3: TIM10/11 OC */
+};
+
+#define ITR_MAP_LEN  (sizeof(itr_map) / sizeof(itr_map[0]))
+
+int tsync_itr(TIM_TypeDef *slave, TIM_TypeDef *master, uint32_t *ts)
+{
+    uint32_t i;
+    uint32_t k;
+
+    for (i = 0U; i < ITR_MAP_LEN; i++)
+    {
+        if (itr_map[i].slave != (uint32_t)slave)
+        {
+            continue;
+        }
+
+        for (k = 0U; k < 4U; k++)
+        {
+            if (itr_map[i].itr[k] == (uint32_t)master)
+            {
+                *ts = k;
+                return TSYNC_OK;
+            }
+        }
+    }
+
+    return TSYNC_ERR_CONFIG;
+}
+
+static void tim_clock(TIM_TypeDef *tim)
+{
+    if      (tim == TIM1) { RCC->APB2ENR |= RCC_APB2ENR_TIM1EN; }
+    else if (tim == TIM2) { RCC->APB1ENR |= RCC_APB1ENR_TIM2EN; }
+    else if (tim == TIM3) { RCC->APB1ENR |= RCC_APB1ENR_TIM3EN; }
+    else if (tim == TIM4) { RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; }
+    else if (tim == TIM5) { RCC->APB1ENR |= RCC_APB1ENR_TIM5EN; }
+    else if (tim == TIM9) { RCC->APB2ENR |= RCC_APB2ENR_TIM9EN; }
+    else
+    {
+        /* TIM10 / TIM11 have no master / slave controller */
+    }
+}
+
+void tsync_master(TIM_TypeDef *tim, tsync_trgo_t trgo, uint32_t msm)
+{
+    tim->CR2 = (tim->CR2 & ~TIM_CR2_MMS) | ((uint32_t)trgo << TIM_CR2_MMS_Pos);
+
+    if (msm)
+    {
+        tim->SMCR |= TIM_SMCR_MSM;             /* delay own trigger effect to match slaves */
+    }
+    else
+    {
+        tim->SMCR &= ~TIM_SMCR_MSM;
+    }
+}
+
+int tsync_slave(TIM_TypeDef *slave, TIM_TypeDef *master, tsync_slave_t mode)
+{
+    uint32_t ts;
+
+    if (tsync_itr(slave, master, &ts) != TSYNC_OK)
+    {
+        return TSYNC_ERR_CONFIG;
+    }
+
+    /* TS must be set while SMS is off (RM0368 13.4.3) */
+    slave->SMCR &= ~TIM_SMCR_SMS;
+    slave->SMCR = (slave->SMCR & ~TIM_SMCR_TS) | (ts << TIM_SMCR_TS_Pos);
+    slave->SMCR |= (uint32_t)mode << TIM_SMCR_SMS_Pos;
+
+    return TSYNC_OK;
+}
+
+   /*--------------------------------------------------
+    * All timers stopped and programmed (PSC / ARR /
+    * channels). Each slave gets PSC / ARR loaded by UG,
+    * then its phase in CNT, and waits for the master's
+    * CEN. tsync_start() releases the whole group.
+    *-------------------------------------------------*/
+int tsync_group(TIM_TypeDef *master, TIM_TypeDef *const *slaves,
+                const uint32_t *phase, uint32_t n)
+{
+    uint32_t i;
+
+    master->CR1 &= ~TIM_CR1_CEN;
+
+    for (i = 0U; i < n; i++)
+    {
+        TIM_TypeDef *s = slaves[i];
+
+        s->CR1 &= ~TIM_CR1_CEN;
+
+        if (tsync_slave(s, master, TSYNC_SLAVE_TRIGGER) != TSYNC_OK)
+        {
+            return TSYNC_ERR_CONFIG;
+        }
+
+        s->EGR = TIM_EGR_UG;
+        s->CNT = (phase != 0) ? phase[i] : 0U;
+        s->SR = 0U;
+    }
+
+    /* started by software CEN, not TRGI: MSM would change nothing */
+    tsync_master(master, TSYNC_TRGO_ENABLE, 0U);
+
+    master->EGR = TIM_EGR_UG;
+    master->CNT = 0U;
+    master->SR = 0U;
+
+    return TSYNC_OK;
+}
+
+int tsync_cascade_init(tsync_cascade_t *c, TIM_TypeDef *lo, TIM_TypeDef *hi)
+{
+    if ((lo != TIM2) && (lo != TIM5))
+    {
+        return TSYNC_ERR_CONFIG;
+    }
+
+    tim_clock(lo);
+    tim_clock(hi);
+
+    lo->CR1 = 0U;
+    hi->CR1 = 0U;
+
+    if (tsync_slave(hi, lo, TSYNC_SLAVE_EXT_CLK) != TSYNC_OK)
+    {
+        return TSYNC_ERR_CONFIG;
+    }
+
+    hi->PSC = 0U;
+    hi->ARR = 0xFFFFU;
+    hi->EGR = TIM_EGR_UG;
+    hi->CNT = 0U;
+    hi->CR1 = TIM_CR1_CEN;                     /* clocked by lo overflows only */
+
+    tsync_master(lo, TSYNC_TRGO_UPDATE, 0U);
+    lo->PSC = 0U;
+    lo->ARR = 0xFFFFFFFFU;
+    lo->EGR = TIM_EGR_UG;                      /* an update too: hi counts it */
+    lo->CNT = 0U;
+    hi->CNT = 0U;
+    lo->CR1 = TIM_CR1_CEN;
+
+    c->lo = lo;
+    c->hi = hi;
+
+    return TSYNC_OK;
+}
+
+   /*--------------------------------------------------
+    * hi, lo, hi until hi is stable. Right after a lo
+    * wrap hi may not have counted it yet (trigger
+    * resynchronization), so a lo value that small is
+    * read again a few ticks later.
+    *-------------------------------------------------*/
+uint64_t tsync_cascade_read(const tsync_cascade_t *c)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do
+    {
+        hi = c->hi->CNT;
+        lo = c->lo->CNT;
+    } while ((lo < LAG_TICKS) || (hi != c->hi->CNT));
+
+    return ((uint64_t)(hi & 0xFFFFU) << 32) | lo;
+}
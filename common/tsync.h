@@ -0,0 +1,82 @@
+#ifndef TSYNC_H
+#define TSYNC_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Timer chaining: master / slave links, grouped
+    * start, 48-bit cascade
+    *
+    * A master sends TRGO (CR2.MMS); a slave selects it
+    * as trigger through one of its four internal
+    * trigger inputs ITR0..3 (SMCR.TS) and reacts with
+    * its slave mode (SMCR.SMS). Which master sits on
+    * which ITR is fixed per timer (RM0368 tables 54,
+    * 58, 62); tsync_slave() looks it up.
+    *
+    * Grouped start: the master sends ENABLE as TRGO,
+    * every slave is in trigger mode. Setting CEN on
+    * the master sets CEN on all slaves a few clocks
+    * later: TRGO is resynchronized at each slave's
+    * trigger input. The lag is fixed for a given pair
+    * and clock tree, the same on every start, so it
+    * can be folded into the phase. MSM does not help
+    * here: it only delays the master's reaction to
+    * its own TRGI, not a software CEN. Preloading a
+    * slave's CNT before the start gives it a fixed
+    * phase offset (ADC trigger, PWM and capture
+    * windows stay aligned for good).
+    *
+    * Cascade: the low timer sends UPDATE as TRGO, the
+    * high timer counts it in external clock mode 1, so
+    * a 32-bit TIM2 / TIM5 plus a 16-bit timer count 48
+    * bits at full clock (over 200 days at 16 MHz).
+    *-------------------------------------------------*/
+
+#define TSYNC_OK           0
+#define TSYNC_ERR_CONFIG  -1                   /* no ITR from this master to this slave */
+
+typedef enum
+{
+    TSYNC_TRGO_RESET = 0,                      /* UG */
+    TSYNC_TRGO_ENABLE,                         /* CEN */
+    TSYNC_TRGO_UPDATE,                         /* overflow / underflow */
+    TSYNC_TRGO_COMPARE_PULSE,                  /* CC1IF */
+    TSYNC_TRGO_OC1REF,
+    TSYNC_TRGO_OC2REF,
+    TSYNC_TRGO_OC3REF,
+    TSYNC_TRGO_OC4REF
+} tsync_trgo_t;
+
+typedef enum
+{
+    TSYNC_SLAVE_OFF     = 0,
+    TSYNC_SLAVE_RESET   = 4,                   /* trigger re-initializes CNT */
+    TSYNC_SLAVE_GATED   = 5,                   /* counts while trigger is high */
+    TSYNC_SLAVE_TRIGGER = 6,                   /* trigger sets CEN */
+    TSYNC_SLAVE_EXT_CLK = 7                    /* trigger edges clock the counter */
+} tsync_slave_t;
+
+typedef struct
+{
+    TIM_TypeDef *lo;                           /* 32-bit: TIM2 or TIM5 */
+    TIM_TypeDef *hi;                           /* counts lo overflows */
+} tsync_cascade_t;
+
+void tsync_master(TIM_TypeDef *tim, tsync_trgo_t trgo, uint32_t msm);
+int  tsync_slave(TIM_TypeDef *slave, TIM_TypeDef *master, tsync_slave_t mode);
+int  tsync_itr(TIM_TypeDef *slave, TIM_TypeDef *master, uint32_t *ts);
+
+   /* slaves[i] starts with CNT = phase[i] (phase may be 0) */
+int  tsync_group(TIM_TypeDef *master, TIM_TypeDef *const *slaves,
+                 const uint32_t *phase, uint32_t n);
+
+static inline void tsync_start(TIM_TypeDef *master)
+{
+    master->CR1 |= TIM_CR1_CEN;                /* slaves follow a fixed few clocks later */
+}
+
+int      tsync_cascade_init(tsync_cascade_t *c, TIM_TypeDef *lo, TIM_TypeDef *hi);
+uint64_t tsync_cascade_read(const tsync_cascade_t *c);
+
+#endif /* TSYNC_H */
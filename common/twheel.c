@@ -0,0 +1,310 @@
+#include "twheel.h"
+
+#define SLOT_MASK      (TWHEEL_SLOTS - 1U)
+#define LEVEL_EXPIRED  0xFFU
+
+   /*--------------------------------------------------
+    * Intrusive singly linked list with back pointer:
+    * unlink in O(1) without knowing the list head
+    *-------------------------------------------------*/
+static void list_add(twheel_timer_t **head, twheel_timer_t *t)
+{
+    t->next = *head;
+    if (t->next != 0)
+    {
+        t->next->pprev = &t->next;
+    }
+    *head = t;
+    t->pprev = head;
+}
+
+static void list_del(twheel_timer_t *t)
+{
+    *t->pprev = t->next;
+    if (t->next != 0)
+    {
+        t->next->pprev = t->pprev;
+    }
+    t->next = 0;
+    t->pprev = 0;
+}
+
+static void used_set(twheel_t *w, uint32_t level, uint32_t idx)
+{
+    w->used[level][idx >> 5U] |= 1UL << (idx & 31U);
+}
+
+static void used_clear(twheel_t *w, uint32_t level, uint32_t idx)
+{
+    w->used[level][idx >> 5U] &= ~(1UL << (idx & 31U));
+}
+
+   /*--------------------------------------------------
+    * Place t relative to the next tick to process,
+    * base = now + 1. Level L holds deltas below
+    * 64^(L+1); its slot is picked by expiry bits
+    * 6L..6L+5, and it is cascaded at the tick where
+    * those bits are reached with all lower bits zero.
+    *-------------------------------------------------*/
+static void wheel_add(twheel_t *w, twheel_timer_t *t)
+{
+    uint32_t base = w->now + 1U;
+    uint32_t delta = t->expires - base;
+    uint32_t level = 0U;
+    uint32_t idx;
+
+    if ((int32_t)delta < 0)
+    {
+        t->expires = base;                     /* already due: next tick */
+        delta = 0U;
+    }
+    else if (delta > TWHEEL_MAX)
+    {
+        t->expires = base + TWHEEL_MAX;
+        delta = TWHEEL_MAX;
+    }
+
+    while ((level < (TWHEEL_LEVELS - 1U)) &&
+           (delta >= (1UL << (TWHEEL_BITS * (level + 1U)))))
+    {
+        level++;
+    }
+
+    idx = (t->expires >> (TWHEEL_BITS * level)) & SLOT_MASK;
+
+    list_add(&w->slot[level][idx], t);
+    used_set(w, level, idx);
+    t->level = (uint8_t)level;
+    t->index = (uint8_t)idx;
+    w->armed++;
+}
+
+static void wheel_del(twheel_t *w, twheel_timer_t *t)
+{
+    if (t->level == LEVEL_EXPIRED)
+    {
+        list_del(t);
+        return;
+    }
+
+    list_del(t);
+    if (w->slot[t->level][t->index] == 0)
+    {
+        used_clear(w, t->level, t->index);
+    }
+    w->armed--;
+}
+
+static void cascade(twheel_t *w, uint32_t level, uint32_t idx)
+{
+    twheel_timer_t *t = w->slot[level][idx];
+
+    w->slot[level][idx] = 0;
+    used_clear(w, level, idx);
+
+    while (t != 0)
+    {
+        twheel_timer_t *next = t->next;
+
+        t->next = 0;
+        t->pprev = 0;
+        w->armed--;
+        wheel_add(w, t);
+        t = next;
+    }
+}
+
+void twheel_init(twheel_t *w, uint32_t now)
+{
+    uint32_t l;
+    uint32_t i;
+
+    for (l = 0U; l < TWHEEL_LEVELS; l++)
+    {
+        for (i = 0U; i < TWHEEL_SLOTS; i++)
+        {
+            w->slot[l][i] = 0;
+        }
+        w->used[l][0] = 0U;
+        w->used[l][1] = 0U;
+    }
+
+    w->expired = 0;
+    w->now = now;
+    w->armed = 0U;
+}
+
+void twheel_timer_init(twheel_timer_t *t, twheel_fn_t fn, void *ctx)
+{
+    t->next = 0;
+    t->pprev = 0;
+    t->expires = 0U;
+    t->fn = fn;
+    t->ctx = ctx;
+    t->level = 0U;
+    t->index = 0U;
+}
+
+void twheel_arm(twheel_t *w, twheel_timer_t *t, uint32_t delay)
+{
+    twheel_arm_coalesced(w, t, delay, 1U);
+}
+
+void twheel_arm_coalesced(twheel_t *w, twheel_timer_t *t, uint32_t delay, uint32_t granule)
+{
+    uint32_t expires = w->now + delay;
+
+    if (t->pprev != 0)
+    {
+        wheel_del(w, t);
+    }
+
+    if (granule > 1U)
+    {
+        expires += granule - 1U;
+        expires -= expires % granule;
+    }
+
+    t->expires = expires;
+    wheel_add(w, t);
+}
+
+void twheel_cancel(twheel_t *w, twheel_timer_t *t)
+{
+    if (t->pprev != 0)
+    {
+        wheel_del(w, t);
+    }
+}
+
+   /*--------------------------------------------------
+    * Process ticks now+1 .. target. Runs of ticks with
+    * an empty level 0 are skipped up to the next
+    * 64-tick boundary, where a cascade may refill it.
+    *-------------------------------------------------*/
+uint32_t twheel_advance(twheel_t *w, uint32_t target)
+{
+    uint32_t n = 0U;
+
+    while ((int32_t)(target - w->now) > 0)
+    {
+        uint32_t t = w->now + 1U;
+        twheel_timer_t *e;
+
+        if (w->armed == 0U)
+        {
+            w->now = target;
+            break;
+        }
+
+        if (((t & SLOT_MASK) != 0U) && ((w->used[0][0] | w->used[0][1]) == 0U))
+        {
+            uint32_t boundary = (t | SLOT_MASK) + 1U;
+
+            if ((int32_t)(target - boundary) < 0)
+            {
+                w->now = target;
+                break;
+            }
+            w->now = boundary - 1U;
+            continue;
+        }
+
+        if ((t & SLOT_MASK) == 0U)
+        {
+            uint32_t level;
+
+            /* level 1 first; a higher level only when the one below wrapped */
+            for (level = 1U; level < TWHEEL_LEVELS; level++)
+            {
+                uint32_t idx = (t >> (TWHEEL_BITS * level)) & SLOT_MASK;
+
+                cascade(w, level, idx);
+                if (idx != 0U)
+                {
+                    break;
+                }
+            }
+        }
+
+        w->now = t;
+
+        e = w->slot[0][t & SLOT_MASK];
+        w->slot[0][t & SLOT_MASK] = 0;
+        used_clear(w, 0U, t & SLOT_MASK);
+
+        while (e != 0)
+        {
+            twheel_timer_t *next = e->next;
+
+            list_add(&w->expired, e);
+            e->level = LEVEL_EXPIRED;
+            w->armed--;
+            n++;
+            e = next;
+        }
+    }
+
+    return n;
+}
+
+uint32_t twheel_dispatch(twheel_t *w)
+{
+    uint32_t n = 0U;
+
+    while (w->expired != 0)
+    {
+        twheel_timer_t *t = w->expired;
+
+        list_del(t);
+        t->fn(t, t->ctx);                      /* may re-arm t or cancel others */
+        n++;
+    }
+
+    return n;
+}
+
+   /*--------------------------------------------------
+    * Ticks from now to the next tick that needs
+    * processing: exact for level 0, but never past the
+    * next 64-tick boundary while a higher level holds
+    * timers, because the cascade there may bring in
+    * ones due before the next level 0 slot
+    *-------------------------------------------------*/
+uint32_t twheel_next(const twheel_t *w)
+{
+    uint32_t boundary = ((w->now | SLOT_MASK) + 1U) - w->now;
+    uint32_t higher = 0U;
+    uint32_t start;
+    uint32_t l;
+    uint32_t k;
+
+    if (w->expired != 0)
+    {
+        return 0U;
+    }
+
+    if (w->armed == 0U)
+    {
+        return TWHEEL_IDLE;
+    }
+
+    for (l = 1U; l < TWHEEL_LEVELS; l++)
+    {
+        higher |= w->used[l][0] | w->used[l][1];
+    }
+
+    start = (w->now + 1U) & SLOT_MASK;
+
+    for (k = 0U; k < TWHEEL_SLOTS; k++)
+    {
+        uint32_t idx = (start + k) & SLOT_MASK;
+
+        if (w->used[0][idx >> 5U] & (1UL << (idx & 31U)))
+        {
+            return ((higher != 0U) && ((k + 1U) > boundary)) ? boundary : (k + 1U);
+        }
+    }
+
+    return boundary;
+}
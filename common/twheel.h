@@ -0,0 +1,77 @@
+#ifndef TWHEEL_H
+#define TWHEEL_H
+
+#include <stdint.h>
+
+   /*--------------------------------------------------
+    * Hierarchical timer wheel
+    *
+    * 4 levels of 64 slots: level 0 holds timers due in
+    * the next 64 ticks, level 1 the next 64^2 and so
+    * on, 2^24 ticks in total (4.6 h at 1 ms). Timers
+    * are intrusive list nodes, so arm and cancel are
+    * O(1) and need no allocation; a higher level slot
+    * is moved down ("cascaded") once, when the lower
+    * level wraps onto it.
+    *
+    * The wheel does not touch hardware. The owner
+    * feeds it ticks with twheel_advance(), which moves
+    * due timers to an expired list, and runs their
+    * callbacks with twheel_dispatch() from task
+    * context. twheel_next() tells a tickless driver how
+    * long it may sleep. All calls for one wheel must
+    * come from one context (e.g. one scheduler task).
+    *
+    * Coalescing: twheel_arm_coalesced() rounds the
+    * expiry up to a multiple of granule ticks, so
+    * timers that do not need exact timing expire in
+    * one batch and the CPU wakes up less often.
+    *-------------------------------------------------*/
+
+#define TWHEEL_LEVELS  4U
+#define TWHEEL_BITS    6U
+#define TWHEEL_SLOTS   (1U << TWHEEL_BITS)
+#define TWHEEL_MAX     ((1UL << (TWHEEL_LEVELS * TWHEEL_BITS)) - 1U)   /* ticks */
+#define TWHEEL_IDLE    0xFFFFFFFFU             /* twheel_next(): nothing armed */
+
+typedef struct twheel_timer twheel_timer_t;
+
+typedef void (*twheel_fn_t)(twheel_timer_t *t, void *ctx);
+
+struct twheel_timer
+{
+    twheel_timer_t  *next;
+    twheel_timer_t **pprev;                    /* 0 = not on any list */
+    uint32_t         expires;                  /* absolute tick */
+    twheel_fn_t      fn;
+    void            *ctx;
+    uint8_t          level;                    /* where it is listed */
+    uint8_t          index;
+};
+
+typedef struct
+{
+    twheel_timer_t *slot[TWHEEL_LEVELS][TWHEEL_SLOTS];
+    uint32_t        used[TWHEEL_LEVELS][2];    /* non-empty slot bitmap */
+    twheel_timer_t *expired;
+    uint32_t        now;                       /* last processed tick */
+    uint32_t        armed;
+} twheel_t;
+
+void twheel_init(twheel_t *w, uint32_t now);
+void twheel_timer_init(twheel_timer_t *t, twheel_fn_t fn, void *ctx);
+
+void twheel_arm(twheel_t *w, twheel_timer_t *t, uint32_t delay);
+void twheel_arm_coalesced(twheel_t *w, twheel_timer_t *t, uint32_t delay, uint32_t granule);
+void twheel_cancel(twheel_t *w, twheel_timer_t *t);
+
+uint32_t twheel_advance(twheel_t *w, uint32_t now);   /* returns timers expired */
+uint32_t twheel_dispatch(twheel_t *w);                 /* returns callbacks run */
+uint32_t twheel_next(const twheel_t *w);              /* ticks, may be early */
+
+static inline uint32_t twheel_armed(const twheel_timer_t *t)
+{
+    return (t->pprev != 0) ? 1U : 0U;
+}
+
+#endif /* TWHEEL_H */
@@ -0,0 +1,358 @@
+#include "wdog.h"
+
+#define LSI_HZ        32000U                   /* nominal, 17..47 kHz */
+#define WDOG_MAGIC    0x3D06B17EU
+#define WWDG_MIN_CNT  0x3FU                    /* reset when T6 clears */
+
+#define KR_UNLOCK     0x5555U
+#define KR_REFRESH    0xAAAAU
+#define KR_START      0xCCCCU
+
+volatile uint32_t wdog_beats[WDOG_MAX_TASKS];
+
+static wdog_task_t tasks[WDOG_MAX_TASKS];
+static uint32_t n_tasks = 0U;
+static uint32_t started = 0U;
+static uint32_t tick_ms = 1U;
+static volatile uint32_t now_ms = 0U;
+static volatile uint32_t late_mask = 0U;
+
+static uint32_t iwdg_pr;
+static uint32_t iwdg_rlr;
+static uint32_t wwdg_tb;
+static uint32_t wwdg_t;
+static uint32_t wwdg_w;
+
+static wdog_record_t record __attribute__((section(".noinit")));
+
+void wdog_ewi(const uint32_t *frame);
+
+static uint32_t pclk1_hz(void)
+{
+    uint32_t ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+
+    return (ppre & 4U) ? (SystemCoreClock >> ((ppre & 3U) + 1U)) : SystemCoreClock;
+}
+
+   /*--------------------------------------------------
+    * IWDG: smallest prescaler whose 12-bit reload
+    * reaches iwdg_ms. WWDG: smallest WDGTB whose 64
+    * counts reach wwdg_ms, window at half.
+    *-------------------------------------------------*/
+int wdog_init(const wdog_cfg_t *cfg)
+{
+    uint32_t pr;
+    uint32_t tb;
+    uint32_t counts = 0U;
+    uint64_t count_us = 0U;
+
+    if ((cfg->tick_ms == 0U) || (cfg->iwdg_ms < (4U * cfg->tick_ms)))
+    {
+        return WDOG_ERR_CONFIG;
+    }
+
+    for (pr = 0U; pr <= 6U; pr++)
+    {
+        uint32_t ticks = (uint32_t)(((uint64_t)cfg->iwdg_ms * LSI_HZ) / (1000U * (4UL << pr)));
+
+        if ((ticks >= 1U) && (ticks <= 0x1000U))
+        {
+            break;
+        }
+    }
+    if (pr > 6U)
+    {
+        return WDOG_ERR_CONFIG;
+    }
+    iwdg_pr = pr;
+    iwdg_rlr = (uint32_t)(((uint64_t)cfg->iwdg_ms * LSI_HZ) / (1000U * (4UL << pr))) - 1U;
+
+    for (tb = 0U; tb <= 3U; tb++)
+    {
+        count_us = ((uint64_t)(4096UL << tb) * 1000000U) / pclk1_hz();
+        counts = (uint32_t)((((uint64_t)cfg->wwdg_ms * 1000U) + count_us - 1U) / count_us);
+
+        if (counts <= 64U)
+        {
+            break;
+        }
+    }
+    if ((tb > 3U) || (counts < 4U))
+    {
+        return WDOG_ERR_CONFIG;
+    }
+
+    /* the service tick has to fall inside the open half */
+    if (((uint64_t)cfg->tick_ms * 1000U) >= ((uint64_t)(counts / 2U - 1U) * count_us))
+    {
+        return WDOG_ERR_CONFIG;
+    }
+
+    wwdg_tb = tb;
+    wwdg_t = WWDG_MIN_CNT + counts;
+    wwdg_w = WWDG_MIN_CNT + (counts / 2U);
+    tick_ms = cfg->tick_ms;
+
+    return WDOG_OK;
+}
+
+int wdog_task_add(const char *name, uint32_t deadline_ms)
+{
+    wdog_task_t *t;
+
+    if (started)
+    {
+        return WDOG_ERR_STARTED;
+    }
+    if (n_tasks >= WDOG_MAX_TASKS)
+    {
+        return WDOG_ERR_FULL;
+    }
+
+    t = &tasks[n_tasks];
+    t->name = name;
+    t->deadline_ms = deadline_ms;
+    t->seen = wdog_beats[n_tasks];
+    t->last_ms = 0U;
+
+    return (int)n_tasks++;
+}
+
+void wdog_start(void)
+{
+    now_ms = 0U;
+    late_mask = 0U;
+
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP | DBGMCU_APB1_FZ_DBG_WWDG_STOP;
+
+   /*--------------------------------------------------
+    * WWDG: window, prescaler, early wakeup at 0x40
+    *-------------------------------------------------*/
+    RCC->APB1ENR |= RCC_APB1ENR_WWDGEN;
+
+    WWDG->CFR = (wwdg_tb << WWDG_CFR_WDGTB_Pos) | wwdg_w | WWDG_CFR_EWI;
+    WWDG->SR = 0U;
+
+    NVIC_SetPriority(WWDG_IRQn, 0U);
+    NVIC_EnableIRQ(WWDG_IRQn);
+
+    WWDG->CR = WWDG_CR_WDGA | wwdg_t;
+
+   /*--------------------------------------------------
+    * IWDG: starting it also starts the LSI
+    *-------------------------------------------------*/
+    IWDG->KR = KR_START;
+    IWDG->KR = KR_UNLOCK;
+    IWDG->PR = iwdg_pr;
+    IWDG->RLR = iwdg_rlr;
+    while (IWDG->SR & (IWDG_SR_PVU | IWDG_SR_RVU))
+    {
+        /* wait for the LSI domain */
+    }
+    IWDG->KR = KR_REFRESH;
+
+    started = 1U;
+}
+
+   /*--------------------------------------------------
+    * A task is late when its beat count has not moved
+    * for longer than its deadline
+    *-------------------------------------------------*/
+void wdog_service(void)
+{
+    uint32_t now = now_ms + tick_ms;
+    uint32_t late = 0U;
+    uint32_t i;
+
+    now_ms = now;
+
+    for (i = 0U; i < n_tasks; i++)
+    {
+        wdog_task_t *t = &tasks[i];
+        uint32_t b = wdog_beats[i];
+
+        if (b != t->seen)
+        {
+            t->seen = b;
+            t->last_ms = now;
+        }
+        else if ((now - t->last_ms) > t->deadline_ms)
+        {
+            late |= 1UL << i;
+        }
+    }
+
+    late_mask = late;
+
+    if ((late != 0U) || !started)
+    {
+        return;                                /* let the watchdogs run out */
+    }
+
+    IWDG->KR = KR_REFRESH;
+
+    if ((WWDG->CR & WWDG_CR_T) < wwdg_w)
+    {
+        WWDG->CR = WWDG_CR_WDGA | wwdg_t;      /* inside the window only */
+    }
+}
+
+uint32_t wdog_late(void)
+{
+    return late_mask;
+}
+
+   /*--------------------------------------------------
+    * WWDG early wakeup: the frame of whatever was
+    * interrupted (MSP or PSP, from EXC_RETURN)
+    *-------------------------------------------------*/
+__attribute__((naked)) void WWDG_IRQHandler(void)
+{
+    __asm volatile
+    (
+        "tst   lr, #4        \n"
+        "ite   eq            \n"
+        "mrseq r0, msp       \n"
+        "mrsne r0, psp       \n"
+        "b     wdog_ewi      \n"
+    );
+}
+
+void wdog_ewi(const uint32_t *frame)
+{
+    uint32_t addr = (uint32_t)frame;
+    uint32_t now = now_ms;
+    uint32_t i;
+
+    WWDG->SR = 0U;
+
+    record.magic = WDOG_MAGIC;
+    record.check = 0U;
+    record.uptime_ms = now;
+    record.late = 0U;
+
+    for (i = 0U; i < WDOG_MAX_TASKS; i++)
+    {
+        record.age_ms[i] = 0U;
+
+        if (i < n_tasks)
+        {
+            record.age_ms[i] = now - tasks[i].last_ms;
+            if (record.age_ms[i] > tasks[i].deadline_ms)
+            {
+                record.late |= 1UL << i;
+            }
+        }
+    }
+
+    if ((addr >= SRAM1_BASE) && (addr < (SRAM1_BASE + (96U * 1024U) - 32U)))
+    {
+        record.lr = frame[5];
+        record.pc = frame[6];
+    }
+    else
+    {
+        record.lr = 0U;
+        record.pc = 0U;
+    }
+
+    record.check = ~WDOG_MAGIC;
+    __DSB();
+
+    /* no refresh: the WWDG resets within one count */
+}
+
+   /*--------------------------------------------------
+    * Report
+    *-------------------------------------------------*/
+static void put_u32(wdog_out_t out, uint32_t v)
+{
+    char buf[11];
+    int i = 10;
+
+    buf[10] = '\0';
+    do
+    {
+        buf[--i] = (char)('0' + (v % 10U));
+        v /= 10U;
+    } while ((v > 0U) && (i > 0));
+
+    out(&buf[i]);
+}
+
+static void put_hex(wdog_out_t out, uint32_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[11];
+    uint32_t i;
+
+    buf[0] = '0';
+    buf[1] = 'x';
+    for (i = 0U; i < 8U; i++)
+    {
+        buf[2U + i] = digits[(v >> (28U - (4U * i))) & 0xFU];
+    }
+    buf[10] = '\0';
+
+    out(buf);
+}
+
+uint32_t wdog_report(wdog_out_t out)
+{
+    uint32_t csr = RCC->CSR;
+    uint32_t wd = csr & (RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF);
+    uint32_t i;
+
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    out("reset:");
+    if (csr & RCC_CSR_IWDGRSTF) { out(" iwdg"); }
+    if (csr & RCC_CSR_WWDGRSTF) { out(" wwdg"); }
+    if (csr & RCC_CSR_SFTRSTF)  { out(" software"); }
+    if (csr & RCC_CSR_PORRSTF)  { out(" power-on"); }
+    else if (csr & RCC_CSR_BORRSTF) { out(" brown-out"); }
+    if (csr & RCC_CSR_PINRSTF)  { out(" pin"); }
+    if (csr & RCC_CSR_LPWRRSTF) { out(" low-power"); }
+    out("\r\n");
+
+    if ((csr & RCC_CSR_WWDGRSTF) && (record.magic == WDOG_MAGIC) && (record.check == ~WDOG_MAGIC))
+    {
+        out("WWDG at ");
+        put_u32(out, record.uptime_ms);
+        out(" ms, pc=");
+        put_hex(out, record.pc);
+        out(" lr=");
+        put_hex(out, record.lr);
+        out("\r\n");
+
+        for (i = 0U; i < WDOG_MAX_TASKS; i++)
+        {
+            if (!(record.late & (1UL << i)))
+            {
+                continue;
+            }
+
+            out("  late: ");
+            if (i < n_tasks)
+            {
+                out(tasks[i].name);
+            }
+            else
+            {
+                out("task ");
+                put_u32(out, i);
+            }
+            out(", no check-in for ");
+            put_u32(out, record.age_ms[i]);
+            out(" ms\r\n");
+        }
+    }
+    else if (csr & RCC_CSR_WWDGRSTF)
+    {
+        out("WWDG, no record (interrupts masked?)\r\n");
+    }
+
+    record.check = 0U;
+
+    return (wd != 0U) ? 1U : 0U;
+}
@@ -0,0 +1,105 @@
+#ifndef WDOG_H
+#define WDOG_H
+
+#include "stm32f4xx.h"
+
+   /*--------------------------------------------------
+    * Watchdog supervisor: per-task check-ins, IWDG
+    * and WWDG
+    *
+    * Every supervised task (a pipeline stage, the ADC
+    * block consumer, the telemetry drain ...) is added
+    * with a deadline and calls wdog_checkin() each
+    * time it gets through its work. wdog_service(),
+    * called every tick_ms from a timer interrupt,
+    * refreshes the watchdogs only while every task has
+    * checked in within its deadline. One stuck task is
+    * enough to stop the refresh, even if the interrupt
+    * side of the system still runs fine.
+    *
+    * Two watchdogs:
+    *   WWDG  on PCLK1, fast (wwdg_ms, up to ~130 ms at
+    *         16 MHz). Its early wakeup interrupt runs
+    *         one WWDG count (2 ms at most) before the
+    *         reset and saves which tasks were late,
+    *         how late, and the pc / lr the CPU was at,
+    *         into a record in .noinit. The WWDG
+    *         interrupt gets priority 0.
+    *   IWDG  on the LSI, independent of the clock
+    *         tree: resets when PCLK1 stops and the
+    *         WWDG with it (Stop mode nothing wakes
+    *         from, a failed clock), after iwdg_ms (up
+    *         to 32 s). No record then, only the reset
+    *         flag.
+    * A hang with interrupts masked still ends in a
+    * WWDG reset, but without a record: the early
+    * wakeup interrupt cannot run.
+    * The WWDG is refreshed only inside its window
+    * (the second half of the period); the service
+    * tick must be shorter than that half, which
+    * wdog_init() checks.
+    *
+    * After the reset wdog_report() prints the reset
+    * cause from RCC CSR and, for a WWDG reset, the
+    * record. Once started neither watchdog can be
+    * stopped; both halt while a debugger stops the
+    * core.
+    *
+    * wdog_checkin() is one increment of the task's own
+    * counter: call it from one context per task (task
+    * or ISR), no lock needed.
+    *-------------------------------------------------*/
+
+#define WDOG_MAX_TASKS   8U
+
+#define WDOG_OK           0
+#define WDOG_ERR_CONFIG  -1                    /* timeouts / tick do not fit */
+#define WDOG_ERR_FULL    -2                    /* WDOG_MAX_TASKS reached */
+#define WDOG_ERR_STARTED -3                    /* no new tasks once running */
+
+typedef struct
+{
+    uint32_t iwdg_ms;
+    uint32_t wwdg_ms;
+    uint32_t tick_ms;                          /* wdog_service() period */
+} wdog_cfg_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t    deadline_ms;
+    uint32_t    seen;                          /* beats at the last service */
+    uint32_t    last_ms;                       /* time of the last new beat */
+} wdog_task_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t uptime_ms;
+    uint32_t late;                             /* bit per task */
+    uint32_t age_ms[WDOG_MAX_TASKS];           /* since the last check-in */
+    uint32_t pc;                               /* interrupted context */
+    uint32_t lr;
+    uint32_t check;
+} wdog_record_t;
+
+typedef void (*wdog_out_t)(const char *s);
+
+extern volatile uint32_t wdog_beats[WDOG_MAX_TASKS];
+
+int  wdog_init(const wdog_cfg_t *cfg);
+int  wdog_task_add(const char *name, uint32_t deadline_ms);   /* id or error */
+void wdog_start(void);
+void wdog_service(void);                       /* every tick_ms */
+
+static inline void wdog_checkin(int id)
+{
+    wdog_beats[id]++;
+}
+
+uint32_t wdog_late(void);                      /* bit per task, as of the last service */
+
+   /* reset cause, and the record after a WWDG reset; returns 1 for a watchdog reset */
+uint32_t wdog_report(wdog_out_t out);
+
+#endif /* WDOG_H */